@@ -98,6 +98,8 @@ IF(CMAKE_COMPILER_IS_GNUCXX OR MINGW)
         set(USE_SSE ON CACHE BOOL "Enable SSE for GCC")
         set(USE_SSE2 ON CACHE BOOL "Enable SSE2 for GCC")
         set(USE_SSE3 ON CACHE BOOL "Enable SSE3 for GCC")
+        set(USE_AVX2 OFF CACHE BOOL "Enable AVX2 and POPCNT for GCC (binary descriptor matching)")
+        set(USE_AVX512 OFF CACHE BOOL "Enable AVX-512 VPOPCNTDQ for GCC (binary descriptor matching)")
     endif()
     if(${CMAKE_SYSTEM_PROCESSOR} MATCHES i686* OR ${CMAKE_SYSTEM_PROCESSOR} MATCHES x86)
         set(USE_O3 ON CACHE BOOL "Enable -O3 for GCC")
@@ -150,6 +152,12 @@ IF(CMAKE_COMPILER_IS_GNUCXX OR MINGW)
     if(USE_SSE3 AND NOT MINGW) # SSE3 should be disabled under MingW because it generates compiler errors
        set(EXTRA_C_FLAGS_RELEASE "${EXTRA_C_FLAGS_RELEASE} -msse3")
     endif()
+    if(USE_AVX2) # The binaries need a Haswell (or newer) CPU
+       set(EXTRA_C_FLAGS_RELEASE "${EXTRA_C_FLAGS_RELEASE} -mavx2 -mpopcnt")
+    endif()
+    if(USE_AVX512) # The binaries need an Ice Lake (or newer) CPU
+       set(EXTRA_C_FLAGS_RELEASE "${EXTRA_C_FLAGS_RELEASE} -mavx512f -mavx512bw -mavx512vpopcntdq -mpopcnt")
+    endif()
 
     if(ENABLE_PROFILING)
         set(EXTRA_C_FLAGS_RELEASE "${EXTRA_C_FLAGS_RELEASE} -pg -g")
@@ -5,10 +5,16 @@
  * based on OpenCV Tutorials
  */
 
+#include <atomic>
 #include <iostream>
 #include <string>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <cvdemo/basic_operations.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/buffer_cache.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/video.hpp>
 
 /// Global Variables
 int threshold_value = 0;
@@ -16,15 +22,24 @@ int threshold_type = 3;
 int const max_value = 255;
 int const max_type = 4;
 int const max_BINARY_value = 255;
+int const batch_threshold_value = 128; /// threshold used by the batch mode
 
-cv::Mat src, src_gray, dst;
-const char* window_name = "Threshold Demo";
+cv::Mat src_gray, dst;
+bool reuse_buffers = false;
+cvdemo::BufferCache cache;          /// buffers of the trackbar events with --reuse-buffers
+cvdemo::BufferCache stream_cache;   /// buffers of the processing thread of the stream mode
+/// Copies of the trackbar values read by the processing thread of the stream mode
+std::atomic<int> stream_threshold_value(0), stream_threshold_type(3);
+cvdemo::Display display( "Threshold Demo" );
 
 const char* trackbar_type = "Type: \n 0: Binary \n 1: Binary Inverted \n 2: Truncate \n 3: To Zero \n 4: To Zero Inverted";
 const char* trackbar_value = "Value";
+const char* threshold_names[] = { "Binary Threshold", "Binary Inverted Threshold", "Truncate Threshold", "To Zero Threshold", "To Zero Inverted Threshold" };
 
 /// Function headers
 void threshold_demo( int, void* );
+void stream_parameters_changed( int, void* );
+int run_stream( const cvdemo::StreamOptions &stream );
 void show_help(const std::string &message = "");
 
 /**
@@ -32,33 +47,53 @@ void show_help(const std::string &message = "");
  */
 int main(int argc, char **argv)
 {
-	if(argc < 2)
+	cvdemo::CommandLine command_line(argc, argv);
+	if(!command_line.valid())
 	{
-		show_help("Not enough parameters given."); 
+		show_help(command_line.error());
 		return -1;
 	}
+	reuse_buffers = command_line.has("reuse-buffers");
 
-	std::string image_file("");
-	/// Iterate over the arguments passed through the command line
-	for(int i = 1; i < argc; ++i)
+	/// Headless mode: every threshold type is applied to every image and the results are written to disk
+	cvdemo::BatchOptions batch = command_line.batch();
+	if(batch.enabled)
 	{
-		std::string input_file(argv[i]);
-		if(input_file.find_last_of(".jpg") != std::string::npos || input_file.find_last_of(".png") != std::string::npos)
+		cvdemo::BatchWriter writer(batch.output_dir);
+		return cvdemo::run_batch(batch, writer, [&writer](const cv::Mat &image, const std::string &)
 		{
-			image_file = input_file;
-		}
-		else 
-			show_help();
+			cvdemo::to_gray( image, src_gray );
+			for(int type = 0; type <= max_type; ++type)
+			{
+				cvdemo::threshold( src_gray, dst, batch_threshold_value, type, max_BINARY_value );
+				writer.stage( threshold_names[type] );
+				if(!writer.write( dst ))
+					return -1;
+			}
+			return 0;
+		});
 	}
 
-	if(image_file.length() == 0)
+	/// Stream mode: the frames of a video or camera are thresholded in a decode/process/display pipeline
+	cvdemo::StreamOptions stream = command_line.stream();
+	if(stream.enabled)
+		return run_stream(stream);
+
+	if(command_line.positional().empty())
+	{
+		show_help("Not enough parameters given.");
+		return -1;
+	}
+
+	std::vector<std::string> image_files = command_line.images();
+	if(image_files.empty())
 	{
 		show_help("No valid file format given.");
 		return(-1);
 	}
 
 	/// Load the source image
-	src = cv::imread(image_file, 1 );
+	cv::Mat src = cv::imread(image_files.back(), 1 );
 	if(!src.data)
 	{
 		show_help("Image not valid.");
@@ -66,18 +101,18 @@ int main(int argc, char **argv)
 	}
 
 	/// Create a window to display results
-	cv::namedWindow( window_name, cv::WINDOW_AUTOSIZE );
+	display.open();
 
 	/// Convert the image to Gray
-	cv::cvtColor( src, src_gray, cv::COLOR_RGB2GRAY );
+	cvdemo::to_gray( src, src_gray );
 
 	/// Create Trackbar to choose type of Threshold
 	cv::createTrackbar( trackbar_type,
-                  window_name, &threshold_type,
+                  display.window_name(), &threshold_type,
                   max_type, threshold_demo );
 
 	cv::createTrackbar( trackbar_value,
-                  window_name, &threshold_value,
+                  display.window_name(), &threshold_value,
                   max_value, threshold_demo );
 
 	std::cout << "Type: \n 0: Binary \n 1: Binary Inverted \n 2: Truncate \n 3: To Zero \n 4: To Zero Inverted" << std::endl;
@@ -88,11 +123,11 @@ int main(int argc, char **argv)
 	while(true)
 	{
 		int c;
-		c = cv::waitKey( 20 );
+		c = display.wait( 20 );
 		if( (char)c == 27 )    /// If ESC is pressed, then quit
 			break;
 	}
-	cv::waitKey(0);
+	display.wait();
 
 	return 0;
 }
@@ -109,19 +144,52 @@ void threshold_demo( int, void* )
      4: Threshold to Zero Inverted
    */
 
-  cv::threshold( src_gray, dst, threshold_value, max_BINARY_value,threshold_type );
-
-  cv::imshow( window_name, dst );
-  
-  switch(threshold_type)
-  {
-	case 0: std::cout << "Selected: " << "Binary Threshold" << std::endl; break;
-	case 1: std::cout << "Selected: " << "Binary Inverted Threshold" << std::endl; break;
-	case 2: std::cout << "Selected: " << "Truncate Threshold" << std::endl; break;
-	case 3: std::cout << "Selected: " << "To Zero Threshold" << std::endl; break;
-	case 4: std::cout << "Selected: " << "To Zero Inverted Threshold" << std::endl; break;
-	default: std::cout << "Invalid Threshold type" << std::endl;
-  }
+  cv::Mat &result = reuse_buffers ? cache.buffer( "threshold" ) : dst;
+  cvdemo::threshold( src_gray, result, threshold_value, threshold_type, max_BINARY_value );
+
+  display.show( result );
+
+  if(threshold_type >= 0 && threshold_type <= max_type)
+	std::cout << "Selected: " << threshold_names[threshold_type] << std::endl;
+  else
+	std::cout << "Invalid Threshold type" << std::endl;
+
+  if(reuse_buffers)
+	std::cout << "Buffers allocated: " << cache.allocations() << std::endl;
+}
+
+/**
+ * @function stream_parameters_changed
+ */
+void stream_parameters_changed( int, void* )
+{
+	stream_threshold_value = threshold_value;
+	stream_threshold_type = threshold_type;
+}
+
+/**
+ * @function run_stream
+ */
+int run_stream( const cvdemo::StreamOptions &stream )
+{
+	if(stream.headless)
+		threshold_value = batch_threshold_value;
+	else
+	{
+		display.open();
+		cv::createTrackbar( trackbar_type, display.window_name(), &threshold_type, max_type, stream_parameters_changed );
+		cv::createTrackbar( trackbar_value, display.window_name(), &threshold_value, max_value, stream_parameters_changed );
+	}
+	stream_parameters_changed( 0, 0 );
+
+	int status = cvdemo::run_stream( stream, display, [](const cv::Mat &frame, cv::Mat &result)
+	{
+		cv::Mat &gray = stream_cache.buffer( "gray" );
+		cvdemo::to_gray( frame, gray );
+		cvdemo::threshold( gray, result, stream_threshold_value, stream_threshold_type, max_BINARY_value );
+	});
+	std::cout << "Buffers allocated: " << stream_cache.allocations() << std::endl;
+	return status;
 }
 
 /**
@@ -129,11 +197,5 @@ void threshold_demo( int, void* )
  */
 void show_help(const std::string &message)
 {
-	std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-	std::cout << "Usage: cv_binarization_d /path/to/image" << std::endl; 
-	#else
-	std::cout << "Usage: cv_binarization /path/to/image" << std::endl; 
-	#endif
-	std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
-}
\ No newline at end of file
+	cvdemo::show_help("cv_binarization", { "/path/to/image [--reuse-buffers]", "--batch <dir|glob> --out <dir>", "--video <file|camera index> [--record <file.avi>] [--headless]" }, message);
+}
@@ -7,32 +7,18 @@
 
 #include <iostream>
 #include <string>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
-
-/// Defines depending of OpenCV version installed (2.4.x or 3.x)
-#ifdef OPENCV_OLD	/// 2.4.x version
-const int GRAY_CONV = CV_BGR2GRAY;
-const int HSV_CONV  = CV_BGR2HSV;
-const int HLS_CONV  = CV_BGR2HLS;
-const int LAB_CONV  = CV_BGR2Lab;
-const int YUV_CONV  = CV_BGR2YUV;
-#else				/// 3.x - github version
-const int GRAY_CONV = cv::COLOR_BGR2GRAY;
-const int HSV_CONV  = cv::COLOR_BGR2HSV;
-const int HLS_CONV  = cv::COLOR_BGR2HLS;
-const int LAB_CONV  = cv::COLOR_BGR2Lab;
-const int YUV_CONV  = cv::COLOR_BGR2YUV;
-#endif
+#include <cvdemo/basic_operations.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
 
 /// Global Variables
 int DELAY_CAPTION = 2000; /// 2 seconds
-cv::Mat src, dst;
-char window_name[] = "Conversions Demo";
+cvdemo::Display display( "Conversions Demo", DELAY_CAPTION );
 
 /// Function headers
-int display_caption( const char* caption );
-int display_dst( int delay );
+int conversions_demo( const cv::Mat &src );
 void show_help(const std::string &message = "");
 
 /**
@@ -40,33 +26,40 @@ void show_help(const std::string &message = "");
  */
 int main(int argc, char **argv)
 {
-	if(argc < 2)
+	cvdemo::CommandLine command_line(argc, argv);
+	if(!command_line.valid())
 	{
-		show_help("Not enough parameters given."); 
+		show_help(command_line.error());
 		return -1;
 	}
-	
-	std::string image_file("");
-	/// Iterate over the arguments passed through the command line
-	for(int i = 1; i < argc; ++i)
+
+	/// Headless mode: every image is converted and the results are written to disk
+	cvdemo::BatchOptions batch = command_line.batch();
+	if(batch.enabled)
 	{
-		std::string input_file(argv[i]);
-		if(input_file.find_last_of(".jpg") != std::string::npos || input_file.find_last_of(".png") != std::string::npos)
+		cvdemo::BatchWriter writer(batch.output_dir);
+		display.set_writer(&writer);
+		return cvdemo::run_batch(batch, writer, [](const cv::Mat &image, const std::string &)
 		{
-			image_file = input_file;
-		}
-		else 
-			show_help();
+			return conversions_demo(image);
+		});
+	}
+
+	if(command_line.positional().empty())
+	{
+		show_help("Not enough parameters given.");
+		return -1;
 	}
 
-	if(image_file.length() == 0)
+	std::vector<std::string> image_files = command_line.images();
+	if(image_files.empty())
 	{
 		show_help("No valid file format given.");
 		return(-1);
 	}
 
 	/// Load the source image
-	src = cv::imread(image_file, 1 );
+	cv::Mat src = cv::imread(image_files.back(), 1 );
 	if(!src.data)
 	{
 		show_help("Image not valid.");
@@ -74,87 +67,46 @@ int main(int argc, char **argv)
 	}
 
 	/// Create a window to display results
-	cv::namedWindow( window_name, cv::WINDOW_AUTOSIZE );
-
-	if( display_caption( "Original Image" ) != 0 ) 
-		return 0;
-
-	dst = src.clone();
-	if( display_dst( DELAY_CAPTION ) != 0 )
-		return 0;
-  
-	/// Applying Grayscale conversion
-	if( display_caption( "Gray Scale Image" ) != 0 )
-		return 0;
-
-	cv::cvtColor(src, dst, GRAY_CONV);
-	if( display_dst( DELAY_CAPTION ) != 0 )
-		return 0;
-
-	/// Applying HSV conversion
-	if( display_caption( "HSV Image" ) != 0 )
-		return 0;
-
-	cv::cvtColor(src, dst, HSV_CONV);
-	if( display_dst( DELAY_CAPTION ) != 0 )
-		return 0;
-
-	/// Applying HLS conversion
-	if( display_caption( "HLS Image" ) != 0 )
-		return 0;
-
-	cv::cvtColor(src, dst, HLS_CONV);
-	if( display_dst( DELAY_CAPTION ) != 0 )
-		return 0;
-
-	/// Applying Lab conversion
-	if( display_caption( "Lab Image" ) != 0 )
-		return 0;
-
-	cv::cvtColor(src, dst, LAB_CONV);
-	if( display_dst( DELAY_CAPTION ) != 0 )
-		return 0;
+	display.open();
 
-	/// Applying YUV conversion
-	if( display_caption( "YUV Image" ) != 0 )
-		return 0;
-
-	cv::cvtColor(src, dst, YUV_CONV);
-	if( display_dst( DELAY_CAPTION ) != 0 )
+	if( conversions_demo( src ) != 0 )
 		return 0;
 
 	/// Wait until user press a key
-	display_caption( "End: Press a key!" );
+	display.caption( "End: Press a key!", src );
 
-	cv::waitKey(0);
+	display.wait();
 
 	return 0;
 }
 
 /**
- * @function display_caption
+ * @function conversions_demo
+ * brief applies the color conversions to src, stops if a key is pressed
  */
-int display_caption( const char* caption )
+int conversions_demo( const cv::Mat &src )
 {
-	dst = cv::Mat::zeros( src.size(), src.type() );
-	cv::putText( dst, caption,
-		cv::Point( src.cols/4, src.rows/2),
-		cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(255, 255, 255) );
-
-	cv::imshow( window_name, dst );
-	int c = cv::waitKey( DELAY_CAPTION );
-	if( c >= 0 ) { return -1; }
-	return 0;
-}
+	const cvdemo::ColorSpace spaces[] = { cvdemo::COLOR_GRAY, cvdemo::COLOR_HSV, cvdemo::COLOR_HLS, cvdemo::COLOR_LAB, cvdemo::COLOR_YUV };
+	const char* captions[] = { "Gray Scale Image", "HSV Image", "HLS Image", "Lab Image", "YUV Image" };
+
+	if( display.caption( "Original Image", src ) != 0 )
+		return -1;
+
+	if( display.show( src, DELAY_CAPTION ) != 0 )
+		return -1;
+
+	/// Applying Grayscale, HSV, HLS, Lab and YUV conversion
+	cv::Mat dst;
+	for ( int i = 0; i < 5; ++i )
+	{
+		if( display.caption( captions[i], src ) != 0 )
+			return -1;
+
+		cvdemo::convert_color( src, dst, spaces[i] );
+		if( display.show( dst, DELAY_CAPTION ) != 0 )
+			return -1;
+	}
 
-/**
- * @function display_dst
- */
-int display_dst( int delay )
-{
-	cv::imshow( window_name, dst );
-	int c = cv::waitKey ( delay );
-	if( c >= 0 ) { return -1; }
 	return 0;
 }
 
@@ -163,11 +115,5 @@ int display_dst( int delay )
  */
 void show_help(const std::string &message)
 {
-	std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-	std::cout << "Usage: cv_conversions_d /path/to/image" << std::endl; 
-	#else
-	std::cout << "Usage: cv_conversions /path/to/image" << std::endl; 
-	#endif
-	std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
+	cvdemo::show_help("cv_conversions", { "/path/to/image", "--batch <dir|glob> --out <dir>" }, message);
 }
@@ -5,22 +5,43 @@
  * based on OpenCV Tutorials
  */
 
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
 #include <iostream>
 #include <string>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <cvdemo/basic_operations.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/buffer_cache.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/timing.hpp>
+#include <cvdemo/video.hpp>
 
 /// Global variables
 cv::Mat src, dilation_dst;
+cvdemo::Display display( "Dilation Demo" );
+bool reuse_buffers = false;
+bool van_herk = false;              /// --van-herk: rectangles in constant time per pixel
+cvdemo::BufferCache cache;          /// buffers and structuring elements of the trackbar events with --reuse-buffers
+cvdemo::BufferCache stream_cache;   /// buffers and structuring elements of the processing thread of the stream mode
 
 int dilation_elem = 0;
 int dilation_size = 0;
 int const max_elem = 2;
 int const max_kernel_size = 21;
+int const batch_kernel_size = 2;  /// kernel size (2n+1) used by the batch mode
+/// Copies of the trackbar values read by the processing thread of the stream mode
+std::atomic<int> stream_elem(0), stream_size(0);
+const char* element_names[] = { "Rect", "Cross", "Ellipse" };
 
 /** Function Headers */
-void erosion_demo( int, void* );
 void dilation_demo( int, void* );
+void apply_dilation( const cv::Mat &input, cv::Mat &output, cvdemo::ElementShape shape, int size, cvdemo::BufferCache *buffers );
+int morphology_benchmark( const cv::Mat &input, int repeat );
+void stream_parameters_changed( int, void* );
+int run_stream( const cvdemo::StreamOptions &stream );
 void show_help(const std::string &message = "");
 
 /**
@@ -28,55 +49,78 @@ void show_help(const std::string &message = "");
  */
 int main(int argc, char **argv)
 {
-    if(argc < 2)
+    cvdemo::CommandLine command_line(argc, argv, { "repeat" });
+    if(!command_line.valid())
+    {
+        show_help(command_line.error());
+        return -1;
+    }
+    reuse_buffers = command_line.has("reuse-buffers");
+    van_herk = command_line.has("van-herk");
+
+    /// Headless mode: every structuring element is applied to every image and the results are written to disk
+    cvdemo::BatchOptions batch = command_line.batch();
+    if(batch.enabled)
+    {
+        cvdemo::BatchWriter writer(batch.output_dir);
+        return cvdemo::run_batch(batch, writer, [&writer](const cv::Mat &image, const std::string &)
+        {
+            for(int elem = 0; elem <= max_elem; ++elem)
+            {
+                cvdemo::dilate( image, dilation_dst, static_cast<cvdemo::ElementShape>(elem), batch_kernel_size );
+                writer.stage( element_names[elem] );
+                if(!writer.write( dilation_dst ))
+                    return -1;
+            }
+            return 0;
+        });
+    }
+
+    /// Stream mode: the frames of a video or camera are dilated in a decode/process/display pipeline
+    cvdemo::StreamOptions stream = command_line.stream();
+    if(stream.enabled)
+        return run_stream(stream);
+
+    if(command_line.positional().empty())
 	{
 		show_help("Not enough parameters given."); 
 		return -1;
 	}
 
-	std::string image_file("");
-	/// Iterate over the arguments passed through the command line
-	for(int i = 1; i < argc; ++i)
-	{
-		std::string input_file(argv[i]);
-		if(input_file.find_last_of(".jpg") != std::string::npos || input_file.find_last_of(".png") != std::string::npos)
-		{
-			image_file = input_file;
-		}
-		else 
-			show_help();
-	}
-
-	if(image_file.length() == 0)
+	std::vector<std::string> image_files = command_line.images();
+	if(image_files.empty())
 	{
 		show_help("No valid file format given.");
 		return(-1);
 	}
 
 	/// Load the source image
-	src = cv::imread(image_file, 1 );
+	src = cv::imread(image_files.back(), 1 );
 	if(!src.data)
 	{
 		show_help("Image not valid.");
 		return(-1);
 	}
 
+    if(command_line.has("morphology-benchmark"))
+        return morphology_benchmark( src, command_line.get_int("repeat", 3) );
+
     /// Create windows
-    cv::namedWindow( "Dilation Demo", cv::WINDOW_AUTOSIZE );
+    display.open();
 
     /// Create Dilation Trackbar
-    cv::createTrackbar( "Element:\n 0: Rect \n 1: Cross \n 2: Ellipse", "Dilation Demo",
+    cv::createTrackbar( "Element:\n 0: Rect \n 1: Cross \n 2: Ellipse", display.window_name(),
           &dilation_elem, max_elem,
-		  dilation_demo );
+          dilation_demo );
 
-    cv::createTrackbar( "Kernel size:\n 2n +1", "Dilation Demo",
+    cv::createTrackbar( "Kernel size:\n 2n +1", display.window_name(),
           &dilation_size, max_kernel_size,
           dilation_demo );
 
     /// Default start
     dilation_demo( 0, 0 );
 
-    cv::waitKey(0);
+    display.wait();
     return 0;
 }
 
@@ -85,22 +129,93 @@ int main(int argc, char **argv)
  */
 void dilation_demo( int, void* )
 {
-    int dilation_type = 0;
-    switch(dilation_type)
-	{
-		case 0: dilation_type = cv::MORPH_RECT;    break;
-		case 1: dilation_type = cv::MORPH_CROSS;   break;
-		case 2: dilation_type = cv::MORPH_ELLIPSE; break;
-		default: dilation_type = cv::MORPH_RECT;
-	}
+    /// Apply the dilation operation
+    apply_dilation( src, dilation_dst, static_cast<cvdemo::ElementShape>(dilation_elem), dilation_size, reuse_buffers ? &cache : 0 );
+    display.show( dilation_dst );
 
-    cv::Mat element = cv::getStructuringElement( dilation_type,
-                       cv::Size( 2*dilation_size + 1, 2*dilation_size+1 ),
-                       cv::Point( dilation_size, dilation_size ) );
+    if(reuse_buffers)
+        std::cout << "Buffers allocated: " << cache.allocations() << std::endl;
+}
 
-    /// Apply the dilation operation
-    cv::dilate( src, dilation_dst, element );
-    cv::imshow( "Dilation Demo", dilation_dst );
+/**
+ * @function apply_dilation
+ * brief van Herk/Gil-Werman for rectangles with --van-herk, otherwise cv::dilate; the buffers and structuring elements
+ * are taken from the cache (if any)
+ */
+void apply_dilation( const cv::Mat &input, cv::Mat &output, cvdemo::ElementShape shape, int size, cvdemo::BufferCache *buffers )
+{
+    if(van_herk && shape == cvdemo::ELEMENT_RECT && buffers)
+        cvdemo::dilate_rect( input, output, size, *buffers );
+    else if(van_herk && shape == cvdemo::ELEMENT_RECT)
+        cvdemo::dilate_rect( input, output, size );
+    else if(buffers)
+        cvdemo::dilate( input, output, shape, size, *buffers );
+    else
+        cvdemo::dilate( input, output, shape, size );
+}
+
+/**
+ * @function stream_parameters_changed
+ */
+void stream_parameters_changed( int, void* )
+{
+    stream_elem = dilation_elem;
+    stream_size = dilation_size;
+}
+
+/**
+ * @function run_stream
+ */
+int run_stream( const cvdemo::StreamOptions &stream )
+{
+    if(stream.headless)
+        dilation_size = batch_kernel_size;
+    else
+    {
+        display.open();
+        cv::createTrackbar( "Element:\n 0: Rect \n 1: Cross \n 2: Ellipse", display.window_name(),
+              &dilation_elem, max_elem, stream_parameters_changed );
+        cv::createTrackbar( "Kernel size:\n 2n +1", display.window_name(),
+              &dilation_size, max_kernel_size, stream_parameters_changed );
+    }
+    stream_parameters_changed( 0, 0 );
+
+    int status = cvdemo::run_stream( stream, display, [](const cv::Mat &frame, cv::Mat &result)
+    {
+        apply_dilation( frame, result, static_cast<cvdemo::ElementShape>(stream_elem.load()), stream_size, &stream_cache );
+    });
+    std::cout << "Buffers allocated: " << stream_cache.allocations() << std::endl;
+    return status;
+}
+
+/**
+ * @function morphology_benchmark
+ * brief times cv::dilate and van Herk/Gil-Werman with rectangles of 3x3 ... 101x101, printed as ms per megapixel
+ */
+int morphology_benchmark( const cv::Mat &input, int repeat )
+{
+    const double megapixels = input.total() / 1e6;
+    const int sizes[] = { 1, 2, 3, 5, 7, 10, 15, 21, 30, 40, 50 };
+    repeat = std::max( 1, repeat );
+
+    std::cout << "Image: " << input.cols << "x" << input.rows << "x" << input.channels() << " (" << megapixels << " MP), best of " << repeat << " runs" << std::endl;
+    std::cout << std::setw(10) << "Kernel" << std::setw(16) << "dilate ms/MP" << std::setw(16) << "vHGW ms/MP"
+              << std::setw(10) << "speedup" << std::setw(10) << "max diff" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    cv::Mat reference, constant_time;
+    for( size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i )
+    {
+        const int size = sizes[i];
+        double reference_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::dilate( input, reference, cvdemo::ELEMENT_RECT, size ); } );
+        double constant_time_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::dilate_rect( input, constant_time, size ); } );
+
+        std::cout << std::setw(6) << 2*size + 1 << "x" << std::setw(3) << std::left << 2*size + 1 << std::right
+                  << std::setw(16) << reference_ms / megapixels << std::setw(16) << constant_time_ms / megapixels
+                  << std::setw(9) << reference_ms / constant_time_ms << "x" << std::setw(10) << cv::norm( reference, constant_time, cv::NORM_INF ) << std::endl;
+    }
+
+    return 0;
 }
 
 /**
@@ -108,11 +223,5 @@ void dilation_demo( int, void* )
  */
 void show_help(const std::string &message)
 {
-	std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-	std::cout << "Usage: cv_dilation_d /path/to/image" << std::endl; 
-	#else
-	std::cout << "Usage: cv_dilation /path/to/image" << std::endl; 
-	#endif
-	std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
-}
\ No newline at end of file
+	cvdemo::show_help("cv_dilation", { "/path/to/image [--reuse-buffers] [--van-herk]", "--morphology-benchmark [--repeat <n>] /path/to/image", "--batch <dir|glob> --out <dir>", "--video <file|camera index> [--record <file.avi>] [--headless]" }, message);
+}
@@ -5,23 +5,45 @@
  * based on OpenCV Tutorials
  */
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
-#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
 #include <opencv2/highgui/highgui.hpp>
-#include <opencv2/features2d/features2d.hpp>
+#include <cvdemo/basic_operations.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/thread_pool.hpp>
+#include <cvdemo/timing.hpp>
 
 /// Global Variables
 int DELAY_CAPTION = 2000; /// 2 seconds
 int DELAY_BLUR = 100;	  /// 100 milliseconds
 int MAX_KERNEL_LENGTH = 31;
 
-cv::Mat src, dst;
-char window_name[] = "Smoothing Demo";
+cvdemo::Display display( "Smoothing Demo", DELAY_CAPTION );
+
+/// Tiled mode: set by --tiled/--benchmark, the filters run on halo-padded tiles on the pool
+std::unique_ptr<cvdemo::ThreadPool> pool;
+int tile_size = 256;
+
+/// Scale space mode: set by --scale-space/--export, the Gaussian levels are derived incrementally one from the other
+bool use_scale_space = false;
+cvdemo::ScaleSpace scale_space;
+
+cvdemo::SmoothingFilter filters[] = { cvdemo::HOMOGENEOUS_BLUR, cvdemo::GAUSSIAN_BLUR, cvdemo::MEDIAN_BLUR, cvdemo::BILATERAL_BLUR };
+const char* filter_names[] = { "Homogeneous Blur", "Gaussian Blur", "Median Blur", "Bilateral Blur" };
 
 /// Function headers
-int display_caption( const char* caption );
-int display_dst( int delay );
+int smoothing_demo( const cv::Mat &src );
+std::vector<int> kernel_sizes();
+void apply_smoothing( const cv::Mat &src, cv::Mat &dst, cvdemo::SmoothingFilter filter, int kernel_size );
+int smoothing_benchmark( const cv::Mat &src, int repeat );
+int median_benchmark( const cv::Mat &src, int repeat );
+int bilateral_benchmark( const cv::Mat &src, int repeat );
 void show_help(const std::string &message = "");
 
 /**
@@ -29,124 +51,307 @@ void show_help(const std::string &message = "");
  */
 int main(int argc, char **argv)
 {
-	if(argc < 2)
+	cvdemo::CommandLine command_line(argc, argv, { "threads", "tile", "repeat", "export" });
+	if(!command_line.valid())
+	{
+		show_help(command_line.error());
+		return -1;
+	}
+
+	tile_size = command_line.get_int("tile", tile_size);
+	if(tile_size <= 0 || command_line.get_int("threads", 0) < 0)
 	{
-		show_help("Not enough parameters given."); 
+		show_help("Tile size and number of threads have to be positive.");
 		return -1;
 	}
 
-	std::string image_file("");
-	/// Iterate over the arguments passed through the command line
-	for(int i = 1; i < argc; ++i)
+	if(command_line.has("tiled") || command_line.has("benchmark"))
+		pool.reset(new cvdemo::ThreadPool(command_line.get_int("threads", 0)));
+
+	use_scale_space = command_line.has("scale-space") || command_line.has("export");
+
+	/// Constant time median in place of cv::medianBlur
+	if(command_line.has("ct-median"))
+		filters[2] = cvdemo::CONSTANT_TIME_MEDIAN_BLUR;
+
+	/// Bilateral grid approximation in place of cv::bilateralFilter
+	if(command_line.has("bilateral-grid"))
+		filters[3] = cvdemo::BILATERAL_GRID_BLUR;
+
+	/// Headless mode: every image is smoothed and the results are written to disk
+	cvdemo::BatchOptions batch = command_line.batch();
+	if(batch.enabled)
 	{
-		std::string input_file(argv[i]);
-		if(input_file.find_last_of(".jpg") != std::string::npos || input_file.find_last_of(".png") != std::string::npos)
+		cvdemo::BatchWriter writer(batch.output_dir);
+		display.set_writer(&writer);
+		return cvdemo::run_batch(batch, writer, [&writer](const cv::Mat &image, const std::string &)
 		{
-			image_file = input_file;
-		}
-		else 
-			show_help();
+			if( smoothing_demo(image) != 0 )
+				return -1;
+
+			/// The whole Gaussian stack goes in a single file next to the images
+			if( use_scale_space )
+			{
+				writer.stage("Gaussian scale space");
+				std::string file_name = writer.path(".yml.gz");
+				if( !cvdemo::write_scale_space(file_name, scale_space) )
+				{
+					std::cout << "Cannot write " << file_name << std::endl;
+					return -1;
+				}
+			}
+			return 0;
+		});
+	}
+
+	if(command_line.positional().empty())
+	{
+		show_help("Not enough parameters given.");
+		return -1;
 	}
 
-	if(image_file.length() == 0)
+	std::vector<std::string> image_files = command_line.images();
+	if(image_files.empty())
 	{
 		show_help("No valid file format given.");
 		return(-1);
 	}
 
 	/// Load the source image
-	src = cv::imread(image_file, 1 );
+	cv::Mat src = cv::imread(image_files.back(), 1 );
 	if(!src.data)
 	{
 		show_help("Image not valid.");
 		return(-1);
 	}
 
-	/// Create a window to display results
-	cv::namedWindow( window_name, cv::WINDOW_AUTOSIZE );
+	if(command_line.has("benchmark"))
+		return smoothing_benchmark( src, command_line.get_int("repeat", 3) );
 
-	if( display_caption( "Original Image" ) != 0 ) 
-		return 0;
+	if(command_line.has("median-benchmark"))
+		return median_benchmark( src, command_line.get_int("repeat", 3) );
 
-	dst = src.clone();
-	if( display_dst( DELAY_CAPTION ) != 0 )
-		return 0;
-  
-	/// Applying Homogeneous blur
-	if( display_caption( "Homogeneous Blur" ) != 0 )
-		return 0;
+	if(command_line.has("bilateral-benchmark"))
+		return bilateral_benchmark( src, command_line.get_int("repeat", 3) );
 
-	for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 )
-	{ 
-		cv::blur( src, dst, cv::Size( i, i ));
-		if( display_dst( DELAY_BLUR ) != 0 ) 
-			return 0;
+	/// Create a window to display results
+	display.open();
+
+	int result = smoothing_demo( src );
+
+	if( command_line.has("export") )
+	{
+		if( scale_space.levels.empty() )
+			cvdemo::gaussian_scale_space( src, kernel_sizes(), scale_space );
+		if( !cvdemo::write_scale_space( command_line.get("export"), scale_space ) )
+		{
+			show_help("Cannot write " + command_line.get("export"));
+			return -1;
+		}
+		std::cout << "Gaussian scale space written to " << command_line.get("export") << std::endl;
 	}
 
-	/// Applying Gaussian blur
-	if( display_caption( "Gaussian Blur" ) != 0 )
+	if( result != 0 )
 		return 0;
 
-	for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 )
-	{ 
-		GaussianBlur( src, dst, cv::Size( i, i ), 0, 0 );
-		if( display_dst( DELAY_BLUR ) != 0 )
-			return 0;
-	}
+	/// Wait until user press a key
+	display.caption( "End: Press a key!", src );
 
-	/// Applying Median blur
-	if( display_caption( "Median Blur" ) != 0 ) { return 0; }
+	display.wait();
 
-	for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 )
-	{ 
-		cv::medianBlur ( src, dst, i );
-		if( display_dst( DELAY_BLUR ) != 0 )
-			return 0; 
+	return 0;
+}
+
+/**
+ * @function smoothing_demo
+ * brief applies the smoothing filters to src, stops if a key is pressed
+ */
+int smoothing_demo( const cv::Mat &src )
+{
+	if( display.caption( "Original Image", src ) != 0 )
+		return -1;
+
+	if( display.show( src, DELAY_CAPTION ) != 0 )
+		return -1;
+
+	/// Applying Homogeneous, Gaussian, Median and Bilateral blur
+	const std::vector<int> sizes = kernel_sizes();
+	cv::Mat dst;
+	for ( int f = 0; f < 4; ++f )
+	{
+		if( display.caption( filter_names[f], src ) != 0 )
+			return -1;
+
+		if( use_scale_space && filters[f] == cvdemo::GAUSSIAN_BLUR )
+		{
+			/// The whole stack at once, every level from the previous one
+			cvdemo::gaussian_scale_space( src, sizes, scale_space );
+			for ( size_t i = 0; i < scale_space.levels.size(); ++i )
+			{
+				scale_space.levels[i].convertTo( dst, src.depth() );
+				if( display.show( dst, DELAY_BLUR ) != 0 )
+					return -1;
+			}
+			continue;
+		}
+
+		for ( size_t i = 0; i < sizes.size(); ++i )
+		{
+			apply_smoothing( src, dst, filters[f], sizes[i] );
+			if( display.show( dst, DELAY_BLUR ) != 0 )
+				return -1;
+		}
 	}
 
-	/// Applying Bilateral Filter
-	if( display_caption( "Bilateral Blur" ) != 0 )
-		return 0;
+	return 0;
+}
 
+/**
+ * @function kernel_sizes
+ * brief odd kernel sizes of the sweep, 1 ... MAX_KERNEL_LENGTH-2
+ */
+std::vector<int> kernel_sizes()
+{
+	std::vector<int> sizes;
 	for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 )
-	{ 
-		cv::bilateralFilter ( src, dst, i, i*2, i/2 );
-		if( display_dst( DELAY_BLUR ) != 0 ) 
-			return 0; 
+		sizes.push_back( i );
+	return sizes;
+}
+
+/**
+ * @function apply_smoothing
+ * brief runs the filter on the whole image, or tile by tile on the pool in tiled mode
+ */
+void apply_smoothing( const cv::Mat &src, cv::Mat &dst, cvdemo::SmoothingFilter filter, int kernel_size )
+{
+	if( pool )
+		cvdemo::smooth_tiled( src, dst, filter, kernel_size, *pool, tile_size );
+	else
+		cvdemo::smooth( src, dst, filter, kernel_size );
+}
+
+/**
+ * @function smoothing_benchmark
+ * brief times every filter and kernel size on the whole image and tiled on the pool, printed as ms per megapixel
+ */
+int smoothing_benchmark( const cv::Mat &src, int repeat )
+{
+	const double megapixels = src.total() / 1e6;
+	repeat = std::max( 1, repeat );
+
+	std::cout << "Image: " << src.cols << "x" << src.rows << " (" << megapixels << " MP), "
+	          << pool->size() << " threads, " << tile_size << "x" << tile_size << " tiles, best of " << repeat << " runs" << std::endl;
+	std::cout << std::left << std::setw(18) << "Filter" << std::right << std::setw(8) << "Kernel"
+	          << std::setw(16) << "whole ms/MP" << std::setw(16) << "tiled ms/MP" << std::setw(10) << "speedup" << std::setw(10) << "max diff" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	const int opencv_threads = cv::getNumThreads();
+	const std::vector<int> sizes = kernel_sizes();
+	cv::Mat whole, tiled;
+	for ( int f = 0; f < 4; ++f )
+	{
+		for ( size_t k = 0; k < sizes.size(); ++k )
+		{
+			const int i = sizes[k];
+			/// Whole image, with the threading of OpenCV
+			double whole_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::smooth( src, whole, filters[f], i ); } );
+
+			/// Tiled, OpenCV threading disabled so that the pool does not compete with it
+			cv::setNumThreads( 1 );
+			double tiled_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::smooth_tiled( src, tiled, filters[f], i, *pool, tile_size ); } );
+			cv::setNumThreads( opencv_threads );
+
+			std::cout << std::left << std::setw(18) << filter_names[f] << std::right << std::setw(8) << i
+			          << std::setw(16) << whole_ms / megapixels << std::setw(16) << tiled_ms / megapixels
+			          << std::setw(9) << whole_ms / tiled_ms << "x" << std::setw(10) << cv::norm( whole, tiled, cv::NORM_INF ) << std::endl;
+		}
 	}
 
-	/// Wait until user press a key
-	display_caption( "End: Press a key!" );
+	if( use_scale_space )
+	{
+		/// Whole Gaussian sweep: every kernel size from the source vs every level from the previous one, both in float
+		cv::Mat src_float;
+		src.convertTo( src_float, CV_32F );
+		std::vector<cv::Mat> direct( sizes.size() );
+
+		double direct_ms = cvdemo::best_time_ms( repeat, [&]()
+		{
+			for ( size_t k = 0; k < sizes.size(); ++k )
+				cvdemo::smooth( src_float, direct[k], cvdemo::GAUSSIAN_BLUR, sizes[k] );
+		});
+		double incremental_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::gaussian_scale_space( src, sizes, scale_space ); } );
 
-	cv::waitKey(0);
+		std::cout << std::endl << "Gaussian scale space (" << sizes.size() << " levels): direct " << direct_ms / megapixels
+		          << " ms/MP, incremental " << incremental_ms / megapixels << " ms/MP, speedup " << direct_ms / incremental_ms
+		          << "x" << std::endl;
+
+		/// The levels approximate the direct blur: error of every level, in grey levels
+		std::cout << std::setw(8) << "ksize" << std::setw(10) << "sigma" << std::setw(12) << "max diff" << std::setw(12) << "mean diff" << std::endl;
+		for ( size_t k = 0; k < sizes.size(); ++k )
+			std::cout << std::setw(8) << sizes[k] << std::setw(10) << scale_space.sigmas[k]
+			          << std::setw(12) << cv::norm( direct[k], scale_space.levels[k], cv::NORM_INF )
+			          << std::setw(12) << cv::norm( direct[k], scale_space.levels[k], cv::NORM_L1 ) / direct[k].total() / direct[k].channels() << std::endl;
+	}
 
 	return 0;
 }
 
 /**
- * @function display_caption
+ * @function median_benchmark
+ * brief times cv::medianBlur and the constant time median for kernel sizes 3 ... 99, printed as ms per megapixel
  */
-int display_caption( const char* caption )
+int median_benchmark( const cv::Mat &src, int repeat )
 {
-	dst = cv::Mat::zeros( src.size(), src.type() );
-	cv::putText( dst, caption,
-		cv::Point( src.cols/4, src.rows/2),
-		cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(255, 255, 255) );
-
-	cv::imshow( window_name, dst );
-	int c = cv::waitKey( DELAY_CAPTION );
-	if( c >= 0 ) { return -1; }
+	const double megapixels = src.total() / 1e6;
+	repeat = std::max( 1, repeat );
+
+	std::cout << "Image: " << src.cols << "x" << src.rows << "x" << src.channels() << " (" << megapixels << " MP), best of " << repeat << " runs" << std::endl;
+	std::cout << std::setw(8) << "Kernel" << std::setw(18) << "medianBlur ms/MP" << std::setw(16) << "O(1) ms/MP"
+	          << std::setw(10) << "speedup" << std::setw(10) << "max diff" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	cv::Mat reference, constant_time;
+	for ( int i = 3; i <= 99; i = i + 2 )
+	{
+		double reference_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::smooth( src, reference, cvdemo::MEDIAN_BLUR, i ); } );
+		double constant_time_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::median_filter( src, constant_time, i ); } );
+
+		std::cout << std::setw(8) << i << std::setw(18) << reference_ms / megapixels << std::setw(16) << constant_time_ms / megapixels
+		          << std::setw(9) << reference_ms / constant_time_ms << "x" << std::setw(10) << cv::norm( reference, constant_time, cv::NORM_INF ) << std::endl;
+	}
+
 	return 0;
 }
 
 /**
- * @function display_dst
+ * @function bilateral_benchmark
+ * brief times cv::bilateralFilter and the bilateral grid over the kernel sweep, with the PSNR of the approximation
  */
-int display_dst( int delay )
+int bilateral_benchmark( const cv::Mat &src, int repeat )
 {
-	cv::imshow( window_name, dst );
-	int c = cv::waitKey ( delay );
-	if( c >= 0 ) { return -1; }
+	const double megapixels = src.total() / 1e6;
+	repeat = std::max( 1, repeat );
+
+	std::cout << "Image: " << src.cols << "x" << src.rows << "x" << src.channels() << " (" << megapixels << " MP), best of " << repeat << " runs" << std::endl;
+	std::cout << std::setw(8) << "Kernel" << std::setw(16) << "exact ms/MP" << std::setw(15) << "grid ms/MP" << std::setw(10) << "speedup"
+	          << std::setw(10) << "grid fps" << std::setw(11) << "PSNR dB" << std::setw(8) << "mode" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	const std::vector<int> sizes = kernel_sizes();
+	cv::Mat exact, grid;
+	for ( size_t k = 0; k < sizes.size(); ++k )
+	{
+		const int i = sizes[k];
+		double exact_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::smooth( src, exact, cvdemo::BILATERAL_BLUR, i ); } );
+		double grid_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::smooth( src, grid, cvdemo::BILATERAL_GRID_BLUR, i ); } );
+		/// Small kernels would need a grid bigger than the image, there the exact filter is used
+		bool uses_grid = cvdemo::bilateral_grid_size( src.size(), i/2, i*2 ) <= src.total();
+
+		std::cout << std::setw(8) << i << std::setw(16) << exact_ms / megapixels << std::setw(15) << grid_ms / megapixels
+		          << std::setw(9) << exact_ms / grid_ms << "x" << std::setw(10) << 1000.0 / grid_ms
+		          << std::setw(11) << cvdemo::psnr( exact, grid ) << std::setw(8) << (uses_grid ? "grid" : "exact") << std::endl;
+	}
+
 	return 0;
 }
 
@@ -155,11 +360,9 @@ int display_dst( int delay )
  */
 void show_help(const std::string &message)
 {
-	std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-	std::cout << "Usage: cv_smoothing_d /path/to/image" << std::endl; 
-	#else
-	std::cout << "Usage: cv_smoothing /path/to/image" << std::endl; 
-	#endif
-	std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
+	cvdemo::show_help("cv_smoothing", { "/path/to/image [--tiled] [--threads N] [--tile S] [--scale-space] [--export <file.yml.gz>] [--ct-median] [--bilateral-grid]",
+	                                    "--benchmark [--threads N] [--tile S] [--repeat R] [--scale-space] [--ct-median] [--bilateral-grid] /path/to/image",
+	                                    "--median-benchmark [--repeat R] /path/to/image",
+	                                    "--bilateral-benchmark [--repeat R] /path/to/image",
+	                                    "--batch <dir|glob> --out <dir> [--tiled] [--threads N] [--tile S] [--scale-space] [--ct-median] [--bilateral-grid]" }, message);
 }
@@ -0,0 +1,854 @@
+/**
+ * Features
+ * brief sample code demonstrating keypoint extraction and matching with ORB, BRISK, SIFT or SURF.
+ * Built as cv_features (--detector chooses) and, with FEATURE_DETECTOR defined, as cv_orb, cv_brisk, cv_sift, cv_surf
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ * based on OpenCV Tutorials
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/descriptor_quantization.hpp>
+#include <cvdemo/feature_extraction.hpp>
+#include <cvdemo/flann_index.hpp>
+#include <cvdemo/geometric_verification.hpp>
+#include <cvdemo/hamming_matcher.hpp>
+#include <cvdemo/keypoint_tracking.hpp>
+#include <cvdemo/matching_engine.hpp>
+#include <cvdemo/multi_index_hashing.hpp>
+#include <cvdemo/timing.hpp>
+#include <cvdemo/video.hpp>
+
+#ifndef FEATURE_DETECTOR
+#define FEATURE_DETECTOR ""   /// default of --detector, empty for cv_features
+#endif
+
+/// Global Variables
+const int DELAY_CAPTION = 2000; /// 2 seconds
+
+cv::Mat image_full, image_template;
+cvdemo::Detector detector = cvdemo::DETECTOR_ORB;
+cvdemo::TiledDetection tiling;  /// --tile, --overlap, --cell, --per-cell
+cvdemo::VerificationOptions verification;  /// --ransac, --threshold
+cvdemo::FlannOptions flann;     /// --flann, --trees, --checks, --tables, --key-size, --probe, --flann-index
+cvdemo::QuantizationOptions quantization;  /// --quantize, --pca
+cvdemo::HashingOptions hashing;  /// --mih, --radius
+cvdemo::TrackingOptions tracking;  /// --track, --min-tracks, --keyframe-interval
+cvdemo::Display display( "Features Demo", DELAY_CAPTION );
+
+/// Function headers
+int features_demo();
+int run_stream( const cvdemo::StreamOptions &stream );
+int tracking_benchmark( const std::string &source, int max_frames );
+int detection_benchmark( const cv::Mat &image, int repeat );
+int verification_benchmark( int points, int repeat );
+int flann_benchmark( int queries, int train_size, int k, int repeat );
+int quantization_benchmark( const cv::Mat &query, const cv::Mat &train, int k, int repeat );
+double recall_at_k( const std::vector<std::vector<cv::DMatch> > &exact, const std::vector<std::vector<cv::DMatch> > &approximate );
+double grid_occupancy( const std::vector<cv::KeyPoint> &keypoints, const cv::Size &size, int cell_size, int &fullest );
+int hamming_benchmark( int queries, int train_size, int k, int bytes, int repeat );
+int mih_benchmark( int queries, int train_size, int k, int bytes, int noise, int max_radius, int repeat );
+void show_help(const std::string &message = "");
+
+/**
+ * function main
+ */
+int main(int argc, char **argv)
+{
+	cvdemo::CommandLine command_line(argc, argv, { "detector", "queries", "train", "k", "bytes", "repeat", "noise", "radius", "tile", "overlap", "cell", "per-cell", "threshold", "points", "flann", "trees", "checks", "tables", "key-size", "probe", "flann-index", "pca", "min-tracks", "keyframe-interval", "frames" });
+	if(!command_line.valid())
+	{
+		show_help(command_line.error());
+		return -1;
+	}
+
+	std::string detector_option = command_line.get("detector", FEATURE_DETECTOR);
+	if(!cvdemo::parse_detector(detector_option.empty() ? "orb" : detector_option, detector))
+	{
+		show_help("Unknown detector " + detector_option + ".");
+		return -1;
+	}
+	display = cvdemo::Display( cvdemo::detector_name(detector) + " Demo", DELAY_CAPTION );
+	tiling.tile_size = command_line.get_int("tile", 0);
+	tiling.overlap = command_line.get_int("overlap", tiling.overlap);
+	tiling.cell_size = command_line.get_int("cell", tiling.cell_size);
+	tiling.max_per_cell = command_line.get_int("per-cell", 0);
+	verification.prosac = !command_line.has("ransac");
+	verification.threshold = command_line.get_double("threshold", verification.threshold);
+	if(command_line.has("flann") && !cvdemo::parse_flann_algorithm(command_line.get("flann"), flann.algorithm))
+	{
+		show_help("Unknown FLANN index " + command_line.get("flann") + ".");
+		return -1;
+	}
+	flann.trees = command_line.get_int("trees", flann.trees);
+	flann.checks = command_line.get_int("checks", flann.checks);
+	flann.table_number = command_line.get_int("tables", flann.table_number);
+	flann.key_size = command_line.get_int("key-size", flann.key_size);
+	flann.multi_probe_level = command_line.get_int("probe", flann.multi_probe_level);
+	flann.index_path = command_line.get("flann-index");
+	quantization.enabled = command_line.has("quantize") || command_line.has("pca");
+	quantization.dimensions = command_line.get_int("pca", 0);
+	hashing.enabled = command_line.has("mih");
+	hashing.max_radius = command_line.get_int("radius", hashing.max_radius);
+	tracking.enabled = command_line.has("track");
+	tracking.min_tracks = command_line.get_int("min-tracks", tracking.min_tracks);
+	tracking.keyframe_interval = command_line.get_int("keyframe-interval", 0);
+
+	if(command_line.has("hamming-benchmark"))
+		return hamming_benchmark( command_line.get_int("queries", 10000), command_line.get_int("train", 100000),
+		                          command_line.get_int("k", 2), command_line.get_int("bytes", 32), command_line.get_int("repeat", 1) );
+
+	if(command_line.has("mih-benchmark"))
+		return mih_benchmark( command_line.get_int("queries", 10000), command_line.get_int("train", 100000),
+		                      command_line.get_int("k", 2), command_line.get_int("bytes", 32), command_line.get_int("noise", 24),
+		                      command_line.get_int("radius", 3), command_line.get_int("repeat", 1) );
+
+	const std::vector<std::string> &arguments = command_line.positional();
+
+	/// Headless mode: the template is matched against every image and the matches are written to disk
+	cvdemo::BatchOptions batch = command_line.batch();
+	if(batch.enabled)
+	{
+		if(arguments.empty())
+		{
+			show_help("No template image given.");
+			return -1;
+		}
+
+		image_template = cv::imread(arguments[0], 1 );
+		if(!image_template.data)
+		{
+			show_help("Template image not valid.");
+			return -1;
+		}
+
+		/// The FLANN index is built on the descriptors of every image, which no cache holds
+		if(!flann.index_path.empty())
+		{
+			std::cout << "--flann-index is ignored with --batch: the FLANN index is built on every image." << std::endl;
+			flann.index_path.clear();
+		}
+
+		cvdemo::BatchWriter writer(batch.output_dir);
+		display.set_writer(&writer);
+		return cvdemo::run_batch(batch, writer, [&writer](const cv::Mat &image, const std::string &)
+		{
+			image_full = image;
+			writer.stage("Matches");
+			return features_demo();
+		});
+	}
+
+	/// Stream mode: the template is located in every frame of the video
+	cvdemo::StreamOptions stream = command_line.stream();
+	if(stream.enabled)
+	{
+		image_template = arguments.empty() ? cv::Mat() : cv::imread(arguments[0], 1);
+		if(!image_template.data)
+		{
+			show_help("Template image not valid.");
+			return -1;
+		}
+		if(command_line.has("tracking-benchmark"))
+			return tracking_benchmark( stream.source, command_line.get_int("frames", 300) );
+		return run_stream( stream );
+	}
+
+	if(command_line.has("flann-benchmark"))
+		return flann_benchmark( command_line.get_int("queries", 2000), command_line.get_int("train", 50000),
+		                        command_line.get_int("k", 2), command_line.get_int("repeat", 1) );
+
+	if(command_line.has("quantization-benchmark"))
+	{
+		/// Descriptors of the two images with a float detector, synthetic SIFT-like descriptors otherwise
+		cv::Mat query, train;
+		if(arguments.size() >= 2)
+		{
+			cvdemo::KeypointMatches described;
+			cv::Mat full = cv::imread(arguments[0], 1), templ = cv::imread(arguments[1], 1);
+			if(!full.data || !templ.data || cvdemo::match_keypoints(detector, templ, full, described, tiling) != 0)
+			{
+				show_help("Images not valid or detector not available.");
+				return -1;
+			}
+			query = described.template_descriptors;
+			train = described.full_descriptors;
+			if(query.depth() != CV_32F)
+			{
+				show_help(cvdemo::detector_name(detector) + " descriptors are binary, use --detector sift or surf.");
+				return -1;
+			}
+		}
+		else
+		{
+			const int queries = std::max( 1, command_line.get_int("queries", 2000) ), train_size = std::max( 1, command_line.get_int("train", 50000) );
+			cv::RNG rng( 0x5eed );
+			/// Non negative mixtures of 16 patterns plus noise: correlated dimensions, as in real descriptors
+			cv::Mat patterns( 16, 128, CV_32F ), weights( train_size, 16, CV_32F ), noise( train_size, 128, CV_32F );
+			rng.fill( patterns, cv::RNG::UNIFORM, 0.0, 1.0 );
+			rng.fill( weights, cv::RNG::UNIFORM, 0.0, 10.0 );
+			rng.fill( noise, cv::RNG::NORMAL, 0.0, 2.0 );
+			cv::gemm( weights, patterns, 1.0, noise, 1.0, train );
+			query.create( queries, 128, CV_32F );
+			rng.fill( query, cv::RNG::NORMAL, 0.0, 2.0 );
+			for ( int q = 0; q < queries; ++q )
+				query.row(q) += train.row( rng.uniform( 0, train_size ) );
+		}
+		return quantization_benchmark( query, train, command_line.get_int("k", 2), command_line.get_int("repeat", 3) );
+	}
+
+	if(command_line.has("verification-benchmark"))
+		return verification_benchmark( command_line.get_int("points", 1000), command_line.get_int("repeat", 3) );
+
+	if(command_line.has("detection-benchmark"))
+	{
+		image_full = arguments.empty() ? cv::Mat() : cv::imread(arguments[0], 1);
+		if(!image_full.data)
+		{
+			show_help("Full image not valid.");
+			return -1;
+		}
+		return detection_benchmark( image_full, command_line.get_int("repeat", 3) );
+	}
+
+	if(arguments.size() < 2)
+	{
+		show_help("Not enough parameters given."); 
+		return 0;
+	}
+	
+	std::string image_file_full(arguments[0]), image_file_templ(arguments[1]);
+
+	if(!cvdemo::has_image_extension(image_file_full))
+	{
+		show_help("No valid file format given for first argument.");
+		return -1;
+	}
+
+	if(!cvdemo::has_image_extension(image_file_templ))
+	{
+		show_help("No valid file format given for second argument.");
+		return -1;
+	}
+
+	/// Load the full image
+	image_full = cv::imread(image_file_full, 1 );
+	if(!image_full.data)
+	{
+		show_help("Full image not valid.");
+		return -1;
+	}
+
+	/// Load the template image
+	image_template = cv::imread(image_file_templ, 1 );
+	if(!image_template.data)
+	{
+		show_help("Template image not valid.");
+		return -1;
+	}
+
+	/// Create a window to display results
+	display.open();
+
+	if( display.caption( "Full Image", image_full ) != 0 ) 
+		return -1;
+
+	if( display.show( image_full, DELAY_CAPTION ) != 0 )
+		return -1;
+
+	if( display.caption( "Template Image", image_full ) != 0 ) 
+		return -1;
+
+	if( display.show( image_template, DELAY_CAPTION ) != 0 )
+		return -1;
+  
+	if( display.caption( "Computing " + cvdemo::detector_name(detector) + " Matches", image_full ) != 0 ) 
+		return -1;
+
+	features_demo();
+	/// Wait until user press a key
+	display.caption( "End: Press a key!", image_full );
+
+	display.wait();
+
+	return 0;
+}
+
+/**
+ * @function features_demo
+ */
+int features_demo()
+{ 
+	try
+	{
+		/// Detection, extraction and matching
+		std::cout << "Computing the match..." << std::endl;
+		cvdemo::KeypointMatches result;
+		if(cvdemo::match_keypoints(detector, image_template, image_full, result, tiling, verification, flann, quantization, hashing) != 0)
+			return -1;
+
+		std::cout << result.matches.size() << " matches pass the ratio test, " << result.good_matches.size() << " inliers";
+		if(result.homography.empty())
+			std::cout << ": template not found" << std::endl;
+		else
+			std::cout << ", homography:" << std::endl << result.homography << std::endl;
+
+		/// Draw only "good" matches
+		cv::Mat img_matches;
+		cvdemo::draw_matches(image_template, image_full, result, img_matches);
+
+		/// Show detected matches
+		display.show( img_matches, 0 );
+		return 0;
+	}
+	catch(cv::Exception &ex)
+	{
+		std::cout << "Got exception: " << ex.what() << std::endl;
+		return -1;
+	}
+}
+
+/**
+ * @function grid_occupancy
+ * brief fraction of the cells of the bucketing grid holding at least one keypoint, and keypoints in the fullest cell
+ */
+double grid_occupancy( const std::vector<cv::KeyPoint> &keypoints, const cv::Size &size, int cell_size, int &fullest )
+{
+	cell_size = std::max( 1, cell_size );
+	cv::Mat counts = cv::Mat::zeros( (size.height + cell_size - 1) / cell_size, (size.width + cell_size - 1) / cell_size, CV_32SC1 );
+	for ( size_t k = 0; k < keypoints.size(); ++k )
+	{
+		const int x = std::min( counts.cols - 1, std::max( 0, cvFloor(keypoints[k].pt.x / cell_size) ) );
+		const int y = std::min( counts.rows - 1, std::max( 0, cvFloor(keypoints[k].pt.y / cell_size) ) );
+		++counts.at<int>(y, x);
+	}
+	double max_count = 0.0;
+	cv::minMaxIdx( counts, 0, &max_count );
+	fullest = static_cast<int>(max_count);
+	return static_cast<double>(cv::countNonZero(counts)) / counts.total();
+}
+
+/**
+ * @function detection_benchmark
+ * brief times detect() followed by compute(), a single detectAndCompute, and the tiled detection with and without
+ * bucketing, with the number of keypoints and how evenly they cover the image
+ */
+int detection_benchmark( const cv::Mat &image, int repeat )
+{
+	repeat = std::max( 1, repeat );
+	cv::Ptr<cv::Feature2D> feature_detector = cvdemo::create_detector( detector );
+	if ( feature_detector.empty() )
+		return -1;
+
+	cvdemo::TiledDetection tiled = tiling;
+	if ( tiled.tile_size <= 0 )
+		tiled.tile_size = 512;
+	cvdemo::TiledDetection bucketed = tiled;
+	if ( bucketed.max_per_cell <= 0 )
+		bucketed.max_per_cell = 8;
+	tiled.max_per_cell = 0;
+	if ( tiled.overlap < 0 )
+		tiled.overlap = bucketed.overlap = cvdemo::detector_border( detector );
+
+	std::cout << "Image: " << image.cols << "x" << image.rows << ", " << cvdemo::detector_name(detector) << ", tiles of "
+	          << tiled.tile_size << " px with " << tiled.overlap << " px overlap, cells of " << tiled.cell_size << " px, "
+	          << cv::getNumThreads() << " threads, best of " << repeat << " runs" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::setw(26) << "Detection" << std::setw(12) << "ms" << std::setw(12) << "keypoints"
+	          << std::setw(16) << "cells covered" << std::setw(10) << "fullest" << std::endl;
+
+	const char *names[] = { "detect + compute", "detectAndCompute", "tiled", "tiled + bucketing" };
+	for ( int mode = 0; mode < 4; ++mode )
+	{
+		std::vector<cv::KeyPoint> keypoints;
+		cv::Mat descriptors;
+		double ms = cvdemo::best_time_ms( repeat, [&]()
+		{
+			if ( mode == 0 )
+			{
+				feature_detector->detect( image, keypoints );
+				feature_detector->compute( image, keypoints, descriptors );
+			}
+			else if ( mode == 1 )
+				cvdemo::detect_and_compute( feature_detector, image, keypoints, descriptors );
+			else
+				cvdemo::detect_and_compute_tiled( detector, image, mode == 2 ? tiled : bucketed, keypoints, descriptors );
+		});
+
+		int fullest = 0;
+		const double covered = grid_occupancy( keypoints, image.size(), tiled.cell_size, fullest );
+		std::cout << std::setw(26) << names[mode] << std::setw(12) << ms << std::setw(12) << keypoints.size()
+		          << std::setw(15) << covered * 100.0 << "%" << std::setw(10) << fullest << std::endl;
+	}
+
+	return 0;
+}
+
+/**
+ * @function verification_benchmark
+ * brief times RANSAC, PROSAC and cv::findHomography(RANSAC) on synthetic matches of a known homography for decreasing
+ * inlier ratios. Inliers are moved by a pixel of noise at most, outliers are random; the inliers tend to have smaller
+ * descriptor distances, as real matches do, which is what PROSAC exploits
+ */
+int verification_benchmark( int points, int repeat )
+{
+	points = std::max( 8, points );
+	repeat = std::max( 1, repeat );
+
+	const double truth_data[] = { 0.9, -0.15, 120.0, 0.2, 1.1, 40.0, 1e-4, -2e-4, 1.0 };
+	const cv::Mat truth( 3, 3, CV_64F, const_cast<double*>(truth_data) );
+	cvdemo::VerificationOptions options = verification;
+	options.max_iterations = 20000;
+
+	std::cout << "Matches: " << points << ", threshold " << options.threshold << " px, confidence " << options.confidence
+	          << ", at most " << options.max_iterations << " iterations, best of " << repeat << " runs" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::setw(10) << "inliers" << std::setw(12) << "RANSAC ms" << std::setw(8) << "iter" << std::setw(9) << "found"
+	          << std::setw(12) << "PROSAC ms" << std::setw(8) << "iter" << std::setw(9) << "found"
+	          << std::setw(14) << "OpenCV ms" << std::setw(9) << "found" << std::endl;
+
+	const double ratios[] = { 0.9, 0.7, 0.5, 0.3, 0.2, 0.1 };
+	for ( int r = 0; r < 6; ++r )
+	{
+		cv::RNG rng( 0x5eed + r );
+		std::vector<cv::DMatch> matches( points );
+		std::vector<cv::Point2f> src( points ), dst( points );
+		const int num_inliers = static_cast<int>( ratios[r] * points );
+		for ( int i = 0; i < points; ++i )
+		{
+			std::vector<cv::Point2f> point( 1, cv::Point2f( rng.uniform(0.f, 640.f), rng.uniform(0.f, 480.f) ) ), moved;
+			cv::perspectiveTransform( point, moved, truth );
+			const bool inlier = i < num_inliers;
+			src[i] = point[0];
+			dst[i] = inlier ? moved[0] + cv::Point2f( rng.uniform(-0.7f, 0.7f), rng.uniform(-0.7f, 0.7f) )
+			                : cv::Point2f( rng.uniform(0.f, 1280.f), rng.uniform(0.f, 960.f) );
+			matches[i] = cv::DMatch( i, i, inlier ? rng.uniform(0.f, 1.f) : rng.uniform(0.3f, 1.3f) );
+		}
+
+		/// Best matches first, as after the ratio test
+		std::stable_sort( matches.begin(), matches.end(), [](const cv::DMatch &a, const cv::DMatch &b) { return a.distance < b.distance; } );
+		std::vector<cv::Point2f> sorted_src, sorted_dst;
+		for ( int i = 0; i < points; ++i )
+		{
+			sorted_src.push_back( src[matches[i].queryIdx] );
+			sorted_dst.push_back( dst[matches[i].trainIdx] );
+		}
+
+		cv::Mat homography;
+		std::vector<uchar> mask;
+		int found[2] = { 0, 0 }, iterations[2] = { 0, 0 };
+		double ms[2];
+		for ( int prosac = 0; prosac < 2; ++prosac )
+		{
+			options.prosac = prosac == 1;
+			ms[prosac] = cvdemo::best_time_ms( repeat, [&]()
+			{
+				found[prosac] = cvdemo::estimate_homography( sorted_src, sorted_dst, options, homography, mask, &iterations[prosac] );
+			});
+		}
+
+		int opencv_found = 0;
+		double opencv_ms = cvdemo::best_time_ms( repeat, [&]()
+		{
+			cv::findHomography( sorted_src, sorted_dst, cv::RANSAC, options.threshold, mask );
+			opencv_found = cv::countNonZero( mask );
+		});
+
+		std::cout << std::setw(9) << ratios[r] * 100.0 << "%" << std::setw(12) << ms[0] << std::setw(8) << iterations[0] << std::setw(9) << found[0]
+		          << std::setw(12) << ms[1] << std::setw(8) << iterations[1] << std::setw(9) << found[1]
+		          << std::setw(14) << opencv_ms << std::setw(9) << opencv_found << std::endl;
+	}
+
+	return 0;
+}
+
+/**
+ * @function recall_at_k
+ * brief fraction of the exact k nearest neighbours found by the approximate search (equal distances count as found)
+ */
+double recall_at_k( const std::vector<std::vector<cv::DMatch> > &exact, const std::vector<std::vector<cv::DMatch> > &approximate )
+{
+	size_t found = 0, expected = 0;
+	for ( size_t q = 0; q < exact.size() && q < approximate.size(); ++q )
+	{
+		if ( exact[q].empty() )
+			continue;
+		const float kth_distance = exact[q].back().distance * 1.0001f;
+		expected += exact[q].size();
+		for ( size_t r = 0; r < approximate[q].size(); ++r )
+			if ( approximate[q][r].distance <= kth_distance )
+				++found;
+	}
+	return static_cast<double>(found) / std::max<size_t>( 1, expected );
+}
+
+/**
+ * @function flann_benchmark
+ * brief sweeps the parameters of the FLANN indices against brute force: KD-trees on clustered 128 float descriptors
+ * (SIFT-like), LSH on 256 bit descriptors (ORB-like), queries close to train descriptors. Reports build time, query
+ * time and recall@k, then the time to save and load the default KD-tree index against building it
+ */
+int flann_benchmark( int queries, int train_size, int k, int repeat )
+{
+	queries = std::max( 1, queries );
+	train_size = std::max( 1, train_size );
+	k = std::max( 1, k );
+	repeat = std::max( 1, repeat );
+	cv::RNG rng( 0x5eed );
+
+	/// Float descriptors around 1 center every 50 descriptors
+	cv::Mat centers( std::max( 1, train_size / 50 ), 128, CV_32F ), train( train_size, 128, CV_32F ), query( queries, 128, CV_32F );
+	rng.fill( centers, cv::RNG::UNIFORM, 0.0, 100.0 );
+	rng.fill( train, cv::RNG::NORMAL, 0.0, 10.0 );
+	for ( int i = 0; i < train_size; ++i )
+		train.row(i) += centers.row( i % centers.rows );
+	rng.fill( query, cv::RNG::NORMAL, 0.0, 3.0 );
+	for ( int q = 0; q < queries; ++q )
+		query.row(q) += train.row( rng.uniform( 0, train_size ) );
+
+	/// Binary descriptors with 24 of 256 bits flipped
+	cv::Mat binary_train( train_size, 32, CV_8UC1 ), binary_query( queries, 32, CV_8UC1 );
+	cv::randu( binary_train, cv::Scalar::all(0), cv::Scalar::all(256) );
+	for ( int q = 0; q < queries; ++q )
+	{
+		binary_train.row( rng.uniform( 0, train_size ) ).copyTo( binary_query.row(q) );
+		for ( int n = 0; n < 24; ++n )
+		{
+			const int bit = rng.uniform( 0, 256 );
+			binary_query.at<uchar>(q, bit / 8) ^= static_cast<uchar>( 1 << (bit % 8) );
+		}
+	}
+
+	std::vector<std::vector<cv::DMatch> > exact, binary_exact, approximate;
+	cv::BFMatcher l2_matcher( cv::NORM_L2 ), hamming_matcher( cv::NORM_HAMMING );
+	double l2_ms = cvdemo::best_time_ms( repeat, [&]() { l2_matcher.knnMatch( query, train, exact, k ); } );
+	double hamming_ms = cvdemo::best_time_ms( repeat, [&]() { hamming_matcher.knnMatch( binary_query, binary_train, binary_exact, k ); } );
+
+	std::cout << "Descriptors: " << queries << " queries x " << train_size << " train, k = " << k << ", best of " << repeat << " runs" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "KD-trees, 128 floats (brute force " << l2_ms << " ms)" << std::endl;
+	std::cout << std::setw(8) << "trees" << std::setw(8) << "checks" << std::setw(12) << "build ms" << std::setw(12) << "query ms"
+	          << std::setw(10) << "speedup" << std::setw(12) << "recall@" + std::to_string(k) << std::endl;
+
+	const int trees[] = { 1, 4, 8 };
+	const int checks[] = { 16, 64, 256 };
+	cvdemo::FlannOptions options;
+	options.algorithm = cvdemo::FlannOptions::KDTREE;
+	for ( int t = 0; t < 3; ++t )
+	{
+		cvdemo::FlannIndex index;
+		options.trees = trees[t];
+		double build_ms = cvdemo::best_time_ms( 1, [&]() { index.build( train, options ); } );
+		for ( int c = 0; c < 3; ++c )
+		{
+			index.set_checks( checks[c] );
+			double query_ms = cvdemo::best_time_ms( repeat, [&]() { index.knn_match( query, approximate, k ); } );
+			std::cout << std::setw(8) << trees[t] << std::setw(8) << checks[c] << std::setw(12) << build_ms << std::setw(12) << query_ms
+			          << std::setw(9) << l2_ms / query_ms << "x" << std::setw(12) << recall_at_k( exact, approximate ) << std::endl;
+		}
+	}
+
+	std::cout << "LSH, 256 bits (brute force " << hamming_ms << " ms)" << std::endl;
+	std::cout << std::setw(8) << "tables" << std::setw(8) << "key" << std::setw(12) << "build ms" << std::setw(12) << "query ms"
+	          << std::setw(10) << "speedup" << std::setw(12) << "recall@" + std::to_string(k) << std::endl;
+
+	const int tables[] = { 4, 8, 12 };
+	const int keys[] = { 12, 16, 20 };
+	options.algorithm = cvdemo::FlannOptions::LSH;
+	for ( int t = 0; t < 3; ++t )
+		for ( int b = 0; b < 3; ++b )
+		{
+			cvdemo::FlannIndex index;
+			options.table_number = tables[t];
+			options.key_size = keys[b];
+			double build_ms = cvdemo::best_time_ms( 1, [&]() { index.build( binary_train, options ); } );
+			double query_ms = cvdemo::best_time_ms( repeat, [&]() { index.knn_match( binary_query, approximate, k ); } );
+			std::cout << std::setw(8) << tables[t] << std::setw(8) << keys[b] << std::setw(12) << build_ms << std::setw(12) << query_ms
+			          << std::setw(9) << hamming_ms / query_ms << "x" << std::setw(12) << recall_at_k( binary_exact, approximate ) << std::endl;
+		}
+
+	/// A prebuilt index of a fixed reference set is loaded instead of built
+	cvdemo::FlannIndex index, loaded;
+	options = cvdemo::FlannOptions();
+	options.algorithm = cvdemo::FlannOptions::KDTREE;
+	const std::string path = cv::tempfile( ".flann" );
+	double build_ms = cvdemo::best_time_ms( 1, [&]() { index.build( train, options ); } );
+	double save_ms = cvdemo::best_time_ms( 1, [&]() { index.save( path ); } );
+	bool load_ok = false;
+	double load_ms = cvdemo::best_time_ms( 1, [&]() { load_ok = loaded.load( path ); } );
+	std::remove( path.c_str() );
+	std::remove( (path + ".train").c_str() );
+	std::cout << "KD-tree index (4 trees): build " << build_ms << " ms, save " << save_ms << " ms, load " << load_ms << " ms"
+	          << (load_ok ? "" : " (load failed)") << std::endl;
+
+	return 0;
+}
+
+/**
+ * @function run_stream
+ * brief locates the template in every frame, tracking the keypoints between keyframes with --track
+ */
+int run_stream( const cvdemo::StreamOptions &stream )
+{
+	cvdemo::TemplateTracker tracker( detector, tracking, tiling, verification );
+	if ( !tracker.set_template( image_template ) )
+	{
+		std::cout << "No valid keypoints found for template image (or " << cvdemo::detector_name(detector) << " not available)." << std::endl;
+		return -1;
+	}
+	if ( !stream.headless )
+		display.open();
+
+	const cv::Size template_size = image_template.size();
+	int status = cvdemo::run_stream( stream, display, [&tracker, template_size](const cv::Mat &frame, cv::Mat &result)
+	{
+		cvdemo::TrackedFrame tracked;
+		tracker.track( frame, tracked );
+		cvdemo::draw_tracked( frame, template_size, tracked, result );
+	});
+	std::cout << "Keyframes: " << tracker.keyframes() << std::endl;
+	return status;
+}
+
+/**
+ * @function tracking_benchmark
+ * brief locates the template in the first frames of the video twice, tracking between keyframes and detecting every
+ * frame: per-frame latency (average, 95th percentile, max), keyframes and frames where the template is found.
+ * The frames are decoded once before timing
+ */
+int tracking_benchmark( const std::string &source, int max_frames )
+{
+	cv::VideoCapture capture;
+	if ( !cvdemo::open_capture( source, capture ) )
+	{
+		std::cout << "Cannot open " << source << std::endl;
+		return -1;
+	}
+
+	std::vector<cv::Mat> frames;
+	cv::Mat frame;
+	while ( (max_frames <= 0 || static_cast<int>(frames.size()) < max_frames) && capture.read( frame ) )
+		frames.push_back( frame.clone() );
+	if ( frames.empty() )
+	{
+		std::cout << "No frames read from " << source << std::endl;
+		return -1;
+	}
+
+	std::cout << "Frames: " << frames.size() << " of " << frames[0].cols << "x" << frames[0].rows << ", "
+	          << cvdemo::detector_name(detector) << ", at least " << tracking.min_tracks << " tracks" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::setw(12) << "mode" << std::setw(10) << "avg ms" << std::setw(10) << "p95 ms" << std::setw(10) << "max ms"
+	          << std::setw(11) << "keyframes" << std::setw(8) << "found" << std::endl;
+
+	double average[2] = { 0.0, 0.0 };
+	for ( int mode = 0; mode < 2; ++mode )
+	{
+		cvdemo::TrackingOptions options = tracking;
+		options.enabled = mode == 0;
+		cvdemo::TemplateTracker tracker( detector, options, tiling, verification );
+		if ( !tracker.set_template( image_template ) )
+		{
+			std::cout << "No valid keypoints found for template image (or " << cvdemo::detector_name(detector) << " not available)." << std::endl;
+			return -1;
+		}
+
+		std::vector<double> latencies;
+		size_t found = 0;
+		for ( size_t i = 0; i < frames.size(); ++i )
+		{
+			cvdemo::TrackedFrame tracked;
+			tracker.track( frames[i], tracked );
+			latencies.push_back( tracked.ms );
+			if ( tracked.found() )
+				++found;
+		}
+
+		std::sort( latencies.begin(), latencies.end() );
+		for ( size_t i = 0; i < latencies.size(); ++i )
+			average[mode] += latencies[i] / latencies.size();
+		std::cout << std::setw(12) << (mode == 0 ? "tracking" : "detection") << std::setw(10) << average[mode]
+		          << std::setw(10) << latencies[std::min( latencies.size() - 1, latencies.size() * 95 / 100 )]
+		          << std::setw(10) << latencies.back() << std::setw(11) << tracker.keyframes() << std::setw(8) << found << std::endl;
+	}
+	std::cout << "Tracking speedup: " << average[1] / std::max( average[0], 1e-9 ) << "x" << std::endl;
+
+	return 0;
+}
+
+/**
+ * @function quantization_benchmark
+ * brief matches the float descriptors as they are, quantized to bytes and PCA-reduced to 64 and 32 dimensions then
+ * quantized: memory per descriptor, matching time and throughput, recall@k against the float matching (the returned
+ * neighbours are judged by their float distance)
+ */
+int quantization_benchmark( const cv::Mat &query, const cv::Mat &train, int k, int repeat )
+{
+	k = std::max( 1, k );
+	repeat = std::max( 1, repeat );
+
+	std::vector<std::vector<cv::DMatch> > exact, approximate;
+	double float_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::knn_match_descriptors<cvdemo::L2Norm>( query, train, exact, k ); } );
+	const double pairs = static_cast<double>(query.rows) * train.rows;
+
+	std::cout << "Descriptors: " << query.rows << " queries x " << train.rows << " train, " << train.cols << " floats, k = " << k
+	          << ", best of " << repeat << " runs" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::setw(12) << "form" << std::setw(10) << "bytes" << std::setw(12) << "train ms" << std::setw(12) << "match ms"
+	          << std::setw(14) << "Mpairs/s" << std::setw(12) << "recall@" + std::to_string(k) << std::endl;
+	std::cout << std::setw(12) << "float" << std::setw(10) << train.cols * sizeof(float) << std::setw(12) << 0.0 << std::setw(12) << float_ms
+	          << std::setw(14) << pairs / float_ms / 1000.0 << std::setw(12) << 1.0 << std::endl;
+
+	const int dimensions[] = { 0, 64, 32 };
+	for ( int d = 0; d < 3; ++d )
+	{
+		if ( dimensions[d] >= train.cols )
+			continue;
+		cvdemo::QuantizationOptions options;
+		options.enabled = true;
+		options.dimensions = dimensions[d];
+
+		cvdemo::DescriptorQuantizer quantizer;
+		cv::Mat compact_query, compact_train;
+		double train_ms = cvdemo::best_time_ms( 1, [&]()
+		{
+			quantizer.train( train, options );
+			quantizer.quantize( train, compact_train );
+		});
+		quantizer.quantize( query, compact_query );
+		double match_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::knn_match_descriptors<cvdemo::L2ByteNorm>( compact_query, compact_train, approximate, k ); } );
+
+		/// Recall on the float distances of the neighbours found in the compact form
+		for ( size_t q = 0; q < approximate.size(); ++q )
+			for ( size_t i = 0; i < approximate[q].size(); ++i )
+				approximate[q][i].distance = static_cast<float>( cv::norm( query.row(q), train.row( approximate[q][i].trainIdx ), cv::NORM_L2 ) );
+
+		const std::string form = options.pca( train.cols ) ? "PCA " + std::to_string(quantizer.dimensions()) : "uint8";
+		std::cout << std::setw(12) << form << std::setw(10) << quantizer.dimensions() << std::setw(12) << train_ms << std::setw(12) << match_ms
+		          << std::setw(14) << pairs / match_ms / 1000.0 << std::setw(12) << recall_at_k( exact, approximate ) << std::endl;
+	}
+
+	return 0;
+}
+
+/**
+ * @function hamming_benchmark
+ * brief times the k nearest neighbours of random binary descriptors with the SIMD matcher of the library
+ * against cv::BFMatcher(cv::NORM_HAMMING), and compares their distances rank by rank
+ */
+int hamming_benchmark( int queries, int train_size, int k, int bytes, int repeat )
+{
+	queries = std::max( 1, queries );
+	train_size = std::max( 1, train_size );
+	k = std::max( 1, k );
+	bytes = std::max( 1, bytes );
+	repeat = std::max( 1, repeat );
+
+	cv::Mat query( queries, bytes, CV_8UC1 ), train( train_size, bytes, CV_8UC1 );
+	cv::randu( query, cv::Scalar::all(0), cv::Scalar::all(256) );
+	cv::randu( train, cv::Scalar::all(0), cv::Scalar::all(256) );
+
+	std::vector<std::vector<cv::DMatch> > simd_matches, cv_matches;
+	cv::BFMatcher matcher( cv::NORM_HAMMING );
+	double cv_ms = cvdemo::best_time_ms( repeat, [&]() { matcher.knnMatch( query, train, cv_matches, k ); } );
+	double simd_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::hamming_knn_match( query, train, simd_matches, k ); } );
+
+	/// Equal distances may be ordered differently, so only the distances are compared
+	size_t mismatches = 0;
+	for ( size_t q = 0; q < cv_matches.size(); ++q )
+	{
+		if ( q >= simd_matches.size() || simd_matches[q].size() != cv_matches[q].size() )
+		{
+			++mismatches;
+			continue;
+		}
+		for ( size_t r = 0; r < cv_matches[q].size(); ++r )
+			if ( simd_matches[q][r].distance != cv_matches[q][r].distance )
+				++mismatches;
+	}
+
+	const double comparisons = static_cast<double>(queries) * train_size;
+	std::cout << "Descriptors: " << queries << " queries x " << train_size << " train, " << bytes * 8 << " bits, k = " << k
+	          << ", " << cvdemo::hamming_kernel_name() << " kernel, " << cv::getNumThreads() << " threads, best of " << repeat << " runs" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "cv::BFMatcher:  " << std::setw(10) << cv_ms << " ms, " << comparisons / cv_ms / 1e6 << " G comparisons/s" << std::endl;
+	std::cout << "SIMD matcher:   " << std::setw(10) << simd_ms << " ms, " << comparisons / simd_ms / 1e6 << " G comparisons/s, "
+	          << cv_ms / simd_ms << "x" << std::endl;
+	std::cout << "Distance mismatches: " << mismatches << std::endl;
+
+	return 0;
+}
+
+/**
+ * @function mih_benchmark
+ * brief times the multi-index hashing search for every substring radius up to max_radius against
+ * cv::BFMatcher(cv::NORM_HAMMING), and reports its recall@k: the fraction of the exact k nearest neighbours found
+ * (equal distances count as found). The queries are train descriptors with noise random bits flipped,
+ * as the descriptors of the same keypoint seen in two images
+ */
+int mih_benchmark( int queries, int train_size, int k, int bytes, int noise, int max_radius, int repeat )
+{
+	queries = std::max( 1, queries );
+	train_size = std::max( 1, train_size );
+	k = std::max( 1, k );
+	bytes = std::max( 2, bytes / 2 * 2 );
+	noise = std::max( 0, noise );
+	repeat = std::max( 1, repeat );
+
+	cv::Mat query( queries, bytes, CV_8UC1 ), train( train_size, bytes, CV_8UC1 );
+	cv::randu( train, cv::Scalar::all(0), cv::Scalar::all(256) );
+	cv::RNG rng( 0x5eed );
+	for ( int q = 0; q < queries; ++q )
+	{
+		train.row( rng.uniform( 0, train_size ) ).copyTo( query.row(q) );
+		uchar *descriptor = query.ptr<uchar>(q);
+		for ( int n = 0; n < noise; ++n )
+		{
+			const int bit = rng.uniform( 0, bytes * 8 );
+			descriptor[bit / 8] ^= static_cast<uchar>( 1 << (bit % 8) );
+		}
+	}
+
+	std::vector<std::vector<cv::DMatch> > exact_matches, mih_matches;
+	cv::BFMatcher matcher( cv::NORM_HAMMING );
+	double cv_ms = cvdemo::best_time_ms( repeat, [&]() { matcher.knnMatch( query, train, exact_matches, k ); } );
+
+	cvdemo::MultiIndexHashing index;
+	double build_ms = cvdemo::best_time_ms( 1, [&]() { index.build( train ); } );
+
+	std::cout << "Descriptors: " << queries << " queries x " << train_size << " train, " << bytes * 8 << " bits, "
+	          << noise << " bits of noise, k = " << k << ", " << index.substrings() << " substrings of 16 bits, "
+	          << cv::getNumThreads() << " threads, best of " << repeat << " runs" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "cv::BFMatcher: " << cv_ms << " ms; index built in " << build_ms << " ms" << std::endl;
+	std::cout << std::setw(8) << "radius" << std::setw(12) << "ms" << std::setw(10) << "speedup" << std::setw(14) << "candidates"
+	          << std::setw(12) << "recall@" + std::to_string(k) << std::endl;
+
+	for ( int radius = 0; radius <= max_radius; ++radius )
+	{
+		double candidates = 0.0;
+		double mih_ms = cvdemo::best_time_ms( repeat, [&]() { index.knn_match( query, mih_matches, k, radius, &candidates ); } );
+
+		std::cout << std::setw(8) << radius << std::setw(12) << mih_ms << std::setw(9) << cv_ms / mih_ms << "x"
+		          << std::setw(14) << candidates << std::setw(12) << recall_at_k( exact_matches, mih_matches ) << std::endl;
+	}
+
+	return 0;
+}
+
+/**
+ * @function show_help
+ */
+void show_help(const std::string &message)
+{
+	const std::string name(FEATURE_DETECTOR);
+	cvdemo::show_help(name.empty() ? "cv_features" : "cv_" + name, { "[--detector <orb|brisk|sift|surf>] [--tile <px>] [--overlap <px>] [--cell <px>] [--per-cell <n>] [--ransac] [--threshold <px>] [--flann <kdtree|lsh>] [--trees <n>] [--checks <n>] [--tables <n>] [--key-size <bits>] [--probe <n>] [--flann-index <file>] [--quantize] [--pca <dims>] [--mih] [--radius <n>] /path/to/full/image /path/to/template/image", "--quantization-benchmark [--queries <n>] [--train <n>] [--k <n>] [--repeat <n>] [/path/to/full/image /path/to/template/image]", "--flann-benchmark [--queries <n>] [--train <n>] [--k <n>] [--repeat <n>]", "--verification-benchmark [--points <n>] [--threshold <px>] [--repeat <n>]", "--detection-benchmark [--detector <orb|brisk|sift|surf>] [--tile <px>] [--overlap <px>] [--cell <px>] [--per-cell <n>] [--repeat <n>] /path/to/full/image", "--video <file|camera index> [--track] [--min-tracks <n>] [--keyframe-interval <n>] [--record <file.avi>] [--headless] /path/to/template/image", "--tracking-benchmark --video <file|camera index> [--frames <n>] [--min-tracks <n>] [--keyframe-interval <n>] /path/to/template/image", "--batch <dir|glob> --out <dir> [--detector <orb|brisk|sift|surf>] [--flann <kdtree|lsh>] [--mih] [--radius <n>] /path/to/template/image", "--hamming-benchmark [--queries <n>] [--train <n>] [--k <n>] [--bytes <32|64>] [--repeat <n>]", "--mih-benchmark [--queries <n>] [--train <n>] [--k <n>] [--bytes <32|64>] [--noise <bits>] [--radius <n>] [--repeat <n>]" }, message);
+}
@@ -0,0 +1,183 @@
+/**
+ * Index
+ * brief sample code building a persistent descriptor index of an image collection and finding the images
+ * which contain a template by matching against the index only
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/highgui/highgui.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/descriptor_index.hpp>
+#include <cvdemo/feature_extraction.hpp>
+#include <cvdemo/multi_index_hashing.hpp>
+
+/// Function headers
+int build_index( const std::string &index_path, cvdemo::Detector detector, const std::string &images );
+int query_index( const std::string &index_path, const std::string &template_file, int min_matches, float ratio, int top,
+                 const cvdemo::HashingOptions &hashing, int neighbours );
+void show_help(const std::string &message = "");
+
+/**
+ * function main
+ */
+int main(int argc, char **argv)
+{
+	cvdemo::CommandLine command_line(argc, argv, { "build", "query", "detector", "min-matches", "ratio", "top", "radius", "k" });
+	if(!command_line.valid())
+	{
+		show_help(command_line.error());
+		return -1;
+	}
+
+	const std::vector<std::string> &arguments = command_line.positional();
+	if(arguments.empty() || command_line.has("build") == command_line.has("query"))
+	{
+		show_help("Not enough parameters given.");
+		return -1;
+	}
+
+	try
+	{
+		if(command_line.has("build"))
+		{
+			cvdemo::Detector detector = cvdemo::DETECTOR_ORB;
+			const std::string detector_option = command_line.get("detector", "orb");
+			if(!cvdemo::parse_detector(detector_option, detector))
+			{
+				show_help("Unknown detector " + detector_option + ".");
+				return -1;
+			}
+			return build_index( command_line.get("build"), detector, arguments[0] );
+		}
+
+		cvdemo::HashingOptions hashing;
+		hashing.enabled = command_line.has("mih");
+		hashing.max_radius = command_line.get_int("radius", hashing.max_radius);
+		return query_index( command_line.get("query"), arguments[0], command_line.get_int("min-matches", 10),
+		                    static_cast<float>(command_line.get_double("ratio", 0.8)), command_line.get_int("top", 10),
+		                    hashing, command_line.get_int("k", 16) );
+	}
+	catch(cv::Exception &ex)
+	{
+		std::cout << "Got exception: " << ex.what() << std::endl;
+		return -1;
+	}
+}
+
+/**
+ * @function build_index
+ * brief describes every image of the directory or glob once and writes the index
+ */
+int build_index( const std::string &index_path, cvdemo::Detector detector, const std::string &images )
+{
+	std::vector<std::string> image_files = cvdemo::list_images(images);
+	if(image_files.empty())
+	{
+		std::cout << "No images found in " << images << std::endl;
+		return -1;
+	}
+
+	std::cout << "Indexing " << image_files.size() << " images with " << cvdemo::detector_name(detector) << "..." << std::endl;
+	int64 start = cv::getTickCount();
+	int64 num_descriptors = cvdemo::build_descriptor_index( detector, image_files, index_path );
+	double seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+	if(num_descriptors < 0)
+	{
+		std::cout << "Cannot build " << index_path << " (" << cvdemo::detector_name(detector) << " not available or file not writable)" << std::endl;
+		return -1;
+	}
+
+	std::cout << "Indexed " << num_descriptors << " descriptors of " << image_files.size() << " images in " << seconds
+	          << " s to " << index_path << std::endl;
+	return 0;
+}
+
+/**
+ * @function query_index
+ * brief describes the template with the detector of the index and lists the images with the most matches;
+ * the latency covers the template only, the images are not read again. With hashing enabled, binary descriptors are
+ * searched in the multi-index hashing of the whole index (the neighbours nearest of every template descriptor)
+ */
+int query_index( const std::string &index_path, const std::string &template_file, int min_matches, float ratio, int top,
+                 const cvdemo::HashingOptions &hashing, int neighbours )
+{
+	int64 start = cv::getTickCount();
+	cvdemo::DescriptorIndex index;
+	if(!index.open(index_path))
+	{
+		std::cout << "Cannot open index " << index_path << std::endl;
+		return -1;
+	}
+	double open_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+	cv::Mat image_template = cv::imread(template_file, 1);
+	if(!image_template.data)
+	{
+		show_help("Template image not valid.");
+		return -1;
+	}
+
+	cv::Ptr<cv::Feature2D> detector = cvdemo::create_detector(index.detector());
+	if(detector.empty())
+	{
+		std::cout << cvdemo::detector_name(index.detector()) << " is not available in this OpenCV build." << std::endl;
+		return -1;
+	}
+
+	start = cv::getTickCount();
+	std::vector<cv::KeyPoint> keypoints;
+	cv::Mat descriptors;
+	cvdemo::detect_and_compute(detector, image_template, keypoints, descriptors);
+	double detection_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+	if(descriptors.empty())
+	{
+		std::cout << "No valid keypoints found for template image. Aborting." << std::endl;
+		return -1;
+	}
+
+	/// The hash tables are built on the mapped descriptors, once per query run
+	cvdemo::MultiIndexHashing mih;
+	double hashing_ms = 0.0;
+	if(hashing.enabled && index.descriptors().depth() != CV_8U)
+		std::cout << "Multi-index hashing needs binary descriptors, matching " << cvdemo::detector_name(index.detector())
+		          << " by brute force." << std::endl;
+	else if(hashing.enabled && index.num_descriptors() > 0)
+	{
+		start = cv::getTickCount();
+		mih.build(index.descriptors());
+		hashing_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+	}
+
+	start = cv::getTickCount();
+	std::vector<cvdemo::IndexMatch> found = mih.empty()
+		? cvdemo::query_descriptor_index( index, descriptors, min_matches, ratio )
+		: cvdemo::query_descriptor_index( index, mih, descriptors, min_matches, ratio, neighbours, hashing.max_radius );
+	double matching_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+	std::cout << "Index: " << index.num_images() << " images, " << index.num_descriptors() << " "
+	          << cvdemo::detector_name(index.detector()) << " descriptors; template: " << descriptors.rows << " descriptors" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Open " << open_ms << " ms, template detection " << detection_ms << " ms, ";
+	if(!mih.empty())
+		std::cout << "hashing " << hashing_ms << " ms (radius " << hashing.max_radius << ", " << neighbours << " neighbours), ";
+	std::cout << "matching " << matching_ms << " ms" << std::endl;
+
+	std::cout << found.size() << " images with at least " << min_matches << " matches" << std::endl;
+	for(size_t i = 0; i < found.size() && static_cast<int>(i) < top; ++i)
+		std::cout << std::setw(8) << found[i].matches << "  " << index.image_path(found[i].image) << std::endl;
+
+	return 0;
+}
+
+/**
+ * @function show_help
+ */
+void show_help(const std::string &message)
+{
+	cvdemo::show_help("cv_index", { "--build <index file> [--detector <orb|brisk|sift|surf>] <dir|glob>", "--query <index file> [--min-matches <n>] [--ratio <r>] [--top <n>] [--mih] [--radius <n>] [--k <n>] /path/to/template/image" }, message);
+}
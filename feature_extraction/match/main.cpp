@@ -0,0 +1,123 @@
+/**
+ * Match
+ * brief sample code matching a set of templates against a set of images: every template and every image is
+ * described once, all the template x image pairs are matched on a thread pool and the results written to CSV/JSON
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/batch_matching.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/feature_extraction.hpp>
+#include <cvdemo/thread_pool.hpp>
+
+/// Function headers
+void show_help(const std::string &message = "");
+
+/**
+ * function main
+ */
+int main(int argc, char **argv)
+{
+	cvdemo::CommandLine command_line(argc, argv, { "detector", "threads", "chunk", "ratio", "threshold", "pca", "csv", "json" });
+	if(!command_line.valid())
+	{
+		show_help(command_line.error());
+		return -1;
+	}
+
+	const std::vector<std::string> &arguments = command_line.positional();
+	if(arguments.size() < 2)
+	{
+		show_help("Not enough parameters given.");
+		return -1;
+	}
+
+	cvdemo::BatchMatchingOptions options;
+	const std::string detector_option = command_line.get("detector", "orb");
+	if(!cvdemo::parse_detector(detector_option, options.detector))
+	{
+		show_help("Unknown detector " + detector_option + ".");
+		return -1;
+	}
+	options.chunk_size = command_line.get_int("chunk", 0);
+	options.ratio = static_cast<float>(command_line.get_double("ratio", options.ratio));
+	options.verification.threshold = command_line.get_double("threshold", options.verification.threshold);
+	options.quantization.enabled = command_line.has("quantize") || command_line.has("pca");
+	options.quantization.dimensions = command_line.get_int("pca", 0);
+
+	std::vector<std::string> template_files = cvdemo::list_images(arguments[0]);
+	std::vector<std::string> image_files = cvdemo::list_images(arguments[1]);
+	if(template_files.empty() || image_files.empty())
+	{
+		std::cout << "No images found in " << (template_files.empty() ? arguments[0] : arguments[1]) << std::endl;
+		return -1;
+	}
+
+	try
+	{
+		cvdemo::ThreadPool pool(command_line.get_int("threads", 0));
+		std::cout << "Matching " << template_files.size() << " templates against " << image_files.size() << " images with "
+		          << cvdemo::detector_name(options.detector) << " on " << pool.size() << " threads..." << std::endl;
+
+		std::vector<cvdemo::TemplateMatch> results;
+		cvdemo::BatchMatchingStats stats;
+		const int status = cvdemo::match_batch(template_files, image_files, options, pool, results, &stats);
+		for(size_t i = 0; i < stats.skipped.size(); ++i)
+			std::cout << "Skipping " << stats.skipped[i].file << (stats.skipped[i].unreadable ? ", invalid image" : ", no valid keypoints found") << std::endl;
+		if(status != 0)
+		{
+			std::cout << "No template could be described (" << cvdemo::detector_name(options.detector)
+			          << " not available or no valid keypoints found)" << std::endl;
+			return -1;
+		}
+
+		size_t found = 0;
+		for(size_t i = 0; i < results.size(); ++i)
+			if(results[i].found())
+				++found;
+
+		std::cout << std::fixed << std::setprecision(2);
+		std::cout << stats.descriptions << " descriptions in " << stats.describe_ms << " ms, "
+		          << stats.jobs << " matching jobs in " << stats.match_ms << " ms ("
+		          << stats.match_ms / std::max<size_t>(1, stats.jobs) << " ms per job), total " << stats.total_ms << " ms" << std::endl;
+		std::cout << "Template descriptors: " << stats.template_bytes / 1024.0 << " KiB" << std::endl;
+		std::cout << found << " of " << stats.jobs << " template/image pairs verified" << std::endl;
+
+		if(command_line.has("csv") && !cvdemo::write_matches_csv(command_line.get("csv"), template_files, image_files, results))
+		{
+			std::cout << "Cannot write " << command_line.get("csv") << std::endl;
+			return -1;
+		}
+		if(command_line.has("json") && !cvdemo::write_matches_json(command_line.get("json"), template_files, image_files, results))
+		{
+			std::cout << "Cannot write " << command_line.get("json") << std::endl;
+			return -1;
+		}
+		if(!command_line.has("csv") && !command_line.has("json"))
+			for(size_t i = 0; i < results.size(); ++i)
+				if(results[i].found())
+					std::cout << std::setw(6) << results[i].inliers << "  " << template_files[results[i].template_index]
+					          << " in " << image_files[results[i].image_index] << std::endl;
+	}
+	catch(cv::Exception &ex)
+	{
+		std::cout << "Got exception: " << ex.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @function show_help
+ */
+void show_help(const std::string &message)
+{
+	cvdemo::show_help("cv_match", { "[--detector <orb|brisk|sift|surf>] [--threads <n>] [--chunk <images>] [--ratio <r>] [--threshold <px>] [--quantize] [--pca <dims>] [--csv <file>] [--json <file>] <templates dir|glob> <images dir|glob>" }, message);
+}
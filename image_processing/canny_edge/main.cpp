@@ -5,18 +5,32 @@
  * based on OpenCV Tutorials
  */
 
+#include <atomic>
 #include <iostream>
 #include <string>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/buffer_cache.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/image_processing.hpp>
+#include <cvdemo/video.hpp>
 
 /// Global Variables
 static int min_threshold = 100;
 static int max_threshold = 200;
 cv::Mat image;
+cvdemo::Display image_display("image");
+cvdemo::Display canny_display("canny");
+bool reuse_buffers = false;
+cvdemo::BufferCache cache;  /// buffers of the trackbar events with --reuse-buffers
+/// Copies of the trackbar values read by the processing thread of the stream mode
+std::atomic<int> stream_min_threshold(100), stream_max_threshold(200);
 
 /// Function headers
 void canny( int /*arg*/, void* );
+void stream_parameters_changed( int /*arg*/, void* );
+int run_stream( const cvdemo::StreamOptions &stream );
 void show_help(const std::string &message = "");
 
 /**
@@ -24,48 +38,63 @@ void show_help(const std::string &message = "");
  */
 int main( int argc, const char** argv )
 {
-    if(argc < 2)
+    cvdemo::CommandLine command_line(argc, argv);
+    if(!command_line.valid())
     {
-        show_help("Not enough parameters given.");
+        show_help(command_line.error());
         return -1;
     }
+    reuse_buffers = command_line.has("reuse-buffers");
 
-    std::string image_file("");
-    /// Iterate over the arguments passed through the command line
-    for(int i = 1; i < argc; ++i)
+    /// Headless mode: the edges of every image are written to disk
+    cvdemo::BatchOptions batch = command_line.batch();
+    if(batch.enabled)
     {
-        std::string input_file(argv[i]);
-        if(input_file.find_last_of(".jpg") != std::string::npos || input_file.find_last_of(".png") != std::string::npos)
+        cvdemo::BatchWriter writer(batch.output_dir);
+        return cvdemo::run_batch(batch, writer, [&writer](const cv::Mat &input, const std::string &)
         {
-            image_file = input_file;
-        }
-        else
-            show_help();
+            cv::Mat edges;
+            cvdemo::canny(input, edges, min_threshold, max_threshold);
+            writer.stage("canny");
+            return writer.write(edges) ? 0 : -1;
+        });
     }
 
-    if(image_file.length() == 0)
+    /// Stream mode: the edges of the frames of a video or camera are computed in a decode/process/display pipeline
+    cvdemo::StreamOptions stream = command_line.stream();
+    if(stream.enabled)
+        return run_stream(stream);
+
+    if(command_line.positional().empty())
+    {
+        show_help("Not enough parameters given.");
+        return -1;
+    }
+
+    std::vector<std::string> image_files = command_line.images();
+    if(image_files.empty())
     {
         show_help("No valid file format given.");
         return(-1);
     }
 
     /// Load the source image
-    image = cv::imread(image_file);
+    image = cv::imread(image_files.back());
     if(!image.data)
     {
         show_help("Image not valid.");
         return(-1);
     }
 
-    cv::namedWindow("image", cv::WINDOW_AUTOSIZE);
-    cv::namedWindow("canny", cv::WINDOW_AUTOSIZE);
+    image_display.open();
+    canny_display.open();
 
-    cv::createTrackbar("min", "canny", &min_threshold, 255, canny);
-    cv::createTrackbar("max", "canny", &max_threshold, 255, canny);
+    cv::createTrackbar("min", canny_display.window_name(), &min_threshold, 255, canny);
+    cv::createTrackbar("max", canny_display.window_name(), &max_threshold, 255, canny);
 
     canny(0, 0);
-    cv::imshow("image", image);
-    cv::waitKey();
+    image_display.show(image);
+    image_display.wait();
 
     return 0;
 }
@@ -76,9 +105,41 @@ int main( int argc, const char** argv )
  */
 void canny( int /*arg*/, void* )
 {
-    cv::Mat canny;
-    cv::Canny(image, canny, min_threshold, max_threshold);
-    cv::imshow("canny", canny);
+    cv::Mat edges;
+    cv::Mat &output = reuse_buffers ? cache.buffer("edges") : edges;
+    cvdemo::canny(image, output, min_threshold, max_threshold);
+    canny_display.show(output);
+
+    if(reuse_buffers)
+        std::cout << "Buffers allocated: " << cache.allocations() << std::endl;
+}
+
+/**
+ * @function stream_parameters_changed
+ */
+void stream_parameters_changed( int /*arg*/, void* )
+{
+    stream_min_threshold = min_threshold;
+    stream_max_threshold = max_threshold;
+}
+
+/**
+ * @function run_stream
+ */
+int run_stream( const cvdemo::StreamOptions &stream )
+{
+    if(!stream.headless)
+    {
+        canny_display.open();
+        cv::createTrackbar("min", canny_display.window_name(), &min_threshold, 255, stream_parameters_changed);
+        cv::createTrackbar("max", canny_display.window_name(), &max_threshold, 255, stream_parameters_changed);
+    }
+    stream_parameters_changed(0, 0);
+
+    return cvdemo::run_stream(stream, canny_display, [](const cv::Mat &frame, cv::Mat &edges)
+    {
+        cvdemo::canny(frame, edges, stream_min_threshold, stream_max_threshold);
+    });
 }
 
 /**
@@ -86,11 +147,5 @@ void canny( int /*arg*/, void* )
  */
 void show_help(const std::string &message)
 {
-    std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-    std::cout << "Usage: cv_canny_d /path/to/image" << std::endl;
-    #else
-    std::cout << "Usage: cv_canny /path/to/image" << std::endl;
-    #endif
-    std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
+    cvdemo::show_help("cv_canny", { "/path/to/image [--reuse-buffers]", "--batch <dir|glob> --out <dir>", "--video <file|camera index> [--record <file.avi>] [--headless]" }, message);
 }
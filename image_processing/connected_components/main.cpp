@@ -0,0 +1,270 @@
+/**
+ * Connected Components
+ * brief sample code labelling the connected components of a thresholded image, with their area, bounding box and centroid
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <cvdemo/basic_operations.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/image_processing.hpp>
+#include <cvdemo/timing.hpp>
+
+/// Global Variables
+int DELAY_CAPTION = 2000; /// 2 seconds
+cvdemo::Display display( "Connected Components Demo", DELAY_CAPTION );
+int connectivity = 8;
+int threshold_value = -1;   /// --threshold: fixed threshold of the grayscale image (-1: Otsu)
+bool invert = false;        /// --invert: dark objects on a bright background
+bool print_stats = false;   /// --stats: statistics of every component as CSV on the standard output
+
+/// Function headers
+int components_demo( const cv::Mat &src );
+void binarize( const cv::Mat &src, cv::Mat &binary );
+int components_benchmark( const cv::Mat &src, int repeat );
+bool same_partition( const cv::Mat &labels, const cv::Mat &reference );
+void show_help(const std::string &message = "");
+
+/**
+ * @function main
+ */
+int main( int argc, char** argv )
+{
+    cvdemo::CommandLine command_line(argc, argv, { "connectivity", "threshold", "repeat" });
+    if(!command_line.valid())
+    {
+        show_help(command_line.error());
+        return -1;
+    }
+    connectivity = command_line.get_int("connectivity", 8);
+    if(connectivity != 4 && connectivity != 8)
+    {
+        show_help("The connectivity is either 4 or 8.");
+        return -1;
+    }
+    threshold_value = command_line.get_int("threshold", -1);
+    invert = command_line.has("invert");
+    print_stats = command_line.has("stats");
+
+    /// Headless mode: the binary image and the components of every image are written to disk
+    cvdemo::BatchOptions batch = command_line.batch();
+    if(batch.enabled)
+    {
+        cvdemo::BatchWriter writer(batch.output_dir);
+        display.set_writer(&writer);
+        return cvdemo::run_batch(batch, writer, [](const cv::Mat &image, const std::string &)
+        {
+            return components_demo(image);
+        });
+    }
+
+    if(command_line.positional().empty())
+	{
+		show_help("Not enough parameters given.");
+		return -1;
+	}
+
+	std::vector<std::string> image_files = command_line.images();
+	if(image_files.empty())
+	{
+		show_help("No valid file format given.");
+		return(-1);
+	}
+
+    /// Load the source image
+    cv::Mat src = cv::imread(image_files.back(), 1);
+    if(!src.data)
+    {
+        show_help("Image not valid.");
+        return(-1);
+    }
+
+    if(command_line.has("benchmark"))
+        return components_benchmark( src, command_line.get_int("repeat", 3) );
+
+    /// Create a window to display results
+    display.open();
+
+    if( components_demo( src ) != 0 )
+        return 0;
+
+    display.wait();
+
+    return 0;
+}
+
+/**
+ * @function components_demo
+ * brief labels the components of the thresholded src and shows them with their bounding boxes, stops if a key is pressed
+ */
+int components_demo( const cv::Mat &src )
+{
+    if( display.caption( "Original Image", src ) != 0 )
+        return -1;
+
+    if( display.show( src, DELAY_CAPTION ) != 0 )
+        return -1;
+
+    cv::Mat binary, labels, painted;
+    binarize( src, binary );
+
+    std::vector<cvdemo::ComponentStats> stats;
+    int64 start = cv::getTickCount();
+    const int num_labels = cvdemo::label_components( binary, labels, connectivity, &stats );
+    double ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    std::cout << num_labels - 1 << " components (" << connectivity << "-connectivity) in " << ms << " ms" << std::endl;
+
+    if( print_stats )
+    {
+        std::cout << "label,area,x,y,width,height,centroid_x,centroid_y" << std::endl;
+        for ( int i = 1; i < num_labels; ++i )
+        {
+            const cvdemo::ComponentStats &component = stats[i];
+            std::cout << i << "," << component.area << "," << component.bbox.x << "," << component.bbox.y << ","
+                      << component.bbox.width << "," << component.bbox.height << ","
+                      << component.centroid.x << "," << component.centroid.y << std::endl;
+        }
+    }
+
+    /// Components in random colors, with their bounding boxes and centroids
+    cvdemo::colorize_markers( labels, num_labels - 1, painted );
+    for ( int i = 1; i < num_labels; ++i )
+    {
+        cv::rectangle( painted, stats[i].bbox, cv::Scalar(255,255,255) );
+        cv::circle( painted, cv::Point( cvRound(stats[i].centroid.x), cvRound(stats[i].centroid.y) ), 2, cv::Scalar(0,0,255), -1 );
+    }
+
+    if( display.caption( "Binary Image", src ) != 0 )
+        return -1;
+
+    if( display.show( binary, DELAY_CAPTION ) != 0 )
+        return -1;
+
+    if( display.caption( "Connected Components", src ) != 0 )
+        return -1;
+
+    if( display.show( painted, 0 ) != 0 )
+        return -1;
+
+    return 0;
+}
+
+/**
+ * @function binarize
+ * brief thresholds the grayscale src with the fixed --threshold or with Otsu, inverted with --invert
+ */
+void binarize( const cv::Mat &src, cv::Mat &binary )
+{
+    cv::Mat gray;
+    cvdemo::to_gray( src, gray );
+
+    int type = invert ? cv::THRESH_BINARY_INV : cv::THRESH_BINARY;
+    if( threshold_value < 0 )
+        type += cv::THRESH_OTSU;
+    cv::threshold( gray, binary, std::max( 0, threshold_value ), 255, type );
+}
+
+/**
+ * @function components_benchmark
+ * brief times label_components, with and without statistics, against cv::connectedComponents for 8- and
+ * 4-connectivity, and checks that both find the same components
+ */
+int components_benchmark( const cv::Mat &src, int repeat )
+{
+    const double megapixels = src.total() / 1e6;
+    repeat = std::max( 1, repeat );
+
+    cv::Mat binary;
+    binarize( src, binary );
+
+    std::cout << "Image: " << src.cols << "x" << src.rows << " (" << megapixels << " MP), " << cv::getNumThreads()
+              << " threads, best of " << repeat << " runs" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(14) << "Connectivity" << std::setw(12) << "components" << std::setw(14) << "labels ms/MP"
+              << std::setw(14) << "stats ms/MP" << std::setw(16) << "OpenCV ms/MP" << std::setw(20) << "OpenCV stats ms/MP"
+              << std::setw(10) << "speedup" << std::setw(8) << "same" << std::endl;
+
+    const int connectivities[] = { 8, 4 };
+    for ( int c = 0; c < 2; ++c )
+    {
+        const int conn = connectivities[c];
+        cv::Mat labels;
+        std::vector<cvdemo::ComponentStats> stats;
+        int num_labels = 0;
+        double labels_ms = cvdemo::best_time_ms( repeat, [&]() { num_labels = cvdemo::label_components( binary, labels, conn ); } );
+        double stats_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::label_components( binary, labels, conn, &stats ); } );
+
+        std::cout << std::setw(14) << conn << std::setw(12) << num_labels - 1 << std::setw(14) << labels_ms / megapixels
+                  << std::setw(14) << stats_ms / megapixels;
+
+        #ifdef OPENCV_NEW
+        cv::Mat reference, reference_stats, reference_centroids;
+        int reference_labels = 0;
+        double reference_ms = cvdemo::best_time_ms( repeat, [&]() { reference_labels = cv::connectedComponents( binary, reference, conn, CV_32S ); } );
+        double reference_stats_ms = cvdemo::best_time_ms( repeat, [&]()
+        {
+            cv::connectedComponentsWithStats( binary, reference, reference_stats, reference_centroids, conn, CV_32S );
+        });
+        const bool same = num_labels == reference_labels && same_partition( labels, reference );
+
+        std::cout << std::setw(16) << reference_ms / megapixels << std::setw(20) << reference_stats_ms / megapixels
+                  << std::setw(9) << reference_ms / labels_ms << "x" << std::setw(8) << (same ? "yes" : "NO") << std::endl;
+        #else
+        std::cout << std::setw(16) << "n/a" << std::setw(20) << "n/a" << std::setw(10) << "n/a" << std::setw(8) << "n/a" << std::endl;
+        #endif
+    }
+
+    #ifndef OPENCV_NEW
+    std::cout << "cv::connectedComponents is available from OpenCV 3.0" << std::endl;
+    #endif
+
+    return 0;
+}
+
+/**
+ * @function same_partition
+ * brief true if every label of one image corresponds to exactly one label of the other, whatever the numbering
+ */
+bool same_partition( const cv::Mat &labels, const cv::Mat &reference )
+{
+    double max_label = 0.0, max_reference = 0.0;
+    cv::minMaxIdx( labels, 0, &max_label );
+    cv::minMaxIdx( reference, 0, &max_reference );
+    std::vector<int> to_reference( static_cast<size_t>(max_label) + 1, -1 );
+    std::vector<int> from_reference( static_cast<size_t>(max_reference) + 1, -1 );
+
+    for ( int i = 0; i < labels.rows; ++i )
+    {
+        const int *row = labels.ptr<int>(i);
+        const int *reference_row = reference.ptr<int>(i);
+        for ( int j = 0; j < labels.cols; ++j )
+        {
+            int &forward = to_reference[row[j]];
+            int &backward = from_reference[reference_row[j]];
+            if ( forward == -1 && backward == -1 )
+            {
+                forward = reference_row[j];
+                backward = row[j];
+            }
+            else if ( forward != reference_row[j] || backward != row[j] )
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @function show_help
+ */
+void show_help(const std::string &message)
+{
+	cvdemo::show_help("cv_components", { "/path/to/image [--connectivity <4|8>] [--threshold <t>] [--invert] [--stats]", "--benchmark [--repeat <n>] [--threshold <t>] [--invert] /path/to/image", "--batch <dir|glob> --out <dir>" }, message);
+}
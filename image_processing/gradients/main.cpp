@@ -7,17 +7,19 @@
 
 #include <iostream>
 #include <string>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <cvdemo/basic_operations.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/image_processing.hpp>
 
 /// Global Variables
-cv::Mat src, dst;
-char window_name[] = "Gradients Demo";
 int DELAY_CAPTION = 2000; /// 2 seconds
+cvdemo::Display display( "Gradients Demo", DELAY_CAPTION );
 
 /// Function headers
-int display_caption( const char* caption );
-int display_dst( int delay );
+int gradients_demo( const cv::Mat &src );
 void show_help(const std::string &message = "");
 
 /**
@@ -25,33 +27,40 @@ void show_help(const std::string &message = "");
  */
 int main( int argc, char** argv )
 {
-    if(argc < 2)
+    cvdemo::CommandLine command_line(argc, argv);
+    if(!command_line.valid())
     {
-        show_help("Not enough parameters given.");
+        show_help(command_line.error());
         return -1;
     }
 
-    std::string image_file("");
-    /// Iterate over the arguments passed through the command line
-    for(int i = 1; i < argc; ++i)
+    /// Headless mode: every image is differentiated and the results are written to disk
+    cvdemo::BatchOptions batch = command_line.batch();
+    if(batch.enabled)
     {
-        std::string input_file(argv[i]);
-        if(input_file.find_last_of(".jpg") != std::string::npos || input_file.find_last_of(".png") != std::string::npos)
+        cvdemo::BatchWriter writer(batch.output_dir);
+        display.set_writer(&writer);
+        return cvdemo::run_batch(batch, writer, [](const cv::Mat &image, const std::string &)
         {
-            image_file = input_file;
-        }
-        else
-            show_help();
+            return gradients_demo(image);
+        });
     }
 
-    if(image_file.length() == 0)
+    if(command_line.positional().empty())
+    {
+        show_help("Not enough parameters given.");
+        return -1;
+    }
+
+    std::vector<std::string> image_files = command_line.images();
+    if(image_files.empty())
     {
         show_help("No valid file format given.");
         return(-1);
     }
 
     /// Load the source image
-    src = cv::imread(image_file, 1 );
+    cv::Mat src = cv::imread(image_files.back(), 1 );
     if(!src.data)
     {
         show_help("Image not valid.");
@@ -59,108 +68,49 @@ int main( int argc, char** argv )
     }
 
     /// Create a window to display results
-    cv::namedWindow( window_name, cv::WINDOW_AUTOSIZE );
-
-    if( display_caption( "Original Image" ) != 0 )
-        return 0;
-
-    dst = src.clone();
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
-
-    /// Performs grayscale conversion
-    cv::Mat src_gray;
-    #ifdef OPENCV_NEW
-    cv::cvtColor(src, src_gray, cv::COLOR_BGR2GRAY);
-    #else
-    cv::cvtColor(src, src_gray, CV_BGR2GRAY);
-    #endif
-
-    /// Performs Sobel gradient on X axis
-    if( display_caption( "Sobel Gradient X" ) != 0 )
-        return 0;
-    cv::Sobel(src_gray, dst, CV_64F, 1, 0, 5);
-
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
-
-    /// Performs Sobel gradient on Y axis
-    if( display_caption( "Sobel Gradient Y" ) != 0 )
-        return 0;
-    cv::Sobel(src_gray, dst, CV_64F, 0, 1, 5);
-
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
-
-    /// Performs Scharr gradient on X axis
-    if( display_caption( "Scharr Gradient X" ) != 0 )
-        return 0;
-    cv::Scharr(src_gray, dst, CV_64F, 1, 0, 5);
-
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
-
-    /// Performs Scharr gradient on Y axis
-    if( display_caption( "Scharr Gradient Y" ) != 0 )
-        return 0;
-    cv::Scharr(src_gray, dst, CV_64F, 0, 1, 5);
+    display.open();
 
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
-
-    /// Performs Laplacian gradient
-    if( display_caption( "Laplacian Gradient" ) != 0 )
-        return 0;
-    cv::Laplacian(src_gray, dst, CV_64F);
-
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
-
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
-
-    /// Performs Sobel X+Y
-    cv::Mat sobel_x, sobel_y;
-    if( display_caption( "Sobel X+Y" ) != 0 )
-        return 0;
-    cv::Sobel(src_gray, sobel_x, CV_64F, 1, 0, 5);
-    cv::Sobel(src_gray, sobel_y, CV_64F, 0, 1, 5);
-    cv::bitwise_and(sobel_x, sobel_y, dst);
-
-    if( display_dst( DELAY_CAPTION ) != 0 )
+    if( gradients_demo( src ) != 0 )
         return 0;
 
     /// Wait until user press a key
-    display_caption( "End: Press a key!" );
-    cv::waitKey(0);
+    display.caption( "End: Press a key!", src );
+    display.wait();
 
     return 0;
 }
 
 /**
- * @function display_caption
+ * @function gradients_demo
+ * brief computes the gradients of src, stops if a key is pressed
  */
-int display_caption( const char* caption )
+int gradients_demo( const cv::Mat &src )
 {
-    dst = cv::Mat::zeros( src.size(), src.type() );
-    cv::putText( dst, caption,
-        cv::Point( src.cols/4, src.rows/2),
-        cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(255, 255, 255) );
-
-    cv::imshow( window_name, dst );
-    int c = cv::waitKey( DELAY_CAPTION );
-    if( c >= 0 ) { return -1; }
-    return 0;
-}
+    const cvdemo::Gradient gradients[] = { cvdemo::SOBEL_X, cvdemo::SOBEL_Y, cvdemo::SCHARR_X, cvdemo::SCHARR_Y, cvdemo::LAPLACIAN, cvdemo::SOBEL_XY };
+    const char* captions[] = { "Sobel Gradient X", "Sobel Gradient Y", "Scharr Gradient X", "Scharr Gradient Y", "Laplacian Gradient", "Sobel X+Y" };
+
+    if( display.caption( "Original Image", src ) != 0 )
+        return -1;
+
+    if( display.show( src, DELAY_CAPTION ) != 0 )
+        return -1;
+
+    /// Performs grayscale conversion
+    cv::Mat src_gray;
+    cvdemo::to_gray( src, src_gray );
+
+    /// Performs Sobel, Scharr and Laplacian gradients
+    cv::Mat dst;
+    for ( int i = 0; i < 6; ++i )
+    {
+        if( display.caption( captions[i], src ) != 0 )
+            return -1;
+
+        cvdemo::gradient( src_gray, dst, gradients[i] );
+        if( display.show( dst, DELAY_CAPTION ) != 0 )
+            return -1;
+    }
 
-/**
- * @function display_dst
- */
-int display_dst( int delay )
-{
-    cv::imshow( window_name, dst );
-    int c = cv::waitKey ( delay );
-    if( c >= 0 ) { return -1; }
     return 0;
 }
 
@@ -169,11 +119,5 @@ int display_dst( int delay )
  */
 void show_help(const std::string &message)
 {
-    std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-    std::cout << "Usage: cv_gradients_d /path/to/image" << std::endl;
-    #else
-    std::cout << "Usage: cv_gradients /path/to/image" << std::endl;
-    #endif
-    std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
+    cvdemo::show_help("cv_gradients", { "/path/to/image", "--batch <dir|glob> --out <dir>" }, message);
 }
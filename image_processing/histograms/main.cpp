@@ -7,16 +7,25 @@
 
 #include <iostream>
 #include <string>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/buffer_cache.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/image_processing.hpp>
 
 /// Global Variables
 static int brightness = 100;
 static int contrast = 100;
 cv::Mat image;
+cvdemo::Display image_display("image");
+cvdemo::Display histogram_display("histogram");
+bool reuse_buffers = false;
+cvdemo::BufferCache cache;  /// buffers of the trackbar events with --reuse-buffers
 
 /// Function headers
 void updateBrightnessContrast( int /*arg*/, void* );
+void computeBrightnessContrast( cv::Mat &dst, cv::Mat &histImage );
 void show_help(const std::string &message = "");
 
 /**
@@ -24,47 +33,61 @@ void show_help(const std::string &message = "");
  */
 int main( int argc, const char** argv )
 {
-    if(argc < 2)
+    cvdemo::CommandLine command_line(argc, argv);
+    if(!command_line.valid())
+    {
+        show_help(command_line.error());
+        return -1;
+    }
+    reuse_buffers = command_line.has("reuse-buffers");
+
+    /// Headless mode: the adjusted image and its histogram are written to disk for every image
+    cvdemo::BatchOptions batch = command_line.batch();
+    if(batch.enabled)
+    {
+        cvdemo::BatchWriter writer(batch.output_dir);
+        return cvdemo::run_batch(batch, writer, [&writer](const cv::Mat &input, const std::string &)
+        {
+            cv::Mat dst, histImage;
+            image = input;
+            computeBrightnessContrast(dst, histImage);
+            writer.stage("image");
+            if(!writer.write(dst))
+                return -1;
+            writer.stage("histogram");
+            return writer.write(histImage) ? 0 : -1;
+        });
+    }
+
+    if(command_line.positional().empty())
 	{
 		show_help("Not enough parameters given."); 
 		return -1;
 	}
-	
-	std::string image_file("");
-	/// Iterate over the arguments passed through the command line
-	for(int i = 1; i < argc; ++i)
-	{
-		std::string input_file(argv[i]);
-		if(input_file.find_last_of(".jpg") != std::string::npos || input_file.find_last_of(".png") != std::string::npos)
-		{
-			image_file = input_file;
-		}
-		else 
-			show_help();
-	}
 
-	if(image_file.length() == 0)
+	std::vector<std::string> image_files = command_line.images();
+	if(image_files.empty())
 	{
 		show_help("No valid file format given.");
 		return(-1);
 	}
     
 	/// Load the source image
-	image = cv::imread(image_file);
+	image = cv::imread(image_files.back());
 	if(!image.data)
 	{
 		show_help("Image not valid.");
 		return(-1);
 	}
 
-    cv::namedWindow("image", 0);
-    cv::namedWindow("histogram", 0);
+    image_display.open(0);
+    histogram_display.open(0);
 
-    cv::createTrackbar("brightness", "image", &brightness, 200, updateBrightnessContrast);
-    cv::createTrackbar("contrast", "image", &contrast, 200, updateBrightnessContrast);
+    cv::createTrackbar("brightness", image_display.window_name(), &brightness, 200, updateBrightnessContrast);
+    cv::createTrackbar("contrast", image_display.window_name(), &contrast, 200, updateBrightnessContrast);
 
     updateBrightnessContrast(0, 0);
-    cv::waitKey();
+    image_display.wait();
 
     return 0;
 }
@@ -75,56 +98,32 @@ int main( int argc, const char** argv )
  */
 void updateBrightnessContrast( int /*arg*/, void* )
 {
-    int histSize = 64;
-    int _brightness = brightness - 100;
-    int _contrast = contrast - 100;
-
-    /*
-     * The algorithm is by Werner D. Streidt
-     * (http://visca.com/ffactory/archives/5-99/msg00021.html)
-     */
-    double a, b;
-    if( _contrast > 0 )
-    {
-        double delta = 127.*_contrast/100;
-        a = 255./(255. - delta*2);
-        b = a*(_brightness - delta);
-    }
-    else
+    cv::Mat dst, histImage;
+    cv::Mat &adjusted = reuse_buffers ? cache.buffer("adjusted") : dst;
+    cv::Mat &histogram = reuse_buffers ? cache.buffer("histogram") : histImage;
+    computeBrightnessContrast(adjusted, histogram);
+    image_display.show(adjusted);
+    histogram_display.show(histogram);
+
+    if(reuse_buffers)
+        std::cout << "Buffers allocated: " << cache.allocations() << std::endl;
+}
+
+/**
+ * @function computeBrightnessContrast
+ * brief applies the current brightness/contrast to image and draws the histogram of the result
+ */
+void computeBrightnessContrast( cv::Mat &dst, cv::Mat &histImage )
+{
+    if(reuse_buffers)
     {
-        double delta = -128.*_contrast/100;
-        a = (256.-delta*2)/255.;
-        b = a*_brightness + delta;
+        cvdemo::brightness_contrast(image, dst, brightness - 100, contrast - 100, cache);
+        cvdemo::histogram_image(dst, histImage, cache);
+        return;
     }
 
-    cv::Mat gray, dst, hist;
-	if(image.channels() > 1)
-	{
-		#ifdef OPENCV_NEW
-		cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-		#else
-		cv::cvtColor(image, gray, CV_BGR2GRAY);
-		#endif
-		gray.convertTo(dst, CV_8U, a, b);
-	}
-	else
-		image.convertTo(dst, CV_8U, a, b);	
-    
-    cv::imshow("image", dst);
-	/// Compute histograms
-    cv::calcHist(&dst, 1, 0, cv::Mat(), hist, 1, &histSize, 0);
-	/// Init the target image with white color
-    cv::Mat histImage = cv::Mat(200, 320, CV_8U, cv::Scalar::all(255));
-	/// Normalize the histograms to be as big as histImage rows
-    cv::normalize(hist, hist, 0, histImage.rows, cv::NORM_MINMAX, CV_32F);
-	/// Approximate the values to next integer
-    int binW = cvRound((double)histImage.cols/histSize);
-	/// Draw the histogram as a series of rectangles
-    for( int i = 0; i < histSize; ++i )
-        cv::rectangle( histImage, cv::Point(i*binW, histImage.rows),
-                   cv::Point((i+1)*binW, histImage.rows - cvRound(hist.at<float>(i))),
-                   cv::Scalar::all(0), -1, 8, 0 );
-    cv::imshow("histogram", histImage);
+    cvdemo::brightness_contrast(image, dst, brightness - 100, contrast - 100);
+    cvdemo::histogram_image(dst, histImage);
 }
 
 /**
@@ -132,11 +131,5 @@ void updateBrightnessContrast( int /*arg*/, void* )
  */
 void show_help(const std::string &message)
 {
-	std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-	std::cout << "Usage: cv_histograms_d /path/to/image" << std::endl; 
-	#else
-	std::cout << "Usage: cv_histograms /path/to/image" << std::endl; 
-	#endif
-	std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
+	cvdemo::show_help("cv_histograms", { "/path/to/image [--reuse-buffers]", "--batch <dir|glob> --out <dir>" }, message);
 }
@@ -5,19 +5,30 @@
  * based on OpenCV Tutorials
  */
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <string>
-#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
 #include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/image_processing.hpp>
+#include <cvdemo/tiled_file.hpp>
+#include <cvdemo/timing.hpp>
 
 /// Global Variables
-cv::Mat src, dst;
-char window_name[] = "Watershed Demo";
 int DELAY_CAPTION = 2000; /// 2 seconds
+cvdemo::Display display( "Watershed Demo", DELAY_CAPTION );
+int band_rows = 0;  /// --fused: rows of the bands of the fused preprocessing (0: separate full image passes)
 
 /// Function headers
-int display_caption( const char* caption );
-int display_dst( int delay );
+int watershed_demo( const cv::Mat &src );
+int preprocess_benchmark( const cv::Mat &src, int repeat );
+int labelling_benchmark( const cv::Mat &src, int repeat );
+int tiled_watershed( const cvdemo::CommandLine &command_line );
 void show_help(const std::string &message = "");
 
 /**
@@ -25,208 +36,263 @@ void show_help(const std::string &message = "");
  */
 int main( int argc, char** argv )
 {
-    if(argc < 2)
+    cvdemo::CommandLine command_line(argc, argv, { "band", "repeat", "tile", "overlap", "segmentation", "width", "height", "channels" });
+    if(!command_line.valid())
+    {
+        show_help(command_line.error());
+        return -1;
+    }
+    if(command_line.has("fused"))
+        band_rows = std::max(1, command_line.get_int("band", 64));
+
+    /// Headless mode: every image is segmented and the results are written to disk
+    cvdemo::BatchOptions batch = command_line.batch();
+    if(batch.enabled)
+    {
+        cvdemo::BatchWriter writer(batch.output_dir);
+        display.set_writer(&writer);
+        return cvdemo::run_batch(batch, writer, [](const cv::Mat &image, const std::string &)
+        {
+            return watershed_demo(image);
+        });
+    }
+
+    if(command_line.positional().empty())
 	{
 		show_help("Not enough parameters given."); 
 		return -1;
 	}
-	
-	std::string image_file("");
-	/// Iterate over the arguments passed through the command line
-	for(int i = 1; i < argc; ++i)
-	{
-		std::string input_file(argv[i]);
-		if(input_file.find_last_of(".jpg") != std::string::npos || input_file.find_last_of(".png") != std::string::npos)
-		{
-			image_file = input_file;
-		}
-		else 
-			show_help();
-	}
 
-	if(image_file.length() == 0)
+	/// Tiled mode: images larger than the memory are segmented reading and writing one tile at a time
+	if(command_line.has("tiled"))
+		return tiled_watershed( command_line );
+	
+	std::vector<std::string> image_files = command_line.images();
+	if(image_files.empty())
 	{
 		show_help("No valid file format given.");
 		return(-1);
 	}
 
     /// Load the source image
-    src = cv::imread(image_file, 1);
+    cv::Mat src = cv::imread(image_files.back(), 1);
     if(!src.data)
     {
         show_help("Image not valid.");
         return(-1);
     }
 
-    /// Create a window to display results
-    cv::namedWindow( window_name, cv::WINDOW_AUTOSIZE );
-
-    if( display_caption( "Original Image" ) != 0 )
-        return 0;
+    if(command_line.has("preprocess-benchmark"))
+        return preprocess_benchmark( src, command_line.get_int("repeat", 3) );
 
-    dst = src.clone();
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
+    if(command_line.has("labelling-benchmark"))
+        return labelling_benchmark( src, command_line.get_int("repeat", 3) );
 
-    /// Performs grayscale conversion
-    cv::Mat src_gray;
-    #ifdef OPENCV_NEW
-    cv::cvtColor(src, src_gray, cv::COLOR_BGR2GRAY);
-	#else
-    cv::cvtColor(src, src_gray, CV_BGR2GRAY);
-    #endif
-
-    /// Performs the thresholding step
-    cv::Mat img_binary, img_foreground, img_background;
-    cv::threshold(src_gray, img_binary, 0, 255, cv::THRESH_BINARY_INV+cv::THRESH_OTSU);
-
-    /// Remove noise - image opening
-    cv::Mat kernel = cv::Mat::ones(3,3,CV_8UC1);
-    cv::morphologyEx(img_binary, img_binary, cv::MORPH_OPEN, kernel, cv::Point(-1,-1), 2);
-
-    if( display_caption( "Open Morphology operator" ) != 0 )
-        return 0;
+    /// Create a window to display results
+    display.open();
 
-    dst = img_binary.clone();
-    if( display_dst( DELAY_CAPTION ) != 0 )
+    if( watershed_demo( src ) != 0 )
         return 0;
 
-    /// Perform dilation to extract background
-    cv::dilate(img_binary, img_background, kernel, cv::Point(-1,-1), 3);
+    display.wait();
 
-    if( display_caption( "Background" ) != 0 )
-        return 0;
+    return 0;
+}
 
-    dst = img_background.clone();
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
+/**
+ * @function watershed_demo
+ * brief segments src with the watershed algorithm, stops if a key is pressed
+ */
+int watershed_demo( const cv::Mat &src )
+{
+    if( display.caption( "Original Image", src ) != 0 )
+        return -1;
 
-    /// Finding foreground area
-    #ifdef OPENCV_NEW
-    cv::distanceTransform(img_binary, img_foreground, cv::DIST_L2, 5);
-    #else
-    cv::distanceTransform(img_binary, img_foreground, CV_DIST_L1, 5);
-    #endif
+    if( display.show( src, DELAY_CAPTION ) != 0 )
+        return -1;
 
-    if( display_caption( "Distance transform" ) != 0 )
-        return 0;
+    /// The intermediate images are only computed to be displayed
+    cvdemo::WatershedStages stages;
+    stages.keep_intermediate = true;
+    cvdemo::watershed( src, stages, band_rows );
 
-    dst = img_foreground.clone();
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
+    const cv::Mat* results[] = { &stages.binary, &stages.background, &stages.distance, &stages.foreground, &stages.unknown };
+    const char* captions[] = { "Open Morphology operator", "Background", "Distance transform", "Foreground", "Unknown Region" };
 
-    /// Thresholding the foreground
-    double min_val = 0.0, max_val = 0.0;
-    cv::minMaxIdx(img_foreground, &min_val, &max_val); //find the max and min value in the image
-    img_foreground.convertTo(img_foreground, CV_8UC1); //reconvert to unsigned int values
-    cv::threshold(img_foreground, img_foreground, 0.7*max_val, 255, cv::THRESH_BINARY_INV+cv::THRESH_OTSU);
+    for ( int i = 0; i < 5; ++i )
+    {
+        if( display.caption( captions[i], src ) != 0 )
+            return -1;
 
-    if( display_caption( "Foreground" ) != 0 )
-        return 0;
+        if( display.show( *results[i], DELAY_CAPTION ) != 0 )
+            return -1;
+    }
 
-    dst = img_foreground.clone();
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
+    if( display.caption( "Watershed result", src ) != 0 )
+        return -1;
 
-    /// Perform Image subtraction to find unknown region
-    cv::Mat unknown_region;
-    cv::subtract(img_background, img_foreground, unknown_region);
+    if( display.show( stages.segmentation, 0 ) != 0 )
+        return -1;
 
-    if( display_caption( "Unknown Region" ) != 0 )
-        return 0;
+    return 0;
+}
 
-    dst = unknown_region.clone();
-    if( display_dst( DELAY_CAPTION ) != 0 )
-        return 0;
+/**
+ * @function preprocess_benchmark
+ * brief times the preprocessing and the markers as separate full image passes and fused on bands of 16 ... 512 rows,
+ * with the max difference of binary, foreground and markers
+ */
+int preprocess_benchmark( const cv::Mat &src, int repeat )
+{
+    const double megapixels = src.total() / 1e6;
+    const int bands[] = { 16, 32, 64, 128, 256, 512 };
+    repeat = std::max( 1, repeat );
 
-    /// Marker labelling
-    cv::Mat markers;
-    int num_components = 0;
-
-    #ifdef OPENCV_NEW
-    num_components = cv::connectedComponents(img_foreground, markers);
-    #else
-    std::vector<std::vector<cv::Point> > contours;
-    std::vector<cv::Vec4i> hierarchy;
-    cv::findContours(img_foreground, contours, hierarchy, CV_RETR_CCOMP, CV_CHAIN_APPROX_SIMPLE );
-    int idx = 0;
-    for( ; idx >= 0; idx = hierarchy[idx][0], num_components++ )
-        cv::drawContours(markers, contours, idx, cv::Scalar::all(num_components+1), -1, 8, hierarchy, INT_MAX);
-    #endif
-
-    /// Add 1 to all labels so that sure foreground is not 0, but 1
-    markers = markers+1;
-
-    /// Now, mark the region of unknown with zero
-    for(int i = 0; i < markers.rows; ++i)
-        for(int j = 0; j < markers.cols; ++j)
-            if(markers.at<unsigned int>(i,j) == 255)
-                markers.at<unsigned int>(i,j) = 0;
-
-    /// Run the Watershed algorithm
-    cv::watershed(src, markers);
-
-    /// Paint the Watershed image
-    std::vector<cv::Vec3b> colorTab;
-    for(int i = 0; i < num_components; ++i)
+    cvdemo::WatershedStages reference, fused;
+    double reference_ms = cvdemo::best_time_ms( repeat, [&]()
     {
-        int b = cv::theRNG().uniform(0, 255);
-        int g = cv::theRNG().uniform(0, 255);
-        int r = cv::theRNG().uniform(0, 255);
+        cvdemo::watershed_preprocess( src, reference );
+        cvdemo::label_markers( reference.foreground, reference.markers );
+        cvdemo::mark_unknown( reference.markers, reference.unknown );
+    });
 
-        colorTab.push_back(cv::Vec3b((uchar)b, (uchar)g, (uchar)r));
-    }
-
-    cv::Mat wshed(markers.size(), CV_8UC3);
+    std::cout << "Image: " << src.cols << "x" << src.rows << "x" << src.channels() << " (" << megapixels << " MP), best of " << repeat << " runs" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Separate passes: " << reference_ms / megapixels << " ms/MP" << std::endl;
+    std::cout << std::setw(10) << "Band rows" << std::setw(16) << "fused ms/MP" << std::setw(10) << "speedup" << std::setw(10) << "max diff" << std::endl;
 
-    for(int i = 0; i < markers.rows; ++i)
-        for(int j = 0; j < markers.cols; ++j)
+    for ( size_t i = 0; i < sizeof(bands) / sizeof(bands[0]); ++i )
+    {
+        double fused_ms = cvdemo::best_time_ms( repeat, [&]()
         {
-            int index = markers.at<int>(i,j);
-            if( index == -1 )
-                wshed.at<cv::Vec3b>(i,j) = cv::Vec3b(255,255,255);
-            else if( index <= 0 || index > num_components )
-                wshed.at<cv::Vec3b>(i,j) = cv::Vec3b(0,0,0);
-            else
-                wshed.at<cv::Vec3b>(i,j) = colorTab[index - 1];
-        }
-
-    if( display_caption( "Watershed result" ) != 0 )
-        return 0;
-
-    dst = wshed.clone();
-    if( display_dst( 0 ) != 0 )
-        return 0;
-
-    cv::waitKey(0);
+            cvdemo::watershed_preprocess_fused( src, fused, bands[i] );
+            cvdemo::label_markers( fused.foreground, fused.markers );
+            cvdemo::mark_unknown_fused( fused.markers, fused.binary, fused.foreground, bands[i] );
+        });
+
+        double max_diff = 0.0;
+        const cv::Mat* expected[] = { &reference.binary, &reference.foreground, &reference.markers };
+        const cv::Mat* actual[] = { &fused.binary, &fused.foreground, &fused.markers };
+        for ( int s = 0; s < 3; ++s )
+            max_diff = std::max( max_diff, cv::norm( *expected[s], *actual[s], cv::NORM_INF ) );
+
+        std::cout << std::setw(10) << bands[i] << std::setw(16) << fused_ms / megapixels
+                  << std::setw(9) << reference_ms / fused_ms << "x" << std::setw(10) << max_diff << std::endl;
+    }
 
     return 0;
 }
 
 /**
- * @function display_caption
+ * @function labelling_benchmark
+ * brief times the marking of the unknown region and the colorization written with per pixel at<>() calls
+ * against the row kernels of the library
  */
-int display_caption( const char* caption )
+int labelling_benchmark( const cv::Mat &src, int repeat )
 {
-    dst = cv::Mat::zeros( src.size(), src.type() );
-    cv::putText( dst, caption,
-        cv::Point( src.cols/4, src.rows/2),
-        cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(255, 255, 255) );
-
-    cv::imshow( window_name, dst );
-    int c = cv::waitKey( DELAY_CAPTION );
-    if( c >= 0 ) { return -1; }
+    const double megapixels = src.total() / 1e6;
+    repeat = std::max( 1, repeat );
+
+    cvdemo::WatershedStages stages;
+    cvdemo::watershed_preprocess( src, stages );
+    cv::Mat labels;
+    const int num_components = cvdemo::label_markers( stages.foreground, labels );
+    const cv::Mat &unknown = stages.unknown;
+
+    /// Marker shift and unknown region
+    cv::Mat per_pixel, kernel;
+    double mark_per_pixel_ms = cvdemo::best_time_ms( repeat, [&]()
+    {
+        per_pixel = labels + 1;
+        for ( int i = 0; i < per_pixel.rows; ++i )
+            for ( int j = 0; j < per_pixel.cols; ++j )
+                if ( unknown.at<uchar>(i,j) == 255 )
+                    per_pixel.at<int>(i,j) = 0;
+    });
+    double mark_kernel_ms = cvdemo::best_time_ms( repeat, [&]()
+    {
+        labels.copyTo( kernel );
+        cvdemo::mark_unknown( kernel, unknown );
+    });
+    double mark_diff = cv::norm( per_pixel, kernel, cv::NORM_INF );
+
+    /// Colorization of the watershed result, same colors for both
+    cv::watershed( src, kernel );
+    std::vector<cv::Vec3b> colors;
+    for ( int i = 0; i < num_components; ++i )
+        colors.push_back( cv::Vec3b( (uchar)cv::theRNG().uniform(0, 255), (uchar)cv::theRNG().uniform(0, 255), (uchar)cv::theRNG().uniform(0, 255) ) );
+
+    cv::Mat painted_per_pixel, painted_kernel;
+    double color_per_pixel_ms = cvdemo::best_time_ms( repeat, [&]()
+    {
+        painted_per_pixel.create( kernel.size(), CV_8UC3 );
+        for ( int i = 0; i < kernel.rows; ++i )
+            for ( int j = 0; j < kernel.cols; ++j )
+            {
+                int index = kernel.at<int>(i,j);
+                if ( index == -1 )
+                    painted_per_pixel.at<cv::Vec3b>(i,j) = cv::Vec3b(255,255,255);
+                else if ( index <= 0 || index > num_components )
+                    painted_per_pixel.at<cv::Vec3b>(i,j) = cv::Vec3b(0,0,0);
+                else
+                    painted_per_pixel.at<cv::Vec3b>(i,j) = colors[index - 1];
+            }
+    });
+    double color_kernel_ms = cvdemo::best_time_ms( repeat, [&]() { cvdemo::colorize_markers( kernel, colors, painted_kernel ); } );
+    double color_diff = cv::norm( painted_per_pixel, painted_kernel, cv::NORM_INF );
+
+    std::cout << "Image: " << src.cols << "x" << src.rows << " (" << megapixels << " MP), " << num_components
+              << " components, " << cv::getNumThreads() << " threads, best of " << repeat << " runs" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(14) << "Step" << std::setw(18) << "per pixel ms/MP" << std::setw(16) << "kernel ms/MP"
+              << std::setw(10) << "speedup" << std::setw(10) << "max diff" << std::endl;
+    std::cout << std::setw(14) << "mark unknown" << std::setw(18) << mark_per_pixel_ms / megapixels << std::setw(16) << mark_kernel_ms / megapixels
+              << std::setw(9) << mark_per_pixel_ms / mark_kernel_ms << "x" << std::setw(10) << mark_diff << std::endl;
+    std::cout << std::setw(14) << "colorize" << std::setw(18) << color_per_pixel_ms / megapixels << std::setw(16) << color_kernel_ms / megapixels
+              << std::setw(9) << color_per_pixel_ms / color_kernel_ms << "x" << std::setw(10) << color_diff << std::endl;
+
     return 0;
 }
 
 /**
- * @function display_dst
+ * @function tiled_watershed
+ * brief segments a binary PPM/PGM image (or raw 8 bit gray/BGR samples with --raw) tile by tile, writes the merged
+ * labels and their colors next to the segmentation
  */
-int display_dst( int delay )
+int tiled_watershed( const cvdemo::CommandLine &command_line )
 {
-    cv::imshow( window_name, dst );
-    int c = cv::waitKey ( delay );
-    if( c >= 0 ) { return -1; }
+    cvdemo::TiledImageFile input;
+    if( command_line.has("raw") )
+    {
+        const cv::Size size( command_line.get_int("width", 0), command_line.get_int("height", 0) );
+        const int type = command_line.get_int("channels", 1) == 3 ? CV_8UC3 : CV_8UC1;
+        if( !input.open_raw( command_line.positional().back(), size, type ) )
+        {
+            show_help("Raw tiled mode needs --width and --height matching the length of the file.");
+            return -1;
+        }
+    }
+    else if( !input.open( command_line.positional().back() ) )
+    {
+        show_help("Tiled mode needs a binary PPM/PGM image with 8 bit samples.");
+        return -1;
+    }
+
+    const std::string segmentation = command_line.get( "segmentation", "segmentation.ppm" );
+    const std::string labels = segmentation + ".labels.raw";
+    int num_segments = 0;
+    int64 start = cv::getTickCount();
+    if( cvdemo::watershed_tiled( input, labels, segmentation, command_line.get_int("tile", 1024),
+                                 command_line.get_int("overlap", 64), &num_segments ) != 0 )
+    {
+        std::cout << "Could not read " << command_line.positional().back() << " or write " << segmentation << std::endl;
+        return -1;
+    }
+    double seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+    std::cout << "Image: " << input.size().width << "x" << input.size().height << ", " << num_segments
+              << " segments in " << seconds << " s" << std::endl;
+    std::cout << "Segmentation: " << segmentation << ", labels (CV_32S, raw): " << labels << std::endl;
     return 0;
 }
 
@@ -235,11 +301,5 @@ int display_dst( int delay )
  */
 void show_help(const std::string &message)
 {
-	std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-	std::cout << "Usage: cv_watershed_d /path/to/image" << std::endl; 
-	#else
-	std::cout << "Usage: cv_watershed /path/to/image" << std::endl; 
-	#endif
-	std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
+	cvdemo::show_help("cv_watershed", { "/path/to/image [--fused [--band <rows>]]", "--preprocess-benchmark [--repeat <n>] /path/to/image", "--labelling-benchmark [--repeat <n>] /path/to/image", "--tiled [--tile <px>] [--overlap <px>] [--segmentation <file.ppm>] /path/to/image.ppm", "--tiled --raw --width <px> --height <px> [--channels <1|3>] [--tile <px>] [--overlap <px>] [--segmentation <file.ppm>] /path/to/image.raw", "--batch <dir|glob> --out <dir>" }, message);
 }
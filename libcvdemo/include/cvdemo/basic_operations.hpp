@@ -0,0 +1,198 @@
+/**
+ * Basic Operations
+ * brief thresholding, morphology, color conversions and smoothing filters used by the basic_operations demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_BASIC_OPERATIONS_HPP
+#define CVDEMO_BASIC_OPERATIONS_HPP
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "cvdemo/thread_pool.hpp"
+
+namespace cvdemo
+{
+
+class BufferCache;
+
+/// Color spaces of the conversions demo
+enum ColorSpace
+{
+    COLOR_GRAY = 0,
+    COLOR_HSV,
+    COLOR_HLS,
+    COLOR_LAB,
+    COLOR_YUV
+};
+
+/// Smoothing filters of the smoothing demo
+enum SmoothingFilter
+{
+    HOMOGENEOUS_BLUR = 0,
+    GAUSSIAN_BLUR,
+    MEDIAN_BLUR,
+    BILATERAL_BLUR,
+    CONSTANT_TIME_MEDIAN_BLUR,  /// same result of MEDIAN_BLUR, with median_filter()
+    BILATERAL_GRID_BLUR         /// approximation of BILATERAL_BLUR, with bilateral_grid()
+};
+
+/// Shapes of the structuring element, in the order of the erosion/dilation trackbars
+enum ElementShape
+{
+    ELEMENT_RECT = 0,
+    ELEMENT_CROSS,
+    ELEMENT_ELLIPSE
+};
+
+/// Gaussian scale space: levels[i] is the source blurred with sigmas[i] (CV_32F, same channels of the source)
+struct ScaleSpace
+{
+    std::vector<int> kernel_sizes;  /// kernel size whose default sigma gave the level
+    std::vector<double> sigmas;
+    std::vector<cv::Mat> levels;
+};
+
+/**
+ * @function threshold
+ * brief thresholds a single channel image; type is one of cv::THRESH_* (0: Binary ... 4: To Zero Inverted)
+ */
+void threshold( const cv::Mat &src_gray, cv::Mat &dst, double value, int type, double max_value = 255 );
+
+/**
+ * @function convert_color
+ * brief converts a BGR image to the given color space
+ */
+void convert_color( const cv::Mat &src, cv::Mat &dst, ColorSpace space );
+
+/**
+ * @function to_gray
+ * brief converts a BGR image to grayscale, single channel images are returned as they are
+ */
+void to_gray( const cv::Mat &src, cv::Mat &gray );
+
+/**
+ * @function structuring_element
+ * brief returns a (2*size+1)x(2*size+1) structuring element anchored in its center
+ */
+cv::Mat structuring_element( ElementShape shape, int size );
+
+/**
+ * @function erode
+ * brief erodes src with a (2*size+1)x(2*size+1) structuring element
+ */
+void erode( const cv::Mat &src, cv::Mat &dst, ElementShape shape, int size );
+/// Same, with the structuring element taken from the cache
+void erode( const cv::Mat &src, cv::Mat &dst, ElementShape shape, int size, BufferCache &cache );
+
+/**
+ * @function dilate
+ * brief dilates src with a (2*size+1)x(2*size+1) structuring element
+ */
+void dilate( const cv::Mat &src, cv::Mat &dst, ElementShape shape, int size );
+/// Same, with the structuring element taken from the cache
+void dilate( const cv::Mat &src, cv::Mat &dst, ElementShape shape, int size, BufferCache &cache );
+
+/**
+ * @function erode_rect
+ * brief erosion with a (2*size+1)x(2*size+1) rectangle in constant time per pixel (van Herk/Gil-Werman): separable
+ * 1-D passes over blocks as wide as the kernel, with running minima from both block borders, 3 comparisons per pixel
+ * and pass whatever the kernel size. The vertical pass runs on strips of columns, its temporaries fit in the cache
+ * whatever the image size. Same result of erode() with ELEMENT_RECT, used for 8 bit images (cv::erode otherwise).
+ */
+void erode_rect( const cv::Mat &src, cv::Mat &dst, int size );
+/// Same, with the intermediate buffers taken from the cache
+void erode_rect( const cv::Mat &src, cv::Mat &dst, int size, BufferCache &cache );
+
+/**
+ * @function dilate_rect
+ * brief dilation with a (2*size+1)x(2*size+1) rectangle in constant time per pixel, as erode_rect
+ */
+void dilate_rect( const cv::Mat &src, cv::Mat &dst, int size );
+/// Same, with the intermediate buffers taken from the cache
+void dilate_rect( const cv::Mat &src, cv::Mat &dst, int size, BufferCache &cache );
+
+/**
+ * @function smooth
+ * brief applies the smoothing filter with an odd kernel size (the bilateral filter uses it as diameter).
+ * The bilateral grid falls back to the exact bilateral filter for small kernels, whose grid would be bigger than the image.
+ */
+void smooth( const cv::Mat &src, cv::Mat &dst, SmoothingFilter filter, int kernel_size );
+
+/**
+ * @function median_filter
+ * brief median filter in constant time per pixel (Perreault-Hebert): column histograms slid down the rows and a
+ * kernel histogram updated by one column in and one column out, merged with SSE2. Same result of cv::medianBlur,
+ * used for 8 bit images with odd kernel sizes 3 ... 255 (cv::medianBlur otherwise).
+ */
+void median_filter( const cv::Mat &src, cv::Mat &dst, int kernel_size );
+
+/**
+ * @function bilateral_grid
+ * brief approximated bilateral filter: the pixels are splatted in a coarse (x, y, luminance) grid sampled every
+ * sigma_space pixels and sigma_color levels, the grid is blurred and then sliced back with trilinear interpolation.
+ * The cost does not depend on the sigmas, but the memory grows with bilateral_grid_size(). 8 bit images only,
+ * cv::bilateralFilter otherwise.
+ */
+void bilateral_grid( const cv::Mat &src, cv::Mat &dst, double sigma_space, double sigma_color );
+
+/**
+ * @function bilateral_grid_size
+ * brief number of cells of the grid used by bilateral_grid() for an image of the given size
+ */
+size_t bilateral_grid_size( const cv::Size &size, double sigma_space, double sigma_color );
+
+/**
+ * @function psnr
+ * brief peak signal to noise ratio of two 8 bit images in dB (infinite if they are identical)
+ */
+double psnr( const cv::Mat &a, const cv::Mat &b );
+
+/**
+ * @function smoothing_radius
+ * brief number of neighbour pixels read on each side by the smoothing filter
+ */
+int smoothing_radius( SmoothingFilter filter, int kernel_size );
+
+/**
+ * @function smooth_tiled
+ * brief same result of smooth(), computed on halo-padded tiles of tile_size pixels run on the pool. The bilateral grid
+ * is not tiled: its cells are laid out from the image origin, the whole image is filtered with smooth()
+ */
+void smooth_tiled( const cv::Mat &src, cv::Mat &dst, SmoothingFilter filter, int kernel_size, ThreadPool &pool, int tile_size = 256 );
+
+/**
+ * @function gaussian_sigma
+ * brief standard deviation of the kernel cv::GaussianBlur uses when sigma is derived from the kernel size, measured on
+ * cv::getGaussianKernel (0 for the identity kernel of size 1)
+ */
+double gaussian_sigma( int kernel_size );
+
+/**
+ * @function gaussian_scale_space
+ * brief approximates the blur of src with every kernel size and its default sigma. Gaussian convolutions compose
+ * (sigma_b^2 = sigma_a^2 + sigma_inc^2), so each level is derived from the previous one with the small
+ * incremental kernel instead of the full one: kernel sizes are expected in ascending order.
+ * The levels have the variance of the direct blur but not its kernel: the direct kernels are binomial up to 7 taps
+ * and truncated beyond, the incremental ones are sampled Gaussians. The difference of the kernels bounds the error for
+ * 8 bit images to 28 grey levels for size 3, 13 for size 5 and less than 3 from size 21 on, reached only by
+ * checkerboard-like patterns; cv_smoothing --benchmark --scale-space prints the error measured on an image.
+ */
+void gaussian_scale_space( const cv::Mat &src, const std::vector<int> &kernel_sizes, ScaleSpace &space );
+
+/**
+ * @function write_scale_space
+ * brief stores the whole stack in a single cv::FileStorage file (.yml, .xml, optionally .gz)
+ */
+bool write_scale_space( const std::string &file_name, const ScaleSpace &space );
+
+/**
+ * @function read_scale_space
+ * brief loads a stack written by write_scale_space
+ */
+bool read_scale_space( const std::string &file_name, ScaleSpace &space );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_BASIC_OPERATIONS_HPP
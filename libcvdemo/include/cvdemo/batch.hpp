@@ -0,0 +1,124 @@
+/**
+ * Batch
+ * brief helpers to run the demos headless over a directory or a glob of images
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_BATCH_HPP
+#define CVDEMO_BATCH_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+namespace cvdemo
+{
+
+/// Options of the headless batch mode: --batch <dir|glob> --out <dir>
+struct BatchOptions
+{
+    BatchOptions() : enabled(false) {}
+
+    bool enabled;
+    std::string input;      /// directory or glob pattern of the input images
+    std::string output_dir; /// directory where the results are written
+};
+
+/**
+ * @function list_images
+ * brief lists the supported images contained in a directory or matching a glob pattern, sorted by name
+ */
+std::vector<std::string> list_images( const std::string &dir_or_glob );
+
+/**
+ * @function make_directory
+ * brief creates the directory if it does not exist yet
+ */
+bool make_directory( const std::string &path );
+
+/**
+ * @function to_writable
+ * brief converts an image to 8 bit, stretching the range of float/integer images, so that it can be stored as png
+ */
+cv::Mat to_writable( const cv::Mat &image );
+
+/**
+ * Writes the results of every stage of a demo on the current input image as
+ * <output_dir>/<image name>_<stage>[_<n>].png
+ */
+class BatchWriter
+{
+public:
+    explicit BatchWriter( const std::string &output_dir );
+
+    /// Starts the results of a new input image
+    void begin( const std::string &image_file );
+    /// Starts a new stage; the name is usually the caption shown in GUI mode
+    void stage( const std::string &name );
+    /// Writes one result of the current stage
+    bool write( const cv::Mat &image );
+    /// File name of the next result of the current stage, for results which are not images (e.g. ".yml.gz")
+    std::string path( const std::string &extension );
+    /// Number of results written so far
+    size_t written() const { return written_; }
+
+private:
+    std::string output_dir_;
+    std::string image_name_;
+    std::string stage_;
+    int stage_index_;
+    size_t written_;
+};
+
+/**
+ * @function run_batch
+ * brief loads every image selected by the options and hands it to process(image, image_file), which returns 0 on success.
+ * Returns the number of images which could not be processed.
+ */
+template<typename Process>
+int run_batch( const BatchOptions &options, BatchWriter &writer, Process process )
+{
+    std::vector<std::string> image_files = list_images(options.input);
+    if(image_files.empty())
+    {
+        std::cout << "No images found in " << options.input << std::endl;
+        return -1;
+    }
+
+    if(!make_directory(options.output_dir))
+    {
+        std::cout << "Cannot create output directory " << options.output_dir << std::endl;
+        return -1;
+    }
+
+    int failed = 0;
+    int64 start = cv::getTickCount();
+    for(size_t i = 0; i < image_files.size(); ++i)
+    {
+        cv::Mat image = cv::imread(image_files[i], 1);
+        if(!image.data)
+        {
+            std::cout << "Skipping invalid image " << image_files[i] << std::endl;
+            ++failed;
+            continue;
+        }
+
+        writer.begin(image_files[i]);
+        if(process(image, image_files[i]) != 0)
+        {
+            std::cout << "Failed to process " << image_files[i] << std::endl;
+            ++failed;
+        }
+    }
+    double seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+    std::cout << "Processed " << image_files.size() - failed << "/" << image_files.size() << " images in "
+              << seconds << " s, " << writer.written() << " results written to " << options.output_dir << std::endl;
+    return failed;
+}
+
+} // namespace cvdemo
+
+#endif // CVDEMO_BATCH_HPP
@@ -0,0 +1,107 @@
+/**
+ * Batch Matching
+ * brief matching of a set of templates against a set of images, every image described once and the
+ * template x image jobs scheduled on a thread pool
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_BATCH_MATCHING_HPP
+#define CVDEMO_BATCH_MATCHING_HPP
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "cvdemo/descriptor_quantization.hpp"
+#include "cvdemo/feature_extraction.hpp"
+#include "cvdemo/geometric_verification.hpp"
+#include "cvdemo/thread_pool.hpp"
+
+namespace cvdemo
+{
+
+/// Parameters of the batch matching
+struct BatchMatchingOptions
+{
+    BatchMatchingOptions() : detector(DETECTOR_ORB), ratio(0.8f), chunk_size(0) {}
+
+    Detector detector;
+    TiledDetection tiling;
+    VerificationOptions verification;
+    QuantizationOptions quantization;   /// float descriptors kept and matched in their compact form, the quantizer
+                                        /// learnt on the templates
+    float ratio;            /// Lowe's ratio of the 2 nearest neighbours
+    int chunk_size;         /// images described and matched together, 0 for twice the threads of the pool: the descriptors
+                            /// of the templates are kept for the whole run, those of an image only for its chunk
+};
+
+/// Outcome of matching one template against one image
+struct TemplateMatch
+{
+    TemplateMatch() : template_index(0), image_index(0), matches(0), inliers(0), ms(0.0) {}
+
+    int template_index;
+    int image_index;
+    int matches;            /// matches passing the ratio test
+    int inliers;            /// inliers of the homography, 0 if it has been rejected
+    cv::Mat homography;     /// template -> image, empty if the template has not been found
+    double ms;              /// matching and verification time of the job
+
+    bool found() const { return !homography.empty(); }
+};
+
+/// A template or an image which gets no jobs
+struct SkippedFile
+{
+    SkippedFile( const std::string &file = std::string(), bool unreadable = false ) : file(file), unreadable(unreadable) {}
+
+    std::string file;
+    bool unreadable;        /// true if the file cannot be read, false if it has no keypoints
+};
+
+/// Where the time of a batch went: the descriptions are N + M, the matching jobs N x M
+struct BatchMatchingStats
+{
+    BatchMatchingStats() : descriptions(0), jobs(0), template_bytes(0), describe_ms(0.0), match_ms(0.0), total_ms(0.0) {}
+
+    int descriptions;       /// images and templates described, each one once
+    size_t jobs;            /// template x image pairs matched
+    size_t template_bytes;  /// memory taken by the descriptors of the templates during the whole run
+    double describe_ms;     /// wall time of the description phases
+    double match_ms;        /// wall time of the matching phases
+    double total_ms;
+    std::vector<SkippedFile> skipped;   /// templates, then images, which cannot be read or have no keypoints
+};
+
+/**
+ * @function match_batch
+ * brief matches every template against every image: the templates are described first, in parallel on the pool, then
+ * the images chunk by chunk, every chunk described in parallel and its template x image jobs run on the pool (2 nearest
+ * neighbours, ratio test and homography verification as in MatchingEngine::run). Images and templates which cannot be
+ * read or have no keypoints get no jobs and are listed in stats->skipped. results are ordered by image, then by template.
+ * The threading of OpenCV is disabled meanwhile (cv::setNumThreads(1), restored afterwards): the pool runs one file or
+ * one job per thread, and the parallel kernels of every job would only compete with it.
+ * Returns 0 on success, -1 if the detector is not available or no template could be described
+ */
+int match_batch( const std::vector<std::string> &template_files, const std::vector<std::string> &image_files,
+                 const BatchMatchingOptions &options, ThreadPool &pool, std::vector<TemplateMatch> &results,
+                 BatchMatchingStats *stats = 0 );
+
+/**
+ * @function write_matches_csv
+ * brief one line per job: template, image, matches, inliers, found, ms and the 9 values of the homography (row major,
+ * empty if not found). False if the file cannot be written
+ */
+bool write_matches_csv( const std::string &path, const std::vector<std::string> &template_files,
+                        const std::vector<std::string> &image_files, const std::vector<TemplateMatch> &results );
+
+/**
+ * @function write_matches_json
+ * brief the jobs as an array of objects with the fields of the CSV, the homography an array of 9 values or null.
+ * False if the file cannot be written
+ */
+bool write_matches_json( const std::string &path, const std::vector<std::string> &template_files,
+                         const std::vector<std::string> &image_files, const std::vector<TemplateMatch> &results );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_BATCH_MATCHING_HPP
@@ -0,0 +1,58 @@
+/**
+ * Buffer Cache
+ * brief intermediate buffers and structuring elements reused across trackbar events and video frames
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_BUFFER_CACHE_HPP
+#define CVDEMO_BUFFER_CACHE_HPP
+
+#include <deque>
+#include <map>
+#include <utility>
+#include <opencv2/core/core.hpp>
+#include "cvdemo/basic_operations.hpp"
+
+namespace cvdemo
+{
+
+/**
+ * Named buffers and structuring elements kept across calls. OpenCV functions reuse the memory of
+ * an output whose size and type do not change, so once the cache is warm no buffer is allocated anymore.
+ * The allocation counter verifies it: it counts the structuring elements created and every buffer
+ * whose data has been (re)allocated since it was last seen. Not thread safe: one cache per thread.
+ */
+class BufferCache
+{
+public:
+    BufferCache() : allocations_(0) {}
+
+    /// Buffer cached under the name; names are compared by content and have to outlive the cache (string literals)
+    cv::Mat& buffer( const char *name );
+    /// Structuring element of structuring_element(), created once per shape and size
+    const cv::Mat& structuring_element( ElementShape shape, int size );
+
+    /// Allocations since the creation of the cache (or the last clear)
+    size_t allocations();
+    /// Releases every buffer and resets the counter
+    void clear();
+
+private:
+    struct Buffer
+    {
+        const char *name;
+        cv::Mat mat;
+        const uchar *data;  /// data of mat when last seen
+    };
+
+    void check( Buffer &buffer );
+
+    /// A deque keeps the references returned by buffer() valid when new buffers are added
+    std::deque<Buffer> buffers_;
+    std::map<std::pair<int, int>, cv::Mat> elements_;
+    size_t allocations_;
+};
+
+} // namespace cvdemo
+
+#endif // CVDEMO_BUFFER_CACHE_HPP
@@ -0,0 +1,64 @@
+/**
+ * Command Line
+ * brief parsing of the command line arguments shared by all the demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_CLI_HPP
+#define CVDEMO_CLI_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+#include "cvdemo/batch.hpp"
+#include "cvdemo/video.hpp"
+
+namespace cvdemo
+{
+
+/**
+ * @function has_image_extension
+ * brief true if the file name ends with one of the supported extensions (*.jpg, *.png)
+ */
+bool has_image_extension( const std::string &file_name );
+
+/**
+ * Parsed command line of a demo: "--name value" options, "--name" switches and positional arguments.
+ * The options expecting a value have to be declared, --batch, --out, --video and --record always expect one.
+ */
+class CommandLine
+{
+public:
+    CommandLine( int argc, const char* const* argv, const std::vector<std::string> &value_options = std::vector<std::string>() );
+
+    /// False if an option misses its value, if only one of --batch/--out is given or if --batch and --video are both given
+    bool valid() const { return error_.empty(); }
+    const std::string& error() const { return error_; }
+
+    /// True if the option or switch (without the leading "--") has been given
+    bool has( const std::string &name ) const;
+    std::string get( const std::string &name, const std::string &default_value = "" ) const;
+    int get_int( const std::string &name, int default_value ) const;
+    double get_double( const std::string &name, double default_value ) const;
+
+    const std::vector<std::string>& positional() const { return positional_; }
+    /// Positional arguments with a supported image extension
+    std::vector<std::string> images() const;
+    BatchOptions batch() const;
+    StreamOptions stream() const;
+
+private:
+    std::map<std::string, std::string> options_;
+    std::vector<std::string> positional_;
+    std::string error_;
+};
+
+/**
+ * @function show_help
+ * brief prints the error message followed by the usages of the application (with the _d suffix in debug builds)
+ */
+void show_help( const std::string &application, const std::vector<std::string> &usages, const std::string &message = "" );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_CLI_HPP
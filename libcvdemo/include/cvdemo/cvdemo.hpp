@@ -0,0 +1,35 @@
+/**
+ * cvdemo
+ * brief convenience header including the whole cvdemo library
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_CVDEMO_HPP
+#define CVDEMO_CVDEMO_HPP
+
+#include "cvdemo/batch.hpp"
+#include "cvdemo/buffer_cache.hpp"
+#include "cvdemo/cli.hpp"
+#include "cvdemo/display.hpp"
+#include "cvdemo/frame_ring.hpp"
+#include "cvdemo/thread_pool.hpp"
+#include "cvdemo/tiled_file.hpp"
+#include "cvdemo/tiling.hpp"
+#include "cvdemo/timing.hpp"
+#include "cvdemo/union_find.hpp"
+#include "cvdemo/video.hpp"
+#include "cvdemo/basic_operations.hpp"
+#include "cvdemo/image_processing.hpp"
+#include "cvdemo/feature_extraction.hpp"
+#include "cvdemo/flann_index.hpp"
+#include "cvdemo/geometric_verification.hpp"
+#include "cvdemo/hamming_matcher.hpp"
+#include "cvdemo/keypoint_tracking.hpp"
+#include "cvdemo/matching_engine.hpp"
+#include "cvdemo/multi_index_hashing.hpp"
+#include "cvdemo/descriptor_index.hpp"
+#include "cvdemo/descriptor_quantization.hpp"
+#include "cvdemo/batch_matching.hpp"
+#include "cvdemo/object_detection.hpp"
+
+#endif // CVDEMO_CVDEMO_HPP
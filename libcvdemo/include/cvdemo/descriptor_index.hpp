@@ -0,0 +1,105 @@
+/**
+ * Descriptor Index
+ * brief keypoints and descriptors of an image collection stored once on disk and memory-mapped for the queries
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_DESCRIPTOR_INDEX_HPP
+#define CVDEMO_DESCRIPTOR_INDEX_HPP
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include "cvdemo/feature_extraction.hpp"
+#include "cvdemo/multi_index_hashing.hpp"
+
+namespace cvdemo
+{
+
+/**
+ * @function build_descriptor_index
+ * brief detects and describes the keypoints of every image and writes them to the index file:
+ * a header, the descriptors of all the images as one contiguous matrix, the keypoints with the id of their image
+ * and the table of the images. Descriptors are streamed to disk image by image, only the table stays in memory.
+ * Images which cannot be read or have no keypoints are indexed without descriptors.
+ * Returns the number of descriptors written, -1 if the detector is not available or the file cannot be written.
+ */
+int64 build_descriptor_index( Detector type, const std::vector<std::string> &image_files, const std::string &index_path );
+
+/**
+ * Read-only view of an index file written by build_descriptor_index. The file is memory-mapped: opening costs no
+ * reading, the descriptors are a cv::Mat on the mapped pages and the operating system pages them in when matched.
+ */
+class DescriptorIndex
+{
+public:
+    DescriptorIndex();
+    ~DescriptorIndex();
+
+    /// Maps the file; false if it cannot be mapped or is not a valid index (sections or image records out of the file)
+    bool open( const std::string &path );
+    void close();
+    bool is_open() const { return data_ != 0; }
+
+    Detector detector() const { return detector_; }
+    int num_images() const { return num_images_; }
+    int64 num_descriptors() const { return num_descriptors_; }
+
+    /// Descriptors of all the images, one row each (no copy, must not be written)
+    const cv::Mat& descriptors() const { return descriptors_; }
+    /// Rows of the descriptors of an image
+    cv::Range image_range( int image ) const;
+    /// Path of the image as given when the index was built
+    std::string image_path( int image ) const;
+    /// Keypoint of a row of the descriptors and the image it belongs to
+    cv::KeyPoint keypoint( int64 row, int *image = 0 ) const;
+
+private:
+    /// Not copyable: the mapping is released by the destructor
+    DescriptorIndex( const DescriptorIndex& );
+    DescriptorIndex& operator=( const DescriptorIndex& );
+
+    const uchar *data_;
+    size_t size_;
+
+    Detector detector_;
+    int num_images_;
+    int64 num_descriptors_;
+    cv::Mat descriptors_;
+    const uchar *keypoints_;
+    const uchar *images_;
+    const char *names_;
+};
+
+/// Image of the index matched by a query
+struct IndexMatch
+{
+    int image;      /// id of the image in the index
+    int matches;    /// template descriptors passing the ratio test against the image
+};
+
+/**
+ * @function query_descriptor_index
+ * brief matches the descriptors of a template against the descriptors of every indexed image (2 nearest neighbours
+ * and ratio test, Hamming for binary descriptors, L2 for float ones), images in parallel.
+ * Returns the images with at least min_matches matches, most matches first.
+ */
+std::vector<IndexMatch> query_descriptor_index( const DescriptorIndex &index, const cv::Mat &template_descriptors,
+                                                int min_matches = 10, float ratio = 0.8f );
+
+/**
+ * @function query_descriptor_index
+ * brief same query for binary descriptors, searched in the multi-index hashing of all the descriptors of the index
+ * (built on index.descriptors()) instead of image by image: the neighbours nearest descriptors of every template
+ * descriptor found within max_radius bits on a substring are grouped by image, and the ratio test of an image compares
+ * its nearest descriptor with its second one, or with the distance every descriptor left out of the list is known to
+ * exceed. Images whose descriptors are all farther than neighbours others are missed, as with any approximate search.
+ */
+std::vector<IndexMatch> query_descriptor_index( const DescriptorIndex &index, const MultiIndexHashing &hashing,
+                                                const cv::Mat &template_descriptors, int min_matches = 10, float ratio = 0.8f,
+                                                int neighbours = 16, int max_radius = 2 );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_DESCRIPTOR_INDEX_HPP
@@ -0,0 +1,64 @@
+/**
+ * Descriptor Quantization
+ * brief compact form of the float descriptors (SIFT, SURF): optional PCA reduction, then one byte per dimension
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_DESCRIPTOR_QUANTIZATION_HPP
+#define CVDEMO_DESCRIPTOR_QUANTIZATION_HPP
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+namespace cvdemo
+{
+
+/// Quantization of the float descriptors before matching
+struct QuantizationOptions
+{
+    QuantizationOptions() : enabled(false), dimensions(0) {}
+
+    bool enabled;
+    int dimensions;     /// PCA components kept, 0 (or at least the descriptor length) quantizes without PCA
+
+    bool pca( int descriptor_length ) const { return dimensions > 0 && dimensions < descriptor_length; }
+};
+
+/**
+ * Maps CV_32F descriptors to CV_8U ones of dimensions() bytes: the PCA projection learnt on the train descriptors
+ * if enabled, then a single affine map to [0, 255] of the range of the train values. The map is the same for every
+ * dimension, so that Euclidean distances are preserved up to the factor scale(): the quantized descriptors are matched
+ * with L2ByteNorm (matching_engine.hpp) in integers, a SIFT descriptor takes 128 bytes instead of 512
+ */
+class DescriptorQuantizer
+{
+public:
+    DescriptorQuantizer() : projected_(false), dimensions_(0), scale_(1.0f), offset_(0.0f) {}
+
+    /// Learns the projection (with options.pca) and the range of the descriptors; false if they are not CV_32F
+    bool train( const cv::Mat &descriptors, const QuantizationOptions &options );
+
+    bool empty() const { return dimensions_ == 0; }
+    /// Bytes of a quantized descriptor
+    int dimensions() const { return dimensions_; }
+    /// Quantized units per float unit
+    float scale() const { return scale_; }
+
+    /// CV_8U descriptors, one row per row of descriptors (CV_32F, with the length of the train descriptors)
+    void quantize( const cv::Mat &descriptors, cv::Mat &quantized ) const;
+
+    /// Converts the distances of matches between quantized descriptors back to the units of the float descriptors
+    void to_float_distances( std::vector<std::vector<cv::DMatch> > &matches ) const;
+
+private:
+    cv::PCA pca_;
+    bool projected_;
+    int dimensions_;
+    float scale_;
+    float offset_;
+};
+
+} // namespace cvdemo
+
+#endif // CVDEMO_DESCRIPTOR_QUANTIZATION_HPP
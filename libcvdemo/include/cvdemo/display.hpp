@@ -0,0 +1,49 @@
+/**
+ * Display
+ * brief shows the stages of a demo in a window, or writes them to disk in batch mode
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_DISPLAY_HPP
+#define CVDEMO_DISPLAY_HPP
+
+#include <string>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include "cvdemo/batch.hpp"
+
+namespace cvdemo
+{
+
+/**
+ * Window of a demo. Once a BatchWriter is attached, no GUI call is made anymore:
+ * captions become the stage names and the shown images are written to disk.
+ */
+class Display
+{
+public:
+    explicit Display( const std::string &window_name, int caption_delay = 2000 );
+
+    /// Switches to the headless batch mode (0 switches back to the GUI)
+    void set_writer( BatchWriter *writer ) { writer_ = writer; }
+    bool headless() const { return writer_ != 0; }
+    const std::string& window_name() const { return window_name_; }
+
+    /// Creates the window
+    void open( int flags = cv::WINDOW_AUTOSIZE ) const;
+    /// Shows a caption on a black image as big as reference; returns -1 if a key is pressed
+    int caption( const std::string &text, const cv::Mat &reference ) const;
+    /// Shows the image and waits delay ms (not at all if negative); returns -1 if a key is pressed
+    int show( const cv::Mat &image, int delay = -1 ) const;
+    /// Waits for a key press, returns the key code
+    int wait( int delay = 0 ) const;
+
+private:
+    std::string window_name_;
+    int caption_delay_;
+    BatchWriter *writer_;
+};
+
+} // namespace cvdemo
+
+#endif // CVDEMO_DISPLAY_HPP
@@ -0,0 +1,141 @@
+/**
+ * Feature Extraction
+ * brief keypoint detection and matching used by the ORB, BRISK, SIFT and SURF demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_FEATURE_EXTRACTION_HPP
+#define CVDEMO_FEATURE_EXTRACTION_HPP
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include "cvdemo/descriptor_quantization.hpp"
+#include "cvdemo/flann_index.hpp"
+#include "cvdemo/geometric_verification.hpp"
+#include "cvdemo/multi_index_hashing.hpp"
+
+namespace cvdemo
+{
+
+/// Keypoint detectors/descriptors available to the feature demos
+enum Detector
+{
+    DETECTOR_ORB = 0,
+    DETECTOR_BRISK,
+    DETECTOR_SIFT,
+    DETECTOR_SURF
+};
+
+/// Keypoints and matches between a template and a full image
+struct KeypointMatches
+{
+    std::vector<cv::KeyPoint> template_keypoints;
+    std::vector<cv::KeyPoint> full_keypoints;
+    cv::Mat template_descriptors;
+    cv::Mat full_descriptors;
+    std::vector<cv::DMatch> matches;        /// matches passing the ratio test, best first
+    std::vector<cv::DMatch> good_matches;   /// inliers of the homography, empty if it has been rejected
+    cv::Mat homography;                     /// template -> full image, empty if the matches are not verified
+};
+
+/// Tiled detection: overlapping tiles detected and described in parallel, keypoints then bucketed on a grid
+struct TiledDetection
+{
+    TiledDetection() : tile_size(0), overlap(-1), cell_size(64), max_per_cell(0) {}
+
+    int tile_size;      /// side of the tiles in pixels, 0 detects on the whole image at once
+    int overlap;        /// pixels shared by neighbouring tiles, negative for the detector_border of the detector
+    int cell_size;      /// side of the cells of the bucketing grid in pixels
+    int max_per_cell;   /// strongest keypoints kept in every cell, 0 keeps all of them
+
+    bool enabled() const { return tile_size > 0 || max_per_cell > 0; }
+};
+
+/**
+ * @function detector_name
+ * brief "ORB", "BRISK", "SIFT" or "SURF"
+ */
+std::string detector_name( Detector type );
+
+/**
+ * @function parse_detector
+ * brief detector of a name given on the command line ("orb", "brisk", "sift" or "surf", any case); false if unknown
+ */
+bool parse_detector( const std::string &name, Detector &type );
+
+/**
+ * @function create_detector
+ * brief creates the detector, an empty pointer is returned if it is not available
+ * (SIFT and SURF need OpenCV 3.x with the contrib module)
+ */
+cv::Ptr<cv::Feature2D> create_detector( Detector type );
+
+/**
+ * @function detector_border
+ * brief pixels along the image border in which the detector of create_detector finds no keypoint at its coarsest scale,
+ * the overlap the tiles need for the keypoints of their core: 112 for ORB (edge threshold of 31 px at the 8th level of
+ * its 1.2 pyramid), 72 for BRISK (keypoints of 12 px at its coarsest layer, scale 6). SIFT and SURF get 96, their
+ * coarsest scales grow with the image: the largest of their keypoints can still be cut by a seam
+ */
+int detector_border( Detector type );
+
+/**
+ * @function create_matcher
+ * brief OpenCV matcher for the descriptors of the detector: brute force Hamming for the binary descriptors (ORB, BRISK)
+ * unless LSH is chosen, FLANN KD-trees for the float ones (SIFT, SURF), with the trees and checks of the options.
+ * The demos match with the MatchingEngine instead
+ */
+cv::Ptr<cv::DescriptorMatcher> create_matcher( Detector type, const FlannOptions &options = FlannOptions() );
+
+/**
+ * @function detect_and_compute
+ * brief detects and describes the keypoints in a single call, so that the detector builds its scale pyramid once
+ * instead of once in detect() and again in compute(). Returns the number of keypoints
+ */
+size_t detect_and_compute( const cv::Ptr<cv::Feature2D> &detector, const cv::Mat &image, std::vector<cv::KeyPoint> &keypoints,
+                           cv::Mat &descriptors );
+
+/**
+ * @function detect_and_compute_tiled
+ * brief detects and describes the keypoints of overlapping tiles in parallel, every tile with its own detector (the
+ * whole image is a single tile if options.tile_size is 0). ORB keeps a fixed number of features wherever it runs, so a
+ * tile gets the share of the image budget of its area and the total does not grow with the number of tiles; the other
+ * detectors keep every keypoint above their threshold. A tile keeps the keypoints of its core only, so that the
+ * overlaps give no duplicates, then the keypoints are bucketed with bucket_keypoints.
+ * Returns the number of keypoints, -1 if the detector is not available
+ */
+int detect_and_compute_tiled( Detector type, const cv::Mat &image, const TiledDetection &options,
+                              std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors );
+
+/**
+ * @function bucket_keypoints
+ * brief keeps the max_per_cell keypoints with the strongest response in every cell_size x cell_size cell of the image,
+ * with their descriptors, so that textured regions do not take all the keypoints. The order of the kept keypoints is preserved
+ */
+void bucket_keypoints( std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors, int cell_size, int max_per_cell );
+
+/**
+ * @function match_keypoints
+ * brief detects, describes and matches the keypoints of the template against the full image, with the
+ * MatchingEngine of the detector (matching_engine.hpp), tiled, with a FLANN index, with quantized float descriptors
+ * and with the multi-index hashing of binary template descriptors if the options are enabled, then verifies the matches
+ * passing the ratio test with a homography (geometric_verification.hpp).
+ * Returns 0 on success, -1 if the detector is not available or no keypoints are found.
+ */
+int match_keypoints( Detector type, const cv::Mat &image_template, const cv::Mat &image_full, KeypointMatches &result,
+                     const TiledDetection &tiling = TiledDetection(), const VerificationOptions &verification = VerificationOptions(),
+                     const FlannOptions &flann = FlannOptions(), const QuantizationOptions &quantization = QuantizationOptions(),
+                     const HashingOptions &hashing = HashingOptions() );
+
+/**
+ * @function draw_matches
+ * brief draws the good matches side by side, template on the left, with the outline of the template in the full image
+ * if the homography has been found
+ */
+void draw_matches( const cv::Mat &image_template, const cv::Mat &image_full, const KeypointMatches &result, cv::Mat &dst );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_FEATURE_EXTRACTION_HPP
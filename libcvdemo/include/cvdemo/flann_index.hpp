@@ -0,0 +1,89 @@
+/**
+ * FLANN Index
+ * brief approximate nearest neighbour matching with a tunable FLANN index, which can be saved and loaded again
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_FLANN_INDEX_HPP
+#define CVDEMO_FLANN_INDEX_HPP
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include <opencv2/flann/flann.hpp>
+
+namespace cvdemo
+{
+
+/// Parameters of the FLANN index
+struct FlannOptions
+{
+    /// Brute force matching, randomized KD-trees (float descriptors) or LSH (binary descriptors)
+    enum Algorithm { BRUTE_FORCE = 0, KDTREE, LSH };
+
+    FlannOptions() : algorithm(BRUTE_FORCE), trees(4), checks(32), table_number(12), key_size(20), multi_probe_level(2),
+                     update_cache(true) {}
+
+    Algorithm algorithm;
+    int trees;              /// KD-trees: number of randomized trees
+    int checks;             /// leaves visited per query: more checks, higher recall and latency
+    int table_number;       /// LSH: number of hash tables
+    int key_size;           /// LSH: bits of the hash keys
+    int multi_probe_level;  /// LSH: neighbouring buckets probed
+    std::string index_path; /// cache of the index: loaded if built on the same train descriptors, written otherwise
+    bool update_cache;      /// false writes the cache only if there is none, an index of other descriptors is kept
+
+    bool enabled() const { return algorithm != BRUTE_FORCE; }
+};
+
+/**
+ * @function parse_flann_algorithm
+ * brief algorithm of a name given on the command line ("kdtree" or "lsh"); false if unknown
+ */
+bool parse_flann_algorithm( const std::string &name, FlannOptions::Algorithm &algorithm );
+
+/**
+ * FLANN index of a fixed set of train descriptors. The index only references its descriptors, so save() writes them
+ * next to it (<path>.train: a header with the parameters, the size, the type and a checksum, then the raw rows) and
+ * load() restores both: a reference set is indexed once.
+ */
+class FlannIndex
+{
+public:
+    /// Builds the index; KD-trees index binary descriptors as float vectors, LSH needs binary (CV_8U) descriptors.
+    /// False if the descriptors do not suit the algorithm
+    bool build( const cv::Mat &train, const FlannOptions &options );
+    bool save( const std::string &path ) const;
+    bool load( const std::string &path );
+
+    bool empty() const { return index_.empty(); }
+    const cv::Mat& train() const { return train_; }
+    const FlannOptions& options() const { return options_; }
+    /// Checks are a search parameter: they can change without rebuilding the index
+    void set_checks( int checks ) { options_.checks = checks; }
+
+    /// k approximate nearest train descriptors of every query descriptor, closest first (Euclidean or Hamming distances)
+    void knn_match( const cv::Mat &query, std::vector<std::vector<cv::DMatch> > &matches, int k ) const;
+
+private:
+    void create();
+
+    cv::Mat train_;
+    cv::Mat features_;  /// train_, as float for the KD-trees
+    FlannOptions options_;
+    cv::Ptr<cv::flann::Index> index_;
+};
+
+/**
+ * @function cached_flann_index
+ * brief the index of the train descriptors: loaded from options.index_path if it was built on the same descriptors
+ * with the same algorithm (compared by the header of the saved descriptors, with the checksum of train), built
+ * otherwise and written there if a path is given, unless it holds another index and options.update_cache is false.
+ * False if it cannot be built
+ */
+bool cached_flann_index( const cv::Mat &train, const FlannOptions &options, FlannIndex &index );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_FLANN_INDEX_HPP
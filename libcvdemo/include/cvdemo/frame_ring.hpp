@@ -0,0 +1,75 @@
+/**
+ * Frame Ring
+ * brief lock-free ring of preallocated slots handed over from stage to stage by index
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_FRAME_RING_HPP
+#define CVDEMO_FRAME_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace cvdemo
+{
+
+/**
+ * Ring of preallocated slots shared by a chain of STAGES threads, one thread per stage.
+ * Every stage owns a cursor (the number of slots it has handed over) and only reads the cursor of the stage
+ * before it, so each pair of consecutive stages is a single-producer/single-consumer queue without locks.
+ * The slots are never copied nor reallocated: the first stage reuses a slot once the last stage has released it.
+ */
+template<typename T, size_t STAGES>
+class FrameRing
+{
+public:
+    /// The capacity is rounded up to a power of two
+    explicit FrameRing( size_t capacity )
+        : slots_(round_up(capacity)), mask_(slots_.size() - 1)
+    {
+        for(size_t s = 0; s < STAGES; ++s)
+            cursors_[s].value.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+    /// Next slot of the stage, 0 if the stage before has not handed it over yet (for the first stage: the ring is full)
+    T* try_acquire( size_t stage )
+    {
+        const size_t position = cursors_[stage].value.load(std::memory_order_relaxed);
+        const size_t limit = stage == 0 ? cursors_[STAGES - 1].value.load(std::memory_order_acquire) + capacity()
+                                        : cursors_[stage - 1].value.load(std::memory_order_acquire);
+        return position < limit ? &slots_[position & mask_] : 0;
+    }
+
+    /// Hands the slot acquired by the stage over to the next one
+    void release( size_t stage )
+    {
+        const size_t position = cursors_[stage].value.load(std::memory_order_relaxed);
+        cursors_[stage].value.store(position + 1, std::memory_order_release);
+    }
+
+private:
+    /// Every cursor on its own cache line, so that the stages do not invalidate each other's line
+    struct Cursor
+    {
+        alignas(64) std::atomic<size_t> value;
+    };
+
+    static size_t round_up( size_t capacity )
+    {
+        size_t size = 1;
+        while(size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    std::vector<T> slots_;
+    size_t mask_;
+    Cursor cursors_[STAGES];
+};
+
+} // namespace cvdemo
+
+#endif // CVDEMO_FRAME_RING_HPP
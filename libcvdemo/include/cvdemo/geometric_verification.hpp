@@ -0,0 +1,66 @@
+/**
+ * Geometric Verification
+ * brief ratio test and robust homography estimation of the matches between a template and an image
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_GEOMETRIC_VERIFICATION_HPP
+#define CVDEMO_GEOMETRIC_VERIFICATION_HPP
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+namespace cvdemo
+{
+
+/// Parameters of the homography estimation
+struct VerificationOptions
+{
+    VerificationOptions() : prosac(true), threshold(3.0), confidence(0.995), max_iterations(2000), min_inliers(8) {}
+
+    bool prosac;            /// PROSAC: samples drawn from the best matches first; plain RANSAC otherwise
+    double threshold;       /// largest reprojection error of an inlier, in pixels
+    double confidence;      /// probability of having drawn an outlier-free sample when the iterations stop
+    int max_iterations;
+    int min_inliers;        /// fewer inliers reject the homography
+};
+
+/// Outcome of the verification: the homography (template -> image) and the matches consistent with it
+struct Verification
+{
+    Verification() : iterations(0) {}
+
+    cv::Mat homography;                 /// 3x3 CV_64F, empty if the matches are not verified
+    std::vector<cv::DMatch> inliers;
+    int iterations;                     /// hypotheses tested before the termination criterion was met
+};
+
+/**
+ * @function ratio_test
+ * brief Lowe's ratio test on the 2 nearest neighbours of every query descriptor: keeps the nearest one if it is closer
+ * than ratio times the second one. The matches are sorted by distance, best first, as PROSAC expects them
+ */
+void ratio_test( const std::vector<std::vector<cv::DMatch> > &knn_matches, float ratio, std::vector<cv::DMatch> &matches );
+
+/**
+ * @function estimate_homography
+ * brief homography mapping src to dst (correspondences best first for PROSAC), see below; inlier_mask receives
+ * 1 for the inliers and 0 for the outliers. Returns the number of inliers, 0 if rejected
+ */
+int estimate_homography( const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, const VerificationOptions &options,
+                         cv::Mat &homography, std::vector<uchar> &inlier_mask, int *iterations = 0 );
+
+/**
+ * @function estimate_homography
+ * brief homography mapping the query keypoints of the matches to their train keypoints, by RANSAC or PROSAC on minimal
+ * samples of 4 matches. The iterations stop as soon as the number of hypotheses needed for the confidence, given the
+ * best inlier ratio so far, has been tested; the best hypothesis is refined on all its inliers.
+ * matches must be sorted best first for PROSAC (ratio_test does it). Returns the number of inliers, 0 if rejected
+ */
+int estimate_homography( const std::vector<cv::KeyPoint> &query_keypoints, const std::vector<cv::KeyPoint> &train_keypoints,
+                         const std::vector<cv::DMatch> &matches, const VerificationOptions &options, Verification &result );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_GEOMETRIC_VERIFICATION_HPP
@@ -0,0 +1,77 @@
+/**
+ * Hamming Matcher
+ * brief brute force matching of binary descriptors (ORB, BRISK) with SIMD popcount kernels
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_HAMMING_MATCHER_HPP
+#define CVDEMO_HAMMING_MATCHER_HPP
+
+#include <cstring>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+namespace cvdemo
+{
+
+/**
+ * @function popcount64
+ * brief number of bits set: the POPCNT instruction if the build enables it, a portable bit count otherwise
+ */
+inline int popcount64( uint64 value )
+{
+    #if defined(__GNUC__) && defined(__POPCNT__)
+    return __builtin_popcountll(value);
+    #else
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((value * 0x0101010101010101ULL) >> 56);
+    #endif
+}
+
+/**
+ * @function hamming_distance
+ * brief Hamming distance of descriptors of any length, 64 bits at a time
+ */
+inline int hamming_distance( const uchar *a, const uchar *b, int bytes )
+{
+    int distance = 0, i = 0;
+    for( ; i + 8 <= bytes; i += 8 )
+    {
+        uint64 x, y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        distance += popcount64(x ^ y);
+    }
+    for( ; i < bytes; ++i )
+        distance += popcount64(static_cast<uint64>(a[i] ^ b[i]));
+    return distance;
+}
+
+/**
+ * @function hamming_kernel_name
+ * brief popcount kernel compiled in: "AVX-512 VPOPCNTDQ", "AVX2", "POPCNT" or "portable"
+ * (-DUSE_AVX512=ON / -DUSE_AVX2=ON in CMake)
+ */
+const char* hamming_kernel_name();
+
+/**
+ * @function hamming_knn_match
+ * brief the k nearest train descriptors of every query descriptor (CV_8U rows), closest first, equal distances in the
+ * order of the train descriptors: the matches of cv::BFMatcher(cv::NORM_HAMMING).knnMatch.
+ * 256 and 512 bit descriptors (ORB, BRISK) have dedicated kernels, any other length works with a generic one.
+ * The queries are compared in blocks against cache-sized blocks of train descriptors, the query blocks in parallel
+ */
+void hamming_knn_match( const cv::Mat &query, const cv::Mat &train, std::vector<std::vector<cv::DMatch> > &matches, int k );
+
+/**
+ * @function hamming_match
+ * brief the nearest train descriptor of every query descriptor (hamming_knn_match with k = 1)
+ */
+void hamming_match( const cv::Mat &query, const cv::Mat &train, std::vector<cv::DMatch> &matches );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_HAMMING_MATCHER_HPP
@@ -0,0 +1,199 @@
+/**
+ * Image Processing
+ * brief edges, gradients, histograms and watershed segmentation used by the image_processing demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_IMAGE_PROCESSING_HPP
+#define CVDEMO_IMAGE_PROCESSING_HPP
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+namespace cvdemo
+{
+
+class BufferCache;
+class TiledImageFile;
+
+/// Gradients of the gradients demo, computed as CV_64F images
+enum Gradient
+{
+    SOBEL_X = 0,
+    SOBEL_Y,
+    SCHARR_X,
+    SCHARR_Y,
+    LAPLACIAN,
+    SOBEL_XY
+};
+
+/// Intermediate and final results of the watershed segmentation
+struct WatershedStages
+{
+    WatershedStages() : num_components(0), keep_intermediate(false) {}
+
+    cv::Mat binary;         /// Otsu threshold cleaned by an opening
+    cv::Mat background;     /// sure background, dilation of binary
+    cv::Mat distance;       /// distance transform of binary (CV_32F)
+    cv::Mat foreground;     /// sure foreground, threshold of the distance
+    cv::Mat unknown;        /// background - foreground
+    cv::Mat markers;        /// labels after the watershed (CV_32S, -1 on the boundaries)
+    cv::Mat segmentation;   /// colorized markers
+    int num_components;
+    /// watershed_preprocess_fused only: also compute background, distance and unknown, which the segmentation does
+    /// not need (e.g. to display them). Otherwise they are released
+    bool keep_intermediate;
+};
+
+/**
+ * @function canny
+ * brief Canny edge detector with the given hysteresis thresholds
+ */
+void canny( const cv::Mat &src, cv::Mat &edges, double min_threshold, double max_threshold );
+
+/**
+ * @function gradient
+ * brief computes the gradient of a grayscale image as a CV_64F image
+ */
+void gradient( const cv::Mat &src_gray, cv::Mat &dst, Gradient type );
+
+/**
+ * @function brightness_contrast
+ * brief converts to grayscale and applies brightness and contrast, both in [-100, 100]
+ */
+void brightness_contrast( const cv::Mat &src, cv::Mat &dst, int brightness, int contrast );
+/// Same, with the grayscale image kept in the cache
+void brightness_contrast( const cv::Mat &src, cv::Mat &dst, int brightness, int contrast, BufferCache &cache );
+
+/**
+ * @function histogram_image
+ * brief draws the histogram of a grayscale image as black bars on a white 320x200 image
+ */
+void histogram_image( const cv::Mat &gray, cv::Mat &hist_image, int hist_size = 64 );
+/// Same, with the histogram kept in the cache
+void histogram_image( const cv::Mat &gray, cv::Mat &hist_image, BufferCache &cache, int hist_size = 64 );
+
+/**
+ * @function watershed
+ * brief segments a BGR image with the watershed algorithm, seeded by the distance transform of the Otsu threshold.
+ * With band_rows > 0 the preprocessing is fused on bands of band_rows rows (watershed_preprocess_fused)
+ */
+void watershed( const cv::Mat &src, WatershedStages &stages, int band_rows = 0 );
+
+/**
+ * @function watershed_preprocess
+ * brief computes binary, background, distance, foreground and unknown, every step as a full image pass
+ */
+void watershed_preprocess( const cv::Mat &src, WatershedStages &stages );
+
+/**
+ * @function watershed_preprocess_fused
+ * brief watershed_preprocess for large images, which only allocates at full size the two 8 bit images consumed by
+ * the segmentation: binary (watershed_binary) and foreground, thresholded in place from the distance of
+ * distance_transform_banded. The background and the unknown region are computed on bands by mark_unknown_fused
+ * straight into the markers. With stages.keep_intermediate, background, distance and unknown are computed as well.
+ * A binary_threshold >= 0 replaces the Otsu threshold of the grayscale image, a foreground_threshold >= 0 the Otsu
+ * threshold of the distance converted to 8 bit (e.g. both computed on the whole image by the tiles)
+ */
+void watershed_preprocess_fused( const cv::Mat &src, WatershedStages &stages, int band_rows = 64, int binary_threshold = -1,
+                                 int foreground_threshold = -1 );
+
+/**
+ * @function watershed_binary
+ * brief Otsu threshold (or binary_threshold >= 0) and opening of watershed_preprocess, streamed through bands of
+ * band_rows rows plus the 4 rows reached by the opening: the grayscale image and the morphology temporaries are never
+ * allocated at full size
+ */
+void watershed_binary( const cv::Mat &src, cv::Mat &binary, int band_rows = 64, int binary_threshold = -1 );
+
+/**
+ * @function distance_transform_banded
+ * brief distance transform of the watershed, converted to 8 bit (CV_8U, saturated at 255) and computed on bands of
+ * band_rows rows plus 256 rows above and below: every distance up to 255 is reached within them, so that the result is
+ * the conversion of the whole image transform, without its CV_32F image
+ */
+void distance_transform_banded( const cv::Mat &binary, cv::Mat &distance, int band_rows = 1024 );
+
+/**
+ * @function distance_histogram
+ * brief adds the distance transform (CV_32F, or CV_8U from distance_transform_banded) converted to 8 bit to the
+ * 256 bins histogram, without storing the conversion
+ */
+void distance_histogram( const cv::Mat &distance, size_t histogram[256] );
+
+/**
+ * @function watershed_segment
+ * brief labels the foreground of the preprocessed stages, marks the unknown region (mark_unknown_fused when the
+ * stages have no unknown image) and runs the watershed
+ */
+void watershed_segment( const cv::Mat &src, WatershedStages &stages );
+
+/// Area, bounding box and centroid of a connected component
+struct ComponentStats
+{
+    int area;
+    cv::Rect bbox;
+    cv::Point2d centroid;
+};
+
+/**
+ * @function label_components
+ * brief labels the connected components of the non-zero pixels of a CV_8UC1 image with 4- or 8-connectivity:
+ * CV_32S labels numbered in the raster order of their first pixel, 0 for the background, as cv::connectedComponents.
+ * Returns the number of labels, background included. The rows are split in strips scanned in parallel, the
+ * provisional labels of the strips are merged along the seams with a lock-free union-find and relabelled in parallel.
+ * If stats is given, it receives the statistics of every label (stats[0]: the background)
+ */
+int label_components( const cv::Mat &binary, cv::Mat &labels, int connectivity = 8, std::vector<ComponentStats> *stats = 0 );
+
+/**
+ * @function label_markers
+ * brief labels the connected components of the foreground (CV_32S markers, 8-connectivity), returns their number,
+ * background included
+ */
+int label_markers( const cv::Mat &foreground, cv::Mat &markers );
+
+/**
+ * @function mark_unknown
+ * brief shifts the labels by one, so that the background is not 0, and sets the unknown region (255) to 0.
+ * Parallel over the rows
+ */
+void mark_unknown( cv::Mat &markers, const cv::Mat &unknown );
+
+/**
+ * @function mark_unknown_fused
+ * brief mark_unknown without the background and unknown images: the background (dilation of binary) is computed on
+ * bands of band_rows rows, and its pixels outside of the foreground are set to 0 in the markers. Parallel over the bands
+ */
+void mark_unknown_fused( cv::Mat &markers, const cv::Mat &binary, const cv::Mat &foreground, int band_rows = 64 );
+
+/**
+ * @function colorize_markers
+ * brief paints every label with a random color, the boundaries (-1) in white
+ */
+void colorize_markers( const cv::Mat &markers, int num_components, cv::Mat &dst );
+/// Same, label i painted with colors[i - 1]: a lookup table per pixel, parallel over the rows
+void colorize_markers( const cv::Mat &markers, const std::vector<cv::Vec3b> &colors, cv::Mat &dst );
+
+/**
+ * @function otsu_threshold
+ * brief Otsu threshold of a 256 bins histogram, computed as cv::threshold does with THRESH_OTSU
+ */
+int otsu_threshold( const size_t histogram[256], size_t total );
+
+/**
+ * @function watershed_tiled
+ * brief out-of-core watershed of an image on disk, which never needs to fit in memory: the tiles (tile_size pixels,
+ * plus overlap pixels on every side) are read one at a time and segmented independently, with the Otsu thresholds of
+ * the grayscale image and of the distance transform computed on the whole image by two first passes over the tiles,
+ * so that every tile is binarized and seeded alike. The labels of adjacent tiles covering the same pixels along the seams are merged with a union-find.
+ * Writes the merged labels (raw CV_32S, -1 on the boundaries, 1 the background) to labels_path and, if segmentation_path
+ * is not empty, the colorized labels as PPM. Returns 0, or -1 if a file cannot be read or written
+ */
+int watershed_tiled( TiledImageFile &input, const std::string &labels_path, const std::string &segmentation_path,
+                     int tile_size = 1024, int overlap = 64, int *num_segments = 0 );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_IMAGE_PROCESSING_HPP
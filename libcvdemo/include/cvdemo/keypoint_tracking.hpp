@@ -0,0 +1,108 @@
+/**
+ * Keypoint Tracking
+ * brief location of a template in a video: keypoints detected and matched on keyframes only, tracked with
+ * pyramidal Lucas-Kanade optical flow in the frames between them
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_KEYPOINT_TRACKING_HPP
+#define CVDEMO_KEYPOINT_TRACKING_HPP
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include "cvdemo/feature_extraction.hpp"
+#include "cvdemo/geometric_verification.hpp"
+
+namespace cvdemo
+{
+
+class KeyframeMatcher;
+
+/// Parameters of the tracking
+struct TrackingOptions
+{
+    TrackingOptions() : enabled(true), min_tracks(30), window_size(21), levels(3), max_backward_error(1.0), keyframe_interval(0) {}
+
+    bool enabled;               /// false detects and matches every frame (every frame is a keyframe)
+    int min_tracks;             /// fewer tracked inliers of the homography make the frame a keyframe
+    int window_size;            /// side of the Lucas-Kanade window in pixels
+    int levels;                 /// pyramid levels above the frame
+    double max_backward_error;  /// tracks which do not come back within this many pixels when tracked backwards are lost
+    int keyframe_interval;      /// a keyframe at least every n frames, 0 only when the tracks are lost
+};
+
+/// Location of the template in a frame
+struct TrackedFrame
+{
+    TrackedFrame() : keyframe(false), tracks(0), ms(0.0) {}
+
+    bool keyframe;                      /// the keypoints have been detected and matched, not tracked
+    int tracks;                         /// inliers of the homography, tracked to the next frame
+    cv::Mat homography;                 /// template -> frame, empty if the template has not been found
+    std::vector<cv::Point2f> points;    /// positions of the tracks in the frame
+    double ms;                          /// processing time of the frame
+
+    bool found() const { return !homography.empty(); }
+};
+
+/**
+ * Locates a template in consecutive frames. A keyframe detects and describes the frame and matches it against the
+ * template (as MatchingEngine::run); the inliers of the homography become the tracks. The following frames only track
+ * them with pyramidal Lucas-Kanade, forward then backward to drop the unreliable ones, and verify them with a
+ * homography, sampled best tracks first (PROSAC): the frame becomes a keyframe when fewer than min_tracks survive.
+ * The pyramid of a frame is built once and reused as the previous pyramid of the next frame, the MatchingEngine of the
+ * detector (and the detector itself) is created once by set_template and reused by every keyframe.
+ */
+class TemplateTracker
+{
+public:
+    explicit TemplateTracker( Detector type, const TrackingOptions &options = TrackingOptions(),
+                              const TiledDetection &tiling = TiledDetection(), const VerificationOptions &verification = VerificationOptions() );
+    ~TemplateTracker();
+
+    /// Describes the template, the next frame is a keyframe. False if the detector is not available or no keypoints are found
+    bool set_template( const cv::Mat &image_template );
+
+    /// Locates the template in the next frame. Returns 0 on success (even if the template is not found), -1 without template
+    int track( const cv::Mat &frame, TrackedFrame &result );
+
+    /// The next frame is a keyframe
+    void reset() { template_points_.clear(); }
+
+    size_t keyframes() const { return keyframes_; }
+    const std::vector<cv::KeyPoint>& template_keypoints() const { return template_keypoints_; }
+
+private:
+    /// Not copyable: the matcher is released by the destructor
+    TemplateTracker( const TemplateTracker& );
+    TemplateTracker& operator=( const TemplateTracker& );
+
+    int detect( const cv::Mat &frame, TrackedFrame &result );
+    void flow( TrackedFrame &result );
+
+    Detector type_;
+    TrackingOptions options_;
+    TiledDetection tiling_;
+    VerificationOptions verification_;
+    KeyframeMatcher *matcher_;                  /// engine of the detector, 0 until set_template
+
+    std::vector<cv::KeyPoint> template_keypoints_;
+    cv::Mat template_descriptors_;
+
+    std::vector<cv::Point2f> template_points_;  /// template side of the tracks
+    std::vector<cv::Point2f> points_;           /// frame side of the tracks, in the previous frame
+    std::vector<cv::Mat> previous_pyramid_, pyramid_;
+    int since_keyframe_;
+    size_t keyframes_;
+};
+
+/**
+ * @function draw_tracked
+ * brief draws the tracks and the outline of the template on the frame: yellow on keyframes, green on tracked frames
+ */
+void draw_tracked( const cv::Mat &frame, const cv::Size &template_size, const TrackedFrame &tracked, cv::Mat &dst );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_KEYPOINT_TRACKING_HPP
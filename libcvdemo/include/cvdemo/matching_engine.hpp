@@ -0,0 +1,378 @@
+/**
+ * Matching Engine
+ * brief keypoint detection, description and brute force matching shared by the feature demos, with the descriptor
+ * distance selected at compile time from the detector
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_MATCHING_ENGINE_HPP
+#define CVDEMO_MATCHING_ENGINE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "cvdemo/descriptor_quantization.hpp"
+#include "cvdemo/feature_extraction.hpp"
+#include "cvdemo/flann_index.hpp"
+#include "cvdemo/geometric_verification.hpp"
+#include "cvdemo/hamming_matcher.hpp"
+#include "cvdemo/multi_index_hashing.hpp"
+
+namespace cvdemo
+{
+
+/// Hamming distance of binary descriptors (ORB, BRISK), 64 bits at a time
+struct HammingNorm
+{
+    typedef uchar ValueType;
+    typedef int DistanceType;
+    enum { DEPTH = CV_8U, NORM_TYPE = cv::NORM_HAMMING };
+
+    static DistanceType distance( const uchar *a, const uchar *b, int length ) { return hamming_distance(a, b, length); }
+
+    static float to_distance( DistanceType distance ) { return static_cast<float>(distance); }
+};
+
+/// Euclidean distance of float descriptors (SIFT, SURF), compared squared and rooted only for the matches
+struct L2Norm
+{
+    typedef float ValueType;
+    typedef float DistanceType;
+    enum { DEPTH = CV_32F, NORM_TYPE = cv::NORM_L2 };
+
+    static DistanceType distance( const float *a, const float *b, int length )
+    {
+        float sum = 0.0f;
+        for( int i = 0; i < length; ++i )
+        {
+            const float difference = a[i] - b[i];
+            sum += difference * difference;
+        }
+        return sum;
+    }
+
+    static float to_distance( DistanceType distance ) { return std::sqrt(distance); }
+};
+
+/// Euclidean distance of quantized float descriptors (DescriptorQuantizer), compared squared in integers: 255^2 per
+/// byte leaves room for 33000 bytes in an int, and the loop vectorizes on 16 bit products
+struct L2ByteNorm
+{
+    typedef uchar ValueType;
+    typedef int DistanceType;
+    enum { DEPTH = CV_8U, NORM_TYPE = cv::NORM_L2 };
+
+    static DistanceType distance( const uchar *a, const uchar *b, int length )
+    {
+        int sum = 0;
+        for( int i = 0; i < length; ++i )
+        {
+            const int difference = a[i] - b[i];
+            sum += difference * difference;
+        }
+        return sum;
+    }
+
+    static float to_distance( DistanceType distance ) { return std::sqrt(static_cast<float>(distance)); }
+};
+
+/// Descriptor distance of every detector
+template<Detector D> struct DetectorTraits;
+template<> struct DetectorTraits<DETECTOR_ORB>   { typedef HammingNorm Norm; };
+template<> struct DetectorTraits<DETECTOR_BRISK> { typedef HammingNorm Norm; };
+template<> struct DetectorTraits<DETECTOR_SIFT>  { typedef L2Norm Norm; };
+template<> struct DetectorTraits<DETECTOR_SURF>  { typedef L2Norm Norm; };
+
+/**
+ * k nearest train descriptors of a range of query descriptors, the distance kernel inlined from Norm.
+ * The best distances are kept sorted by insertion, equal distances in the order of the train descriptors
+ */
+template<typename Norm>
+class KnnMatchBody : public cv::ParallelLoopBody
+{
+public:
+    KnnMatchBody( const cv::Mat &query, const cv::Mat &train, int k, std::vector<std::vector<cv::DMatch> > &matches )
+        : query_(query), train_(train), k_(k), matches_(matches) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        typedef typename Norm::ValueType ValueType;
+        typedef typename Norm::DistanceType DistanceType;
+        const int length = query_.cols;
+        std::vector<DistanceType> best(k_);
+        std::vector<int> best_index(k_);
+        for( int q = range.start; q < range.end; ++q )
+        {
+            const ValueType *descriptor = query_.ptr<ValueType>(q);
+            std::fill(best.begin(), best.end(), std::numeric_limits<DistanceType>::max());
+            std::fill(best_index.begin(), best_index.end(), -1);
+            for( int t = 0; t < train_.rows; ++t )
+            {
+                const DistanceType distance = Norm::distance(descriptor, train_.ptr<ValueType>(t), length);
+                if( distance >= best[k_ - 1] )
+                    continue;
+                int p = k_ - 1;
+                for( ; p > 0 && best[p - 1] > distance; --p )
+                {
+                    best[p] = best[p - 1];
+                    best_index[p] = best_index[p - 1];
+                }
+                best[p] = distance;
+                best_index[p] = t;
+            }
+
+            matches_[q].clear();
+            for( int i = 0; i < k_ && best_index[i] >= 0; ++i )
+                matches_[q].push_back(cv::DMatch(q, best_index[i], Norm::to_distance(best[i])));
+        }
+    }
+
+private:
+    const cv::Mat &query_;
+    const cv::Mat &train_;
+    int k_;
+    std::vector<std::vector<cv::DMatch> > &matches_;
+};
+
+/**
+ * @function knn_match_descriptors
+ * brief brute force matching: the k nearest train descriptors of every query descriptor, closest first, parallel over
+ * the queries. Gives the matches of cv::BFMatcher::knnMatch with the norm of Norm
+ */
+template<typename Norm>
+void knn_match_descriptors( const cv::Mat &query, const cv::Mat &train, std::vector<std::vector<cv::DMatch> > &matches, int k )
+{
+    matches.clear();
+    if( query.empty() || train.empty() || k < 1 )
+        return;
+    CV_Assert( query.depth() == Norm::DEPTH && train.depth() == Norm::DEPTH && query.cols == train.cols );
+
+    matches.resize(query.rows);
+    cv::parallel_for_(cv::Range(0, query.rows), KnnMatchBody<Norm>(query, train, k, matches));
+}
+
+/// Binary descriptors go through the blocked SIMD matcher
+template<>
+inline void knn_match_descriptors<HammingNorm>( const cv::Mat &query, const cv::Mat &train, std::vector<std::vector<cv::DMatch> > &matches, int k )
+{
+    hamming_knn_match(query, train, matches, k);
+}
+
+/**
+ * @function match_descriptors
+ * brief the nearest train descriptor of every query descriptor (knn_match_descriptors with k = 1)
+ */
+template<typename Norm>
+void match_descriptors( const cv::Mat &query, const cv::Mat &train, std::vector<cv::DMatch> &matches )
+{
+    std::vector<std::vector<cv::DMatch> > knn_matches;
+    knn_match_descriptors<Norm>(query, train, knn_matches, 1);
+
+    matches.clear();
+    for( size_t q = 0; q < knn_matches.size(); ++q )
+        matches.push_back(knn_matches[q][0]);
+}
+
+/**
+ * Detection, description and matching of the keypoints of a template against a full image, for detector D.
+ * The distance of the descriptors is known at compile time, so that the matching loop has no dispatch at all.
+ * The train descriptors (the full image of run) can be set as the reference, indexed once for the approximate searches
+ * which are enabled: the queries keep the direction of brute force, so that the ratio test compares the same neighbours.
+ * Float descriptors are quantized, if enabled, with a quantizer learnt once on the template (train_quantizer): the
+ * descriptors described afterwards are kept in their compact form.
+ */
+template<Detector D, typename Norm = typename DetectorTraits<D>::Norm>
+class MatchingEngine
+{
+public:
+    explicit MatchingEngine( const TiledDetection &tiling = TiledDetection(), const FlannOptions &flann = FlannOptions(),
+                             const QuantizationOptions &quantization = QuantizationOptions(),
+                             const HashingOptions &hashing = HashingOptions() )
+        : detector_(create_detector(D)), tiling_(tiling), flann_(flann), quantization_(quantization), hashing_(hashing) {}
+
+    /// False if the detector is not available in this OpenCV build
+    bool available() const { return !detector_.empty(); }
+
+    /// Detects and describes the keypoints of image in one pass, tile by tile if tiling is enabled; returns their number.
+    /// The descriptors are quantized once the quantizer is trained
+    size_t describe( const cv::Mat &image, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors ) const
+    {
+        const size_t found = tiling_.enabled() ? static_cast<size_t>(std::max(0, detect_and_compute_tiled(D, image, tiling_, keypoints, descriptors)))
+                                               : detect_and_compute(detector_, image, keypoints, descriptors);
+        if( !quantizer_.empty() && descriptors.depth() == CV_32F )
+            quantizer_.quantize(descriptors, descriptors);
+        return found;
+    }
+
+    /// Learns the quantizer of float descriptors on these (the template), if enabled, and quantizes them in place:
+    /// describe() quantizes the next descriptors with it
+    void train_quantizer( cv::Mat &descriptors )
+    {
+        quantizer_ = DescriptorQuantizer();
+        if( Norm::DEPTH == CV_32F && quantization_.enabled && descriptors.depth() == CV_32F &&
+            quantizer_.train(descriptors, quantization_) )
+            quantizer_.quantize(descriptors, descriptors);
+    }
+
+    /// Sets the train descriptors of the next matches (shared, not copied), indexed for the approximate searches which
+    /// are enabled: multi-index hashing of binary descriptors, or the FLANN index (cached on disk if a path is given;
+    /// KD-trees only for quantized descriptors, LSH would hash their bytes as bits)
+    void set_reference( const cv::Mat &descriptors )
+    {
+        reference_ = descriptors;
+        hashing_index_ = MultiIndexHashing();
+        flann_index_ = FlannIndex();
+        if( descriptors.empty() )
+            return;
+
+        if( static_cast<int>(Norm::NORM_TYPE) == cv::NORM_HAMMING && hashing_.enabled && descriptors.cols % 2 == 0 )
+            hashing_index_.build(descriptors);
+        else if( flann_.enabled() && !quantizer_.empty() && flann_.algorithm == FlannOptions::LSH )
+            std::cout << "FLANN LSH does not apply to quantized " << detector_name(D) << " descriptors, matching by brute force." << std::endl;
+        else if( flann_.enabled() && !cached_flann_index(descriptors, flann_, flann_index_) )
+            std::cout << "FLANN LSH needs binary descriptors, matching by brute force." << std::endl;
+    }
+
+    /// Forgets the reference, its indexes and the quantizer
+    void clear_reference()
+    {
+        reference_.release();
+        quantizer_ = DescriptorQuantizer();
+        hashing_index_ = MultiIndexHashing();
+        flann_index_ = FlannIndex();
+    }
+
+    /// Nearest train descriptor of every query descriptor
+    void match( const cv::Mat &query, const cv::Mat &train, std::vector<cv::DMatch> &matches ) const
+    {
+        match_descriptors<Norm>(query, train, matches);
+    }
+
+    /// k nearest train descriptors of every query descriptor: exact, or approximate with the index of the reference if
+    /// train is the reference, with a FLANN index of train (not cached) otherwise. Descriptors of float detectors
+    /// which are already quantized (CV_8U) are matched as such, with the distances converted back by the quantizer of
+    /// the engine, left in quantized units if they were quantized elsewhere; float descriptors are quantized first if
+    /// enabled
+    void knn_match( const cv::Mat &query, const cv::Mat &train, std::vector<std::vector<cv::DMatch> > &matches, int k ) const
+    {
+        if( (!hashing_index_.empty() || !flann_index_.empty()) && is_reference(train) )
+        {
+            if( !hashing_index_.empty() )
+                hashing_index_.knn_match(query, matches, k, hashing_.max_radius);
+            else
+                flann_index_.knn_match(query, matches, k);
+            if( !quantizer_.empty() )
+                quantizer_.to_float_distances(matches);
+            return;
+        }
+        if( Norm::DEPTH == CV_32F && query.depth() == CV_8U )
+        {
+            knn_match_descriptors<L2ByteNorm>(query, train, matches, k);
+            if( !quantizer_.empty() )
+                quantizer_.to_float_distances(matches);
+            return;
+        }
+        if( Norm::DEPTH == CV_32F && quantization_.enabled )
+        {
+            /// Descriptors not described by this engine: its quantizer, or one learnt on train
+            DescriptorQuantizer learnt;
+            const DescriptorQuantizer *quantizer = &quantizer_;
+            if( quantizer_.empty() )
+            {
+                learnt.train(train, quantization_);
+                quantizer = &learnt;
+            }
+            cv::Mat compact_query, compact_train;
+            quantizer->quantize(query, compact_query);
+            quantizer->quantize(train, compact_train);
+            knn_match_descriptors<L2ByteNorm>(compact_query, compact_train, matches, k);
+            quantizer->to_float_distances(matches);
+            return;
+        }
+        if( flann_.enabled() )
+        {
+            FlannOptions uncached = flann_;
+            uncached.index_path.clear();
+            FlannIndex index;
+            if( index.build(train, uncached) )
+            {
+                index.knn_match(query, matches, k);
+                return;
+            }
+            std::cout << "FLANN LSH needs binary descriptors, matching by brute force." << std::endl;
+        }
+        knn_match_descriptors<Norm>(query, train, matches, k);
+    }
+
+    /// The whole pipeline of the feature demos: 2 nearest neighbours, ratio test and homography verification, the
+    /// quantizer trained on the template and the full image descriptors set as the reference (result keeps the
+    /// descriptors quantized if enabled).
+    /// Returns 0 on success (even if the homography is rejected), -1 if the detector is not available or no keypoints are found
+    int run( const cv::Mat &image_template, const cv::Mat &image_full, KeypointMatches &result,
+             const VerificationOptions &verification = VerificationOptions(), float ratio = 0.8f )
+    {
+        if( !available() )
+            return -1;
+
+        /// Detection and Extraction: the template first, its quantizer then quantizes the full image as it is described
+        clear_reference();
+        if( describe(image_template, result.template_keypoints, result.template_descriptors) == 0 )
+        {
+            std::cout << "No valid keypoints found for template image. Aborting." << std::endl;
+            return -1;
+        }
+        train_quantizer(result.template_descriptors);
+        if( describe(image_full, result.full_keypoints, result.full_descriptors) == 0 )
+        {
+            std::cout << "No valid keypoints found for full image. Aborting." << std::endl;
+            return -1;
+        }
+        set_reference(result.full_descriptors);
+
+        /// Matching and verification
+        Verification verified;
+        match_and_verify(result.template_keypoints, result.template_descriptors, result.full_keypoints, result.full_descriptors,
+                         result.matches, verified, verification, ratio);
+        result.homography = verified.homography;
+        result.good_matches.swap(verified.inliers);
+        return 0;
+    }
+
+    /// Matching and verification of keypoints already described: 2 nearest neighbours, ratio test (matches, best first)
+    /// and homography (verified). Returns the number of inliers, 0 if the homography is rejected
+    int match_and_verify( const std::vector<cv::KeyPoint> &template_keypoints, const cv::Mat &template_descriptors,
+                          const std::vector<cv::KeyPoint> &full_keypoints, const cv::Mat &full_descriptors,
+                          std::vector<cv::DMatch> &matches, Verification &verified,
+                          const VerificationOptions &verification = VerificationOptions(), float ratio = 0.8f ) const
+    {
+        std::vector<std::vector<cv::DMatch> > knn_matches;
+        knn_match(template_descriptors, full_descriptors, knn_matches, 2);
+        ratio_test(knn_matches, ratio, matches);
+        return estimate_homography(template_keypoints, full_keypoints, matches, verification, verified);
+    }
+
+private:
+    /// Same matrix as the reference (the same rows of the same data)
+    bool is_reference( const cv::Mat &descriptors ) const
+    {
+        return !reference_.empty() && descriptors.data == reference_.data && descriptors.rows == reference_.rows
+               && descriptors.cols == reference_.cols;
+    }
+
+    cv::Ptr<cv::Feature2D> detector_;
+    TiledDetection tiling_;
+    FlannOptions flann_;
+    QuantizationOptions quantization_;
+    HashingOptions hashing_;
+    cv::Mat reference_;
+    DescriptorQuantizer quantizer_;
+    MultiIndexHashing hashing_index_;
+    FlannIndex flann_index_;
+};
+
+} // namespace cvdemo
+
+#endif // CVDEMO_MATCHING_ENGINE_HPP
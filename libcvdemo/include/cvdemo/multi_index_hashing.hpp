@@ -0,0 +1,63 @@
+/**
+ * Multi-Index Hashing
+ * brief sublinear k nearest neighbour search of binary descriptors (ORB, BRISK) for large collections
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_MULTI_INDEX_HASHING_HPP
+#define CVDEMO_MULTI_INDEX_HASHING_HPP
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+namespace cvdemo
+{
+
+/// Multi-index hashing of the binary descriptors of the reference (the full image) instead of brute force matching
+struct HashingOptions
+{
+    HashingOptions() : enabled(false), max_radius(2) {}
+
+    bool enabled;
+    int max_radius;     /// bits searched around every substring of the queries, recall against latency
+};
+
+/**
+ * Multi-index hashing (Norouzi et al.): the descriptors are cut into 16 bit substrings, each indexing a hash table.
+ * Two descriptors at distance d share a substring within floor(d / substrings) bits, so the queries only compare the
+ * descriptors found in the buckets near their own substrings, radius by radius.
+ * The search is exact for the queries whose k-th neighbour is closer than substrings * (max_radius + 1),
+ * approximate beyond: max_radius trades recall for latency.
+ */
+class MultiIndexHashing
+{
+public:
+    MultiIndexHashing() : substrings_(0) {}
+
+    /// Indexes the train descriptors (CV_8U rows with an even number of bytes), which are shared, not copied
+    void build( const cv::Mat &train );
+
+    bool empty() const { return train_.empty(); }
+    int substrings() const { return substrings_; }
+
+    /**
+     * The k nearest train descriptors of every query descriptor found within max_radius bits on a substring, closest first,
+     * equal distances in the order of the train descriptors (as hamming_knn_match). Queries in parallel.
+     * candidates, if given, receives the average number of train descriptors compared per query
+     */
+    void knn_match( const cv::Mat &query, std::vector<std::vector<cv::DMatch> > &matches, int k, int max_radius = 2,
+                    double *candidates = 0 ) const;
+
+private:
+    cv::Mat train_;
+    int substrings_;
+    /// Buckets of all the tables, table after table: the ids of bucket b of table s are
+    /// ids_[s * rows + offsets_[s * (BUCKETS + 1) + b] .. s * rows + offsets_[s * (BUCKETS + 1) + b + 1]]
+    std::vector<int> offsets_;
+    std::vector<int> ids_;
+};
+
+} // namespace cvdemo
+
+#endif // CVDEMO_MULTI_INDEX_HASHING_HPP
@@ -0,0 +1,69 @@
+/**
+ * Object Detection
+ * brief Haar cascade face detection and template matching used by the object_detection demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_OBJECT_DETECTION_HPP
+#define CVDEMO_OBJECT_DETECTION_HPP
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+
+namespace cvdemo
+{
+
+/**
+ * @function detect_faces
+ * brief runs the cascade on the equalized grayscale frame
+ */
+void detect_faces( cv::CascadeClassifier &cascade, const cv::Mat &frame, std::vector<cv::Rect> &faces );
+
+/**
+ * @function draw_faces
+ * brief draws an ellipse around every face
+ */
+void draw_faces( cv::Mat &frame, const std::vector<cv::Rect> &faces );
+
+/**
+ * @function match_template
+ * brief computes the normalized result matrix of the method (cv::TM_*) and returns the location of the best match
+ */
+cv::Point match_template( const cv::Mat &image, const cv::Mat &templ, int method, cv::Mat &result );
+
+/// Coarse-to-fine template matching: exhaustive search on a downsampled level, local refinement on the finer ones
+struct PyramidMatching
+{
+    PyramidMatching() : levels(0), candidates(5), margin(2), min_template_size(16) {}
+
+    int levels;             /// pyramid levels below full resolution at most, 0 for as many as min_template_size allows
+    int candidates;         /// best locations of the coarsest level refined down to full resolution
+    int margin;             /// pixels searched around a refined candidate on every side, at the finer level
+    int min_template_size;  /// the template is never downsampled below this many pixels on its shorter side
+};
+
+/**
+ * @function pyramid_levels
+ * brief levels below full resolution used for the image and the template sizes
+ */
+int pyramid_levels( const cv::Size &image_size, const cv::Size &template_size, const PyramidMatching &options );
+
+/**
+ * @function match_template_pyramid
+ * brief location of the best match of the method (cv::TM_*), as match_template but coarse to fine: image and template
+ * are halved pyramid_levels times, matched exhaustively at the coarsest level only, and the best candidates (at least
+ * half a template apart) are refined level by level in windows of (2 * margin + 2)^2 locations, in parallel.
+ * result receives the normalized result matrix of the coarsest level. Without levels, match_template itself
+ */
+cv::Point match_template_pyramid( const cv::Mat &image, const cv::Mat &templ, int method, const PyramidMatching &options, cv::Mat &result );
+
+/**
+ * @function draw_match
+ * brief draws the rectangle of a match of the given size
+ */
+void draw_match( cv::Mat &image, const cv::Point &location, const cv::Size &size );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_OBJECT_DETECTION_HPP
@@ -0,0 +1,77 @@
+/**
+ * Thread Pool
+ * brief work-stealing thread pool used to run the tiled operations
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_THREAD_POOL_HPP
+#define CVDEMO_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cvdemo
+{
+
+/**
+ * Fixed set of worker threads, each one owning a task queue.
+ * A worker takes the newest task of its own queue and, once it is empty, steals the
+ * oldest task of the other queues, so that uneven tasks (e.g. tiles at the image border)
+ * do not leave threads idle while others still have a backlog.
+ */
+class ThreadPool
+{
+public:
+    /// 0 threads uses std::thread::hardware_concurrency()
+    explicit ThreadPool( unsigned int num_threads = 0 );
+    ~ThreadPool();
+
+    size_t size() const { return workers_.size(); }
+
+    /// Queues a task, tasks are distributed round robin over the worker queues
+    void submit( const std::function<void()> &task );
+    /// Blocks until every submitted task has been run; rethrows the first exception thrown by a task.
+    /// A task of the pool cannot wait for the pool (its own task would never finish): throws std::logic_error
+    void wait();
+    /// Runs body(0) ... body(count - 1) on the pool and waits for them. Called from a task of the pool, the bodies
+    /// run inline on the calling worker instead, so that nested layers given the same pool do not deadlock
+    void parallel_for( int count, const std::function<void(int)> &body );
+    /// True on the worker threads of this pool
+    bool in_worker() const;
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    void work( size_t index );
+    bool pop_task( size_t index, std::function<void()> &task );
+
+    ThreadPool( const ThreadPool& );
+    ThreadPool& operator=( const ThreadPool& );
+
+    std::vector<std::unique_ptr<TaskQueue> > queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex state_mutex_;
+    std::condition_variable task_available_;
+    std::condition_variable all_done_;
+    size_t queued_;         /// tasks waiting in the queues
+    size_t unfinished_;     /// tasks queued or running
+    bool stop_;
+    std::exception_ptr error_;
+    std::atomic<size_t> next_queue_;
+};
+
+} // namespace cvdemo
+
+#endif // CVDEMO_THREAD_POOL_HPP
@@ -0,0 +1,55 @@
+/**
+ * Tiled File
+ * brief images on disk read and written a tile at a time, for images which do not fit in memory
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_TILED_FILE_HPP
+#define CVDEMO_TILED_FILE_HPP
+
+#include <fstream>
+#include <string>
+#include <opencv2/core/core.hpp>
+
+namespace cvdemo
+{
+
+/**
+ * Uncompressed image file accessed by rectangles: only the rows of the requested tile are read or written.
+ * Binary PGM (P5, CV_8UC1) and PPM (P6, CV_8UC3, converted from/to BGR) with 8 bit samples,
+ * or raw headerless data of any type (e.g. CV_32SC1 labels).
+ */
+class TiledImageFile
+{
+public:
+    TiledImageFile() : type_(-1), data_offset_(0), rgb_(false) {}
+
+    /// Opens an existing PGM/PPM file for reading
+    bool open( const std::string &path );
+    /// Opens an existing raw file of the given size and type for reading, false if its length does not match them
+    bool open_raw( const std::string &path, const cv::Size &size, int type );
+    /// Creates a file for reading and writing: PGM/PPM for CV_8UC1/CV_8UC3, raw otherwise
+    bool create( const std::string &path, const cv::Size &size, int type );
+
+    bool is_open() const { return file_.is_open(); }
+    const cv::Size& size() const { return size_; }
+    int type() const { return type_; }
+
+    /// Reads the rectangle, clipped to the image, into tile
+    bool read( const cv::Rect &rect, cv::Mat &tile );
+    /// Writes tile with its top-left corner at the given position
+    bool write( const cv::Point &corner, const cv::Mat &tile );
+
+private:
+    std::streamoff offset( int x, int y ) const;
+
+    std::fstream file_;
+    cv::Size size_;
+    int type_;
+    std::streamoff data_offset_;
+    bool rgb_;
+};
+
+} // namespace cvdemo
+
+#endif // CVDEMO_TILED_FILE_HPP
@@ -0,0 +1,37 @@
+/**
+ * Tiling
+ * brief runs a neighbourhood filter on halo-padded tiles of an image in parallel
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_TILING_HPP
+#define CVDEMO_TILING_HPP
+
+#include <functional>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "cvdemo/thread_pool.hpp"
+
+namespace cvdemo
+{
+
+/// Filter applied to a single tile: reads the padded tile, writes a result of the same size
+typedef std::function<void(const cv::Mat &src, cv::Mat &dst)> TileFilter;
+
+/**
+ * @function split_tiles
+ * brief splits an image of the given size in tiles of at most tile_size x tile_size pixels
+ */
+std::vector<cv::Rect> split_tiles( const cv::Size &size, int tile_size );
+
+/**
+ * @function tiled_filter
+ * brief applies the filter tile by tile on the pool. Every tile is grown by halo pixels
+ * (clamped to the image), filtered, and only its inner part is copied to dst: as long as the
+ * halo covers the radius of the filter, the result is the same of the filter applied on the whole image.
+ */
+void tiled_filter( const cv::Mat &src, cv::Mat &dst, int halo, int tile_size, ThreadPool &pool, const TileFilter &filter );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_TILING_HPP
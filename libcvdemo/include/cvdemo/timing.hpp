@@ -0,0 +1,36 @@
+/**
+ * Timing
+ * brief timing helpers of the benchmark modes
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_TIMING_HPP
+#define CVDEMO_TIMING_HPP
+
+#include <opencv2/core/core.hpp>
+
+namespace cvdemo
+{
+
+/**
+ * @function best_time_ms
+ * brief best of repeat runs, in milliseconds
+ */
+template<typename Function>
+double best_time_ms( int repeat, Function function )
+{
+    double best = 0.0;
+    for( int r = 0; r < repeat; ++r )
+    {
+        int64 start = cv::getTickCount();
+        function();
+        double elapsed = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+        if( r == 0 || elapsed < best )
+            best = elapsed;
+    }
+    return best;
+}
+
+} // namespace cvdemo
+
+#endif // CVDEMO_TIMING_HPP
@@ -0,0 +1,65 @@
+/**
+ * Union Find
+ * brief disjoint sets of integer labels, used to merge labels across tile and strip seams
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_UNION_FIND_HPP
+#define CVDEMO_UNION_FIND_HPP
+
+#include <algorithm>
+#include <vector>
+
+namespace cvdemo
+{
+
+/**
+ * Disjoint sets over the ids 0 ... size-1, with path halving. The root of a set is always its smallest id,
+ * so that merged labels keep the order in which they have been created.
+ */
+class UnionFind
+{
+public:
+    explicit UnionFind( size_t size = 0 ) { resize(size); }
+
+    size_t size() const { return parent_.size(); }
+
+    /// Adds the ids size() ... size-1 as single sets
+    void resize( size_t size )
+    {
+        size_t old_size = parent_.size();
+        parent_.resize(size);
+        for(size_t id = old_size; id < size; ++id)
+            parent_[id] = static_cast<int>(id);
+    }
+
+    int find( int id )
+    {
+        while(parent_[id] != id)
+        {
+            parent_[id] = parent_[parent_[id]];
+            id = parent_[id];
+        }
+        return id;
+    }
+
+    /// Joins the sets of a and b, returns the root of the union
+    int unite( int a, int b )
+    {
+        a = find(a);
+        b = find(b);
+        if(a == b)
+            return a;
+        if(b < a)
+            std::swap(a, b);
+        parent_[b] = a;
+        return a;
+    }
+
+private:
+    std::vector<int> parent_;
+};
+
+} // namespace cvdemo
+
+#endif // CVDEMO_UNION_FIND_HPP
@@ -0,0 +1,131 @@
+/**
+ * Video
+ * brief pipelined processing of video files and cameras: decode, process and output stages on separate threads
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#ifndef CVDEMO_VIDEO_HPP
+#define CVDEMO_VIDEO_HPP
+
+#include <functional>
+#include <string>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include "cvdemo/display.hpp"
+
+namespace cvdemo
+{
+
+/// Options of the stream mode: --video <file|device> [--record <file>] [--headless]
+struct StreamOptions
+{
+    StreamOptions() : enabled(false), headless(false) {}
+
+    bool enabled;
+    std::string source;         /// video file, URL or camera index (e.g. 0 for /dev/video0)
+    std::string record_file;    /// if given, the results are encoded in this file (MJPG)
+    bool headless;              /// no window, e.g. to only record
+};
+
+/// Timing of a pipeline stage over all the frames
+struct StageTiming
+{
+    StageTiming() : frames(0), total_ms(0.0), max_ms(0.0) {}
+
+    void add( double ms );
+    double average_ms() const { return frames > 0 ? total_ms / frames : 0.0; }
+
+    size_t frames;
+    double total_ms;
+    double max_ms;
+};
+
+/// Statistics of a pipeline run
+struct PipelineStatistics
+{
+    PipelineStatistics() : frames(0), seconds(0.0), dropped(0), backpressure(0) {}
+
+    /// Sustained throughput: frames through the whole pipeline per wall clock second
+    double fps() const { return seconds > 0.0 ? frames / seconds : 0.0; }
+
+    StageTiming decode;
+    StageTiming process;
+    StageTiming output;
+    StageTiming latency;    /// from the start of the decoding to the end of the output of a frame
+    size_t frames;
+    double seconds;
+    size_t dropped;         /// frames of a live source skipped because the ring was full
+    size_t backpressure;    /// times the decoder had to wait for a free slot
+};
+
+/**
+ * @function is_camera
+ * brief true if the source is a camera index
+ */
+bool is_camera( const std::string &source );
+
+/**
+ * @function open_capture
+ * brief opens a camera if the source is a number, a video file/URL otherwise
+ */
+bool open_capture( const std::string &source, cv::VideoCapture &capture );
+
+/**
+ * @function print_statistics
+ * brief prints frames, sustained fps and the average/max latency of every stage
+ */
+void print_statistics( const PipelineStatistics &statistics );
+
+/**
+ * Three stage pipeline: a thread decodes the frames, a thread processes them and the calling thread
+ * outputs them (HighGUI windows have to be used from the main thread). The stages hand over the slots
+ * of a lock-free FrameRing, whose images and results are reused from frame to frame. When the ring is full,
+ * a slow stage slows down the decoder (backpressure), or the frames are dropped with drop_when_full (cameras).
+ */
+class VideoPipeline
+{
+public:
+    /// Computes the result of a frame
+    typedef std::function<void(const cv::Mat &frame, cv::Mat &result)> Process;
+    /// Shows/stores a result, returns false to stop the stream
+    typedef std::function<bool(const cv::Mat &result)> Output;
+
+    explicit VideoPipeline( size_t ring_size = 4, bool drop_when_full = false );
+
+    /// Runs until the end of the stream or until output returns false
+    PipelineStatistics run( cv::VideoCapture &capture, const Process &process, const Output &output );
+
+private:
+    size_t ring_size_;
+    bool drop_when_full_;
+};
+
+/**
+ * Output stage of the stream mode: shows the results in the window of the display
+ * and/or encodes them in the record file, opened at the first frame.
+ */
+class StreamOutput
+{
+public:
+    StreamOutput( const StreamOptions &options, const Display &display, double fps );
+
+    /// False if a key has been pressed or the result cannot be encoded
+    bool operator()( const cv::Mat &result );
+
+private:
+    StreamOptions options_;
+    const Display &display_;
+    double fps_;
+    cv::VideoWriter writer_;
+};
+
+/**
+ * @function run_stream
+ * brief opens the source of the options, runs the pipeline with the process stage and a StreamOutput
+ * and prints the statistics. Returns 0 on success, -1 if the source cannot be opened.
+ */
+int run_stream( const StreamOptions &options, const Display &display, const VideoPipeline::Process &process );
+
+} // namespace cvdemo
+
+#endif // CVDEMO_VIDEO_HPP
@@ -0,0 +1,278 @@
+/**
+ * Basic Operations
+ * brief thresholding, morphology, color conversions and smoothing filters used by the basic_operations demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/basic_operations.hpp"
+#include "cvdemo/buffer_cache.hpp"
+#include "cvdemo/tiling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc/imgproc.hpp>
+
+/// Defines depending of OpenCV version installed (2.4.x or 3.x)
+#ifdef OPENCV_OLD	/// 2.4.x version
+const int GRAY_CONV = CV_BGR2GRAY;
+const int HSV_CONV  = CV_BGR2HSV;
+const int HLS_CONV  = CV_BGR2HLS;
+const int LAB_CONV  = CV_BGR2Lab;
+const int YUV_CONV  = CV_BGR2YUV;
+#else				/// 3.x - github version
+const int GRAY_CONV = cv::COLOR_BGR2GRAY;
+const int HSV_CONV  = cv::COLOR_BGR2HSV;
+const int HLS_CONV  = cv::COLOR_BGR2HLS;
+const int LAB_CONV  = cv::COLOR_BGR2Lab;
+const int YUV_CONV  = cv::COLOR_BGR2YUV;
+#endif
+
+namespace cvdemo
+{
+
+/**
+ * @function threshold
+ */
+void threshold( const cv::Mat &src_gray, cv::Mat &dst, double value, int type, double max_value )
+{
+    cv::threshold( src_gray, dst, value, max_value, type );
+}
+
+/**
+ * @function convert_color
+ */
+void convert_color( const cv::Mat &src, cv::Mat &dst, ColorSpace space )
+{
+    switch(space)
+    {
+        case COLOR_GRAY: cv::cvtColor(src, dst, GRAY_CONV); break;
+        case COLOR_HSV:  cv::cvtColor(src, dst, HSV_CONV);  break;
+        case COLOR_HLS:  cv::cvtColor(src, dst, HLS_CONV);  break;
+        case COLOR_LAB:  cv::cvtColor(src, dst, LAB_CONV);  break;
+        case COLOR_YUV:  cv::cvtColor(src, dst, YUV_CONV);  break;
+    }
+}
+
+/**
+ * @function to_gray
+ */
+void to_gray( const cv::Mat &src, cv::Mat &gray )
+{
+    if(src.channels() > 1)
+        cv::cvtColor(src, gray, GRAY_CONV);
+    else
+        gray = src;
+}
+
+/**
+ * @function structuring_element
+ */
+cv::Mat structuring_element( ElementShape shape, int size )
+{
+    int morph_type = cv::MORPH_RECT;
+    switch(shape)
+    {
+        case ELEMENT_RECT:    morph_type = cv::MORPH_RECT;    break;
+        case ELEMENT_CROSS:   morph_type = cv::MORPH_CROSS;   break;
+        case ELEMENT_ELLIPSE: morph_type = cv::MORPH_ELLIPSE; break;
+    }
+
+    return cv::getStructuringElement( morph_type,
+                cv::Size( 2*size + 1, 2*size+1 ),
+                cv::Point( size, size ) );
+}
+
+/**
+ * @function erode
+ */
+void erode( const cv::Mat &src, cv::Mat &dst, ElementShape shape, int size )
+{
+    cv::erode( src, dst, structuring_element(shape, size) );
+}
+
+/**
+ * @function erode
+ */
+void erode( const cv::Mat &src, cv::Mat &dst, ElementShape shape, int size, BufferCache &cache )
+{
+    cv::erode( src, dst, cache.structuring_element(shape, size) );
+}
+
+/**
+ * @function dilate
+ */
+void dilate( const cv::Mat &src, cv::Mat &dst, ElementShape shape, int size )
+{
+    cv::dilate( src, dst, structuring_element(shape, size) );
+}
+
+/**
+ * @function dilate
+ */
+void dilate( const cv::Mat &src, cv::Mat &dst, ElementShape shape, int size, BufferCache &cache )
+{
+    cv::dilate( src, dst, cache.structuring_element(shape, size) );
+}
+
+/**
+ * @function smooth
+ */
+void smooth( const cv::Mat &src, cv::Mat &dst, SmoothingFilter filter, int kernel_size )
+{
+    switch(filter)
+    {
+        case HOMOGENEOUS_BLUR:
+            cv::blur( src, dst, cv::Size( kernel_size, kernel_size ) );
+            break;
+        case GAUSSIAN_BLUR:
+            cv::GaussianBlur( src, dst, cv::Size( kernel_size, kernel_size ), 0, 0 );
+            break;
+        case MEDIAN_BLUR:
+            cv::medianBlur( src, dst, kernel_size );
+            break;
+        case BILATERAL_BLUR:
+            cv::bilateralFilter( src, dst, kernel_size, kernel_size*2, kernel_size/2 );
+            break;
+        case CONSTANT_TIME_MEDIAN_BLUR:
+            median_filter( src, dst, kernel_size );
+            break;
+        case BILATERAL_GRID_BLUR:
+            if( bilateral_grid_size( src.size(), kernel_size/2, kernel_size*2 ) <= src.total() )
+                bilateral_grid( src, dst, kernel_size/2, kernel_size*2 );
+            else
+                cv::bilateralFilter( src, dst, kernel_size, kernel_size*2, kernel_size/2 );
+            break;
+    }
+}
+
+/**
+ * @function smoothing_radius
+ */
+int smoothing_radius( SmoothingFilter filter, int kernel_size )
+{
+    /// The bilateral grid reaches 4 cells around a pixel: splatting, the 5 taps blur and the interpolation
+    if( filter == BILATERAL_GRID_BLUR )
+        return 4 * std::max( 1, kernel_size/2 );
+
+    /// All the other filters use a centered kernel_size window: box, Gaussian (sigma derived from the size),
+    /// median and bilateral (kernel_size is the diameter)
+    return kernel_size / 2;
+}
+
+/**
+ * @function smooth_tiled
+ */
+void smooth_tiled( const cv::Mat &src, cv::Mat &dst, SmoothingFilter filter, int kernel_size, ThreadPool &pool, int tile_size )
+{
+    /// A grid per tile would be anchored at the tile origin (seams at the tile borders) and could fall back to the
+    /// exact filter on the small tiles: the grid is built once for the whole image
+    if( filter == BILATERAL_GRID_BLUR )
+    {
+        smooth( src, dst, filter, kernel_size );
+        return;
+    }
+
+    tiled_filter( src, dst, smoothing_radius(filter, kernel_size), tile_size, pool,
+        [filter, kernel_size](const cv::Mat &tile_src, cv::Mat &tile_dst)
+        {
+            smooth( tile_src, tile_dst, filter, kernel_size );
+        });
+}
+
+/**
+ * @function gaussian_sigma
+ */
+double gaussian_sigma( int kernel_size )
+{
+    if( kernel_size <= 1 )
+        return 0.0;
+    /// Standard deviation of the kernel cv::GaussianBlur uses for sigma <= 0: binomial tables up to 7 taps
+    /// ([1 4 6 4 1]/16 has sigma 1), then the Gaussian of the size formula truncated to kernel_size taps
+    const cv::Mat kernel = cv::getGaussianKernel( kernel_size, 0, CV_64F );
+    const double center = (kernel_size - 1) * 0.5;
+    double variance = 0.0;
+    for( int i = 0; i < kernel_size; ++i )
+        variance += kernel.at<double>(i) * (i - center) * (i - center);
+    return std::sqrt( variance );
+}
+
+/**
+ * @function gaussian_scale_space
+ */
+void gaussian_scale_space( const cv::Mat &src, const std::vector<int> &kernel_sizes, ScaleSpace &space )
+{
+    space.kernel_sizes = kernel_sizes;
+    space.sigmas.clear();
+    space.levels.clear();
+
+    /// Float levels, so that the rounding error does not accumulate along the stack
+    cv::Mat source, current;
+    src.convertTo( source, CV_32F );
+    current = source.clone();
+    double current_sigma = 0.0;
+
+    for( size_t i = 0; i < kernel_sizes.size(); ++i )
+    {
+        double sigma = gaussian_sigma( kernel_sizes[i] );
+        if( sigma < current_sigma )
+        {
+            /// Not ascending: it cannot be derived from the previous level, restart from the source
+            current = source.clone();
+            current_sigma = 0.0;
+        }
+
+        if( sigma > current_sigma )
+        {
+            double increment = std::sqrt( sigma*sigma - current_sigma*current_sigma );
+            /// The kernel size is derived from the (small) incremental sigma
+            cv::GaussianBlur( current, current, cv::Size(0, 0), increment, increment );
+            current_sigma = sigma;
+        }
+
+        space.sigmas.push_back( sigma );
+        space.levels.push_back( current.clone() );
+    }
+}
+
+/**
+ * @function write_scale_space
+ */
+bool write_scale_space( const std::string &file_name, const ScaleSpace &space )
+{
+    cv::FileStorage fs( file_name, cv::FileStorage::WRITE );
+    if( !fs.isOpened() )
+        return false;
+
+    fs << "kernel_sizes" << space.kernel_sizes;
+    fs << "sigmas" << space.sigmas;
+    fs << "levels" << "[";
+    for( size_t i = 0; i < space.levels.size(); ++i )
+        fs << space.levels[i];
+    fs << "]";
+    return true;
+}
+
+/**
+ * @function read_scale_space
+ */
+bool read_scale_space( const std::string &file_name, ScaleSpace &space )
+{
+    cv::FileStorage fs( file_name, cv::FileStorage::READ );
+    if( !fs.isOpened() )
+        return false;
+
+    fs["kernel_sizes"] >> space.kernel_sizes;
+    fs["sigmas"] >> space.sigmas;
+
+    space.levels.clear();
+    cv::FileNode levels = fs["levels"];
+    for( cv::FileNodeIterator it = levels.begin(); it != levels.end(); ++it )
+    {
+        cv::Mat level;
+        *it >> level;
+        space.levels.push_back( level );
+    }
+    return space.levels.size() == space.sigmas.size();
+}
+
+} // namespace cvdemo
@@ -0,0 +1,141 @@
+/**
+ * Batch
+ * brief helpers to run the demos headless over a directory or a glob of images
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/batch.hpp"
+#include "cvdemo/cli.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <sstream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+namespace cvdemo
+{
+
+/**
+ * @function list_images
+ */
+std::vector<std::string> list_images( const std::string &dir_or_glob )
+{
+    /// cv::glob lists the whole content if a directory is given
+    std::vector<cv::String> candidates;
+    cv::glob(dir_or_glob, candidates, false);
+
+    std::vector<std::string> images;
+    for(size_t i = 0; i < candidates.size(); ++i)
+        if(has_image_extension(candidates[i]))
+            images.push_back(candidates[i]);
+
+    std::sort(images.begin(), images.end());
+    return images;
+}
+
+/**
+ * @function make_directory
+ */
+bool make_directory( const std::string &path )
+{
+    struct stat info;
+    if(stat(path.c_str(), &info) == 0)
+        return (info.st_mode & S_IFDIR) != 0;
+
+    #ifdef _WIN32
+    int result = _mkdir(path.c_str());
+    #else
+    int result = mkdir(path.c_str(), 0755);
+    #endif
+    return result == 0 || errno == EEXIST;
+}
+
+/**
+ * @function to_writable
+ */
+cv::Mat to_writable( const cv::Mat &image )
+{
+    if(image.depth() == CV_8U)
+        return image;
+
+    cv::Mat writable;
+    cv::normalize(image, writable, 0, 255, cv::NORM_MINMAX, CV_8U);
+    return writable;
+}
+
+/**
+ * @function BatchWriter
+ */
+BatchWriter::BatchWriter( const std::string &output_dir )
+    : output_dir_(output_dir), stage_index_(0), written_(0)
+{
+}
+
+/**
+ * @function BatchWriter::begin
+ */
+void BatchWriter::begin( const std::string &image_file )
+{
+    std::string::size_type slash = image_file.find_last_of("/\\");
+    image_name_ = (slash == std::string::npos) ? image_file : image_file.substr(slash + 1);
+    image_name_ = image_name_.substr(0, image_name_.find_last_of('.'));
+    stage_ = "result";
+    stage_index_ = 0;
+}
+
+/**
+ * @function BatchWriter::stage
+ */
+void BatchWriter::stage( const std::string &name )
+{
+    /// Turns the caption into a file name friendly suffix: "Gaussian Blur" -> "gaussian_blur"
+    stage_.clear();
+    for(size_t i = 0; i < name.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(name[i]);
+        if(std::isalnum(c))
+            stage_ += static_cast<char>(std::tolower(c));
+        else if(!stage_.empty() && stage_[stage_.size() - 1] != '_')
+            stage_ += '_';
+    }
+    while(!stage_.empty() && stage_[stage_.size() - 1] == '_')
+        stage_.erase(stage_.size() - 1);
+    if(stage_.empty())
+        stage_ = "result";
+    stage_index_ = 0;
+}
+
+/**
+ * @function BatchWriter::path
+ */
+std::string BatchWriter::path( const std::string &extension )
+{
+    std::ostringstream file_name;
+    file_name << output_dir_ << "/" << image_name_ << "_" << stage_;
+    if(stage_index_ > 0)
+        file_name << "_" << stage_index_;
+    file_name << extension;
+    ++stage_index_;
+    return file_name.str();
+}
+
+/**
+ * @function BatchWriter::write
+ */
+bool BatchWriter::write( const cv::Mat &image )
+{
+    std::string file_name = path(".png");
+    if(!cv::imwrite(file_name, to_writable(image)))
+    {
+        std::cout << "Cannot write " << file_name << std::endl;
+        return false;
+    }
+    ++written_;
+    return true;
+}
+
+} // namespace cvdemo
@@ -0,0 +1,303 @@
+/**
+ * Batch Matching
+ * brief matching of a set of templates against a set of images, every image described once and the
+ * template x image jobs scheduled on a thread pool
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/batch_matching.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <opencv2/highgui/highgui.hpp>
+#include "cvdemo/matching_engine.hpp"
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Keypoints and descriptors of a template or an image
+struct Described
+{
+    Described() : valid(false) {}
+
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+    bool valid;             /// false if the file cannot be read
+};
+
+double elapsed_ms( int64 start )
+{
+    return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+/**
+ * @function describe_files
+ * brief describes files[first, first + count) in parallel on the pool, the descriptors quantized if a trained quantizer
+ * is given. Feature2D instances are not shared between threads: every file gets its own engine, hence its own detector
+ */
+template<Detector D>
+void describe_files( const std::vector<std::string> &files, size_t first, size_t count, const TiledDetection &tiling,
+                     const DescriptorQuantizer &quantizer, ThreadPool &pool, std::vector<Described> &described )
+{
+    described.assign(count, Described());
+    pool.parallel_for(static_cast<int>(count), [&](int i)
+    {
+        const MatchingEngine<D> engine(tiling);
+        const cv::Mat image = cv::imread(files[first + i], 1);
+        described[i].valid = image.data != 0;
+        if( described[i].valid )
+            engine.describe(image, described[i].keypoints, described[i].descriptors);
+        if( !quantizer.empty() )
+            quantizer.quantize(described[i].descriptors, described[i].descriptors);
+    });
+}
+
+/**
+ * @function quantize_templates
+ * brief learns the quantizer on the descriptors of all the templates and quantizes them; nothing if the descriptors
+ * are not float ones
+ */
+void quantize_templates( const QuantizationOptions &options, std::vector<Described> &templates, DescriptorQuantizer &quantizer )
+{
+    std::vector<cv::Mat> descriptors;
+    for( size_t t = 0; t < templates.size(); ++t )
+        if( !templates[t].descriptors.empty() )
+            descriptors.push_back(templates[t].descriptors);
+    if( descriptors.empty() || descriptors[0].type() != CV_32FC1 )
+        return;
+
+    cv::Mat all_descriptors;
+    cv::vconcat(descriptors, all_descriptors);
+    if( !quantizer.train(all_descriptors, options) )
+        return;
+    for( size_t t = 0; t < templates.size(); ++t )
+        quantizer.quantize(templates[t].descriptors, templates[t].descriptors);
+}
+
+/**
+ * @function matchable
+ * brief true if the file has been read and has keypoints; adds it to the skipped files otherwise
+ */
+bool matchable( const std::string &file, const Described &described, BatchMatchingStats &stats )
+{
+    if( described.valid && !described.descriptors.empty() )
+        return true;
+    stats.skipped.push_back(SkippedFile(file, !described.valid));
+    return false;
+}
+
+/**
+ * @function match_batch_with
+ * brief match_batch with the MatchingEngine of detector D
+ */
+template<Detector D>
+int match_batch_with( const std::vector<std::string> &template_files, const std::vector<std::string> &image_files,
+                      const BatchMatchingOptions &options, ThreadPool &pool, std::vector<TemplateMatch> &results,
+                      BatchMatchingStats &stats )
+{
+    /// Matching only: the engine is shared by the jobs, its detector is not used
+    const MatchingEngine<D> engine(options.tiling);
+    if( !engine.available() )
+        return -1;
+    const int64 start = cv::getTickCount();
+
+    /// The templates are described once and kept for all the images
+    std::vector<Described> templates;
+    DescriptorQuantizer quantizer;
+    int64 phase = cv::getTickCount();
+    describe_files<D>(template_files, 0, template_files.size(), options.tiling, quantizer, pool, templates);
+    if( options.quantization.enabled )
+        quantize_templates(options.quantization, templates, quantizer);
+    stats.describe_ms += elapsed_ms(phase);
+    stats.descriptions += static_cast<int>(template_files.size());
+
+    std::vector<int> template_indices;
+    for( size_t t = 0; t < templates.size(); ++t )
+        if( matchable(template_files[t], templates[t], stats) )
+        {
+            template_indices.push_back(static_cast<int>(t));
+            stats.template_bytes += templates[t].descriptors.total() * templates[t].descriptors.elemSize();
+        }
+    if( template_indices.empty() )
+        return -1;
+
+    /// The images chunk by chunk: a chunk is described, then all its jobs are run
+    const size_t chunk_size = options.chunk_size > 0 ? static_cast<size_t>(options.chunk_size) : std::max<size_t>(1, 2 * pool.size());
+    std::vector<Described> images;
+    for( size_t first = 0; first < image_files.size(); first += chunk_size )
+    {
+        const size_t count = std::min(chunk_size, image_files.size() - first);
+        phase = cv::getTickCount();
+        describe_files<D>(image_files, first, count, options.tiling, quantizer, pool, images);
+        stats.describe_ms += elapsed_ms(phase);
+        stats.descriptions += static_cast<int>(count);
+
+        std::vector<int> image_indices;
+        for( size_t i = 0; i < count; ++i )
+            if( matchable(image_files[first + i], images[i], stats) )
+                image_indices.push_back(static_cast<int>(i));
+
+        const size_t offset = results.size(), num_templates = template_indices.size();
+        results.resize(offset + image_indices.size() * num_templates);
+        phase = cv::getTickCount();
+        pool.parallel_for(static_cast<int>(image_indices.size() * num_templates), [&](int job)
+        {
+            const Described &image = images[image_indices[job / num_templates]];
+            const Described &image_template = templates[template_indices[job % num_templates]];
+            TemplateMatch &result = results[offset + job];
+            result.template_index = template_indices[job % num_templates];
+            result.image_index = static_cast<int>(first) + image_indices[job / num_templates];
+
+            const int64 job_start = cv::getTickCount();
+            std::vector<cv::DMatch> matches;
+            Verification verified;
+            result.inliers = engine.match_and_verify(image_template.keypoints, image_template.descriptors, image.keypoints,
+                                                     image.descriptors, matches, verified, options.verification, options.ratio);
+            result.matches = static_cast<int>(matches.size());
+            result.homography = verified.homography;
+            result.ms = elapsed_ms(job_start);
+        });
+        stats.match_ms += elapsed_ms(phase);
+    }
+
+    stats.jobs = results.size();
+    stats.total_ms = elapsed_ms(start);
+    return 0;
+}
+
+/**
+ * @function csv_field
+ * brief the value quoted if it contains a separator, a quote or a line break
+ */
+std::string csv_field( const std::string &value )
+{
+    if( value.find_first_of(",\"\r\n") == std::string::npos )
+        return value;
+    std::string quoted = "\"";
+    for( size_t i = 0; i < value.size(); ++i )
+    {
+        if( value[i] == '"' )
+            quoted += '"';
+        quoted += value[i];
+    }
+    return quoted + "\"";
+}
+
+/**
+ * @function json_string
+ * brief the value as a JSON string literal
+ */
+std::string json_string( const std::string &value )
+{
+    std::string quoted = "\"";
+    for( size_t i = 0; i < value.size(); ++i )
+    {
+        const unsigned char c = static_cast<unsigned char>(value[i]);
+        if( c == '"' || c == '\\' )
+            quoted += '\\';
+        if( c < 0x20 )
+        {
+            static const char hex[] = "0123456789abcdef";
+            quoted += "\\u00";
+            quoted += hex[c >> 4];
+            quoted += hex[c & 0xf];
+        }
+        else
+            quoted += value[i];
+    }
+    return quoted + "\"";
+}
+
+} // namespace
+
+/**
+ * @function match_batch
+ */
+int match_batch( const std::vector<std::string> &template_files, const std::vector<std::string> &image_files,
+                 const BatchMatchingOptions &options, ThreadPool &pool, std::vector<TemplateMatch> &results,
+                 BatchMatchingStats *stats )
+{
+    results.clear();
+    BatchMatchingStats totals;
+    int status = -1;
+    const int opencv_threads = cv::getNumThreads();
+    cv::setNumThreads(1);
+    switch(options.detector)
+    {
+        case DETECTOR_ORB:   status = match_batch_with<DETECTOR_ORB>(template_files, image_files, options, pool, results, totals); break;
+        case DETECTOR_BRISK: status = match_batch_with<DETECTOR_BRISK>(template_files, image_files, options, pool, results, totals); break;
+        case DETECTOR_SIFT:  status = match_batch_with<DETECTOR_SIFT>(template_files, image_files, options, pool, results, totals); break;
+        case DETECTOR_SURF:  status = match_batch_with<DETECTOR_SURF>(template_files, image_files, options, pool, results, totals); break;
+    }
+    cv::setNumThreads(opencv_threads);
+    if( stats )
+        *stats = totals;
+    return status;
+}
+
+/**
+ * @function write_matches_csv
+ */
+bool write_matches_csv( const std::string &path, const std::vector<std::string> &template_files,
+                        const std::vector<std::string> &image_files, const std::vector<TemplateMatch> &results )
+{
+    std::ofstream file(path.c_str());
+    if( !file )
+        return false;
+
+    file << "template,image,matches,inliers,found,ms,h00,h01,h02,h10,h11,h12,h20,h21,h22" << std::endl;
+    file << std::setprecision(10);
+    for( size_t i = 0; i < results.size(); ++i )
+    {
+        const TemplateMatch &result = results[i];
+        file << csv_field(template_files[result.template_index]) << "," << csv_field(image_files[result.image_index]) << ","
+             << result.matches << "," << result.inliers << "," << (result.found() ? 1 : 0) << "," << result.ms;
+        for( int h = 0; h < 9; ++h )
+        {
+            file << ",";
+            if( result.found() )
+                file << result.homography.ptr<double>()[h];
+        }
+        file << std::endl;
+    }
+    return static_cast<bool>(file);
+}
+
+/**
+ * @function write_matches_json
+ */
+bool write_matches_json( const std::string &path, const std::vector<std::string> &template_files,
+                         const std::vector<std::string> &image_files, const std::vector<TemplateMatch> &results )
+{
+    std::ofstream file(path.c_str());
+    if( !file )
+        return false;
+
+    file << "[" << std::endl << std::setprecision(10);
+    for( size_t i = 0; i < results.size(); ++i )
+    {
+        const TemplateMatch &result = results[i];
+        file << "  {\"template\": " << json_string(template_files[result.template_index])
+             << ", \"image\": " << json_string(image_files[result.image_index])
+             << ", \"matches\": " << result.matches << ", \"inliers\": " << result.inliers
+             << ", \"found\": " << (result.found() ? "true" : "false") << ", \"ms\": " << result.ms << ", \"homography\": ";
+        if( result.found() )
+        {
+            file << "[";
+            for( int h = 0; h < 9; ++h )
+                file << (h ? ", " : "") << result.homography.ptr<double>()[h];
+            file << "]";
+        }
+        else
+            file << "null";
+        file << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    file << "]" << std::endl;
+    return static_cast<bool>(file);
+}
+
+} // namespace cvdemo
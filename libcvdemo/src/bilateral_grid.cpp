@@ -0,0 +1,181 @@
+/**
+ * Bilateral Grid
+ * brief fast approximation of the bilateral filter (J. Chen, S. Paris, F. Durand, "Real-time Edge-Aware
+ * Image Processing with the Bilateral Grid", 2007)
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/basic_operations.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Empty cells around the data, so that the grid blur and the trilinear slicing never leave the grid
+const int GRID_PADDING = 2;
+
+/**
+ * @function blur_axis
+ * brief convolves the row-major grid with [1 4 6 4 1]/16 along the axis of the given length,
+ * whose consecutive cells are stride floats apart
+ */
+void blur_axis( const std::vector<float> &in, std::vector<float> &out, size_t length, size_t stride )
+{
+    static const float weights[5] = { 1.f/16, 4.f/16, 6.f/16, 4.f/16, 1.f/16 };
+    const size_t outer = in.size() / (length * stride);
+
+    for( size_t o = 0; o < outer; ++o )
+    {
+        for( size_t a = 0; a < length; ++a )
+        {
+            float *dst = &out[(o*length + a)*stride];
+            std::fill( dst, dst + stride, 0.f );
+            for( int t = -2; t <= 2; ++t )
+            {
+                const long b = long(a) + t;
+                if( b < 0 || b >= long(length) )
+                    continue;
+                const float *src = &in[(o*length + b)*stride];
+                const float w = weights[t + 2];
+                for( size_t k = 0; k < stride; ++k )
+                    dst[k] += w*src[k];
+            }
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @function bilateral_grid_size
+ */
+size_t bilateral_grid_size( const cv::Size &size, double sigma_space, double sigma_color )
+{
+    const double ss = std::max( 1.0, sigma_space );
+    const double sr = std::max( 1.0, sigma_color );
+    const size_t width  = cvFloor( (size.width - 1) / ss ) + 1 + 2*GRID_PADDING;
+    const size_t height = cvFloor( (size.height - 1) / ss ) + 1 + 2*GRID_PADDING;
+    const size_t depth  = cvFloor( 255 / sr ) + 1 + 2*GRID_PADDING;
+    return width * height * depth;
+}
+
+/**
+ * @function bilateral_grid
+ */
+void bilateral_grid( const cv::Mat &src, cv::Mat &dst, double sigma_space, double sigma_color )
+{
+    if( src.depth() != CV_8U )
+    {
+        cv::bilateralFilter( src, dst, -1, sigma_color, sigma_space );
+        return;
+    }
+
+    const double ss = std::max( 1.0, sigma_space );
+    const double sr = std::max( 1.0, sigma_color );
+    const int cn = src.channels();
+    const size_t stride = cn + 1;   /// channel sums and the homogeneous weight
+    const int grid_width  = cvFloor( (src.cols - 1) / ss ) + 1 + 2*GRID_PADDING;
+    const int grid_height = cvFloor( (src.rows - 1) / ss ) + 1 + 2*GRID_PADDING;
+    const int grid_depth  = cvFloor( 255 / sr ) + 1 + 2*GRID_PADDING;
+
+    /// Range dimension: luminance for color images, as in Chen et al.
+    cv::Mat gray;
+    to_gray( src, gray );
+
+    /// Layout [y][x][intensity][channel]
+    std::vector<float> grid( size_t(grid_width) * grid_height * grid_depth * stride, 0.f );
+    std::vector<float> blurred( grid.size() );
+    #define GRID_CELL(x, y, z) (((size_t(y)*grid_width + (x))*grid_depth + (z))*stride)
+
+    /// Splat: every pixel goes in its nearest cell
+    for( int y = 0; y < src.rows; ++y )
+    {
+        const uchar *row = src.ptr<uchar>(y);
+        const uchar *luminance = gray.ptr<uchar>(y);
+        const int gy = cvRound( y / ss ) + GRID_PADDING;
+        for( int x = 0; x < src.cols; ++x )
+        {
+            float *cell = &grid[GRID_CELL( cvRound( x / ss ) + GRID_PADDING, gy, cvRound( luminance[x] / sr ) + GRID_PADDING )];
+            for( int c = 0; c < cn; ++c )
+                cell[c] += row[x*cn + c];
+            cell[cn] += 1.f;
+        }
+    }
+
+    /// Blur: separable along intensity, x and y
+    blur_axis( grid, blurred, grid_depth, stride );
+    blur_axis( blurred, grid, grid_width, grid_depth * stride );
+    blur_axis( grid, blurred, grid_height, size_t(grid_width) * grid_depth * stride );
+
+    /// Slice: trilinear interpolation at the position of every pixel
+    std::vector<int> column_cell( src.cols );
+    std::vector<float> column_weight( src.cols );
+    for( int x = 0; x < src.cols; ++x )
+    {
+        float fx = static_cast<float>( x / ss ) + GRID_PADDING;
+        column_cell[x] = cvFloor( fx );
+        column_weight[x] = fx - column_cell[x];
+    }
+
+    dst.create( src.size(), src.type() );
+    std::vector<float> sum( stride );
+    for( int y = 0; y < src.rows; ++y )
+    {
+        const uchar *row = src.ptr<uchar>(y);
+        const uchar *luminance = gray.ptr<uchar>(y);
+        uchar *out = dst.ptr<uchar>(y);
+
+        const float fy = static_cast<float>( y / ss ) + GRID_PADDING;
+        const int y0 = cvFloor( fy );
+        const float wy = fy - y0;
+
+        for( int x = 0; x < src.cols; ++x )
+        {
+            const float fz = static_cast<float>( luminance[x] / sr ) + GRID_PADDING;
+            const int z0 = cvFloor( fz );
+            const float wz = fz - z0;
+            const int x0 = column_cell[x];
+            const float wx = column_weight[x];
+
+            std::fill( sum.begin(), sum.end(), 0.f );
+            for( int corner = 0; corner < 8; ++corner )
+            {
+                const int dx = corner & 1, dy = (corner >> 1) & 1, dz = corner >> 2;
+                const float w = (dx ? wx : 1.f - wx) * (dy ? wy : 1.f - wy) * (dz ? wz : 1.f - wz);
+                const float *cell = &blurred[GRID_CELL( x0 + dx, y0 + dy, z0 + dz )];
+                for( size_t k = 0; k < stride; ++k )
+                    sum[k] += w*cell[k];
+            }
+
+            if( sum[cn] > std::numeric_limits<float>::epsilon() )
+                for( int c = 0; c < cn; ++c )
+                    out[x*cn + c] = cv::saturate_cast<uchar>( sum[c] / sum[cn] );
+            else
+                for( int c = 0; c < cn; ++c )
+                    out[x*cn + c] = row[x*cn + c];
+        }
+    }
+    #undef GRID_CELL
+}
+
+/**
+ * @function psnr
+ */
+double psnr( const cv::Mat &a, const cv::Mat &b )
+{
+    double squared_error = cv::norm( a, b, cv::NORM_L2SQR );
+    if( squared_error <= 0.0 )
+        return std::numeric_limits<double>::infinity();
+    double mse = squared_error / (double(a.total()) * a.channels());
+    return 10.0 * std::log10( 255.0 * 255.0 / mse );
+}
+
+} // namespace cvdemo
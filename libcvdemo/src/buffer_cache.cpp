@@ -0,0 +1,81 @@
+/**
+ * Buffer Cache
+ * brief intermediate buffers and structuring elements reused across trackbar events and video frames
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/buffer_cache.hpp"
+
+#include <cstring>
+
+namespace cvdemo
+{
+
+/**
+ * @function BufferCache::check
+ */
+void BufferCache::check( Buffer &buffer )
+{
+    if(buffer.mat.data == buffer.data)
+        return;
+    if(buffer.mat.data)
+        ++allocations_;
+    buffer.data = buffer.mat.data;
+}
+
+/**
+ * @function BufferCache::buffer
+ */
+cv::Mat& BufferCache::buffer( const char *name )
+{
+    for(std::deque<Buffer>::iterator it = buffers_.begin(); it != buffers_.end(); ++it)
+    {
+        if(std::strcmp(it->name, name) == 0)
+        {
+            check(*it);
+            return it->mat;
+        }
+    }
+
+    Buffer buffer;
+    buffer.name = name;
+    buffer.data = 0;
+    buffers_.push_back(buffer);
+    return buffers_.back().mat;
+}
+
+/**
+ * @function BufferCache::structuring_element
+ */
+const cv::Mat& BufferCache::structuring_element( ElementShape shape, int size )
+{
+    std::pair<int, int> key(static_cast<int>(shape), size);
+    std::map<std::pair<int, int>, cv::Mat>::iterator element = elements_.find(key);
+    if(element != elements_.end())
+        return element->second;
+
+    ++allocations_;
+    return elements_[key] = cvdemo::structuring_element(shape, size);
+}
+
+/**
+ * @function BufferCache::allocations
+ */
+size_t BufferCache::allocations()
+{
+    for(std::deque<Buffer>::iterator it = buffers_.begin(); it != buffers_.end(); ++it)
+        check(*it);
+    return allocations_;
+}
+
+/**
+ * @function BufferCache::clear
+ */
+void BufferCache::clear()
+{
+    buffers_.clear();
+    elements_.clear();
+    allocations_ = 0;
+}
+
+} // namespace cvdemo
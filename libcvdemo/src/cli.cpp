@@ -0,0 +1,160 @@
+/**
+ * Command Line
+ * brief parsing of the command line arguments shared by all the demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/cli.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace cvdemo
+{
+
+/**
+ * @function has_image_extension
+ */
+bool has_image_extension( const std::string &file_name )
+{
+    std::string::size_type dot = file_name.find_last_of('.');
+    if(dot == std::string::npos)
+        return false;
+
+    std::string extension = file_name.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "jpg" || extension == "png";
+}
+
+/**
+ * @function CommandLine
+ */
+CommandLine::CommandLine( int argc, const char* const* argv, const std::vector<std::string> &value_options )
+{
+    std::vector<std::string> expecting_value(value_options);
+    expecting_value.push_back("batch");
+    expecting_value.push_back("out");
+    expecting_value.push_back("video");
+    expecting_value.push_back("record");
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string argument(argv[i]);
+        if(argument.size() <= 2 || argument.compare(0, 2, "--") != 0)
+        {
+            positional_.push_back(argument);
+            continue;
+        }
+
+        std::string name = argument.substr(2);
+        if(std::find(expecting_value.begin(), expecting_value.end(), name) == expecting_value.end())
+        {
+            options_[name] = "";
+            continue;
+        }
+
+        if(i + 1 >= argc)
+        {
+            error_ = "Missing value for " + argument + ".";
+            return;
+        }
+        options_[name] = argv[++i];
+    }
+
+    if(has("batch") != has("out"))
+        error_ = "Both --batch and --out have to be given.";
+    else if(has("batch") && has("video"))
+        error_ = "Either --batch or --video can be given.";
+    else if(has("record") && !has("video"))
+        error_ = "--record needs a --video source.";
+}
+
+/**
+ * @function CommandLine::has
+ */
+bool CommandLine::has( const std::string &name ) const
+{
+    return options_.find(name) != options_.end();
+}
+
+/**
+ * @function CommandLine::get
+ */
+std::string CommandLine::get( const std::string &name, const std::string &default_value ) const
+{
+    std::map<std::string, std::string>::const_iterator option = options_.find(name);
+    return option == options_.end() ? default_value : option->second;
+}
+
+/**
+ * @function CommandLine::get_int
+ */
+int CommandLine::get_int( const std::string &name, int default_value ) const
+{
+    return has(name) ? std::atoi(get(name).c_str()) : default_value;
+}
+
+/**
+ * @function CommandLine::get_double
+ */
+double CommandLine::get_double( const std::string &name, double default_value ) const
+{
+    return has(name) ? std::atof(get(name).c_str()) : default_value;
+}
+
+/**
+ * @function CommandLine::images
+ */
+std::vector<std::string> CommandLine::images() const
+{
+    std::vector<std::string> images;
+    for(size_t i = 0; i < positional_.size(); ++i)
+        if(has_image_extension(positional_[i]))
+            images.push_back(positional_[i]);
+    return images;
+}
+
+/**
+ * @function CommandLine::batch
+ */
+BatchOptions CommandLine::batch() const
+{
+    BatchOptions options;
+    options.input = get("batch");
+    options.output_dir = get("out");
+    options.enabled = !options.input.empty() && !options.output_dir.empty();
+    return options;
+}
+
+/**
+ * @function CommandLine::stream
+ */
+StreamOptions CommandLine::stream() const
+{
+    StreamOptions options;
+    options.source = get("video");
+    options.record_file = get("record");
+    options.headless = has("headless");
+    options.enabled = !options.source.empty();
+    return options;
+}
+
+/**
+ * @function show_help
+ */
+void show_help( const std::string &application, const std::vector<std::string> &usages, const std::string &message )
+{
+    #ifdef DEBUG_MODE
+    std::string executable = application + "_d";
+    #else
+    std::string executable = application;
+    #endif
+
+    std::cout << "Error: " << message << std::endl << std::endl;
+    for(size_t i = 0; i < usages.size(); ++i)
+        std::cout << (i == 0 ? "Usage: " : "       ") << executable << " " << usages[i] << std::endl;
+    std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
+}
+
+} // namespace cvdemo
@@ -0,0 +1,395 @@
+/**
+ * Connected Components
+ * brief parallel labelling of the connected components: strips scanned independently, merged with a lock-free union-find
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/image_processing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <vector>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/**
+ * Union-find shared by the strips: a root is only linked to a smaller root, with a compare-and-swap, so that the
+ * parents only decrease and the seams can be merged concurrently without locks. During the scan every strip only
+ * touches its own range of labels.
+ */
+class AtomicUnionFind
+{
+public:
+    explicit AtomicUnionFind( size_t size ) : parent_(size) {}
+
+    int make( int id )
+    {
+        parent_[id].store(id, std::memory_order_relaxed);
+        return id;
+    }
+
+    int find( int id )
+    {
+        for(;;)
+        {
+            int parent = parent_[id].load(std::memory_order_relaxed);
+            if(parent == id)
+                return id;
+            /// Path halving, skipped if another thread has moved the parent meanwhile
+            int grandparent = parent_[parent].load(std::memory_order_relaxed);
+            if(grandparent != parent)
+                parent_[id].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+            id = grandparent;
+        }
+    }
+
+    void unite( int a, int b )
+    {
+        for(;;)
+        {
+            a = find(a);
+            b = find(b);
+            if(a == b)
+                return;
+            if(b < a)
+                std::swap(a, b);
+            /// Fails if b has been linked by another thread since find(), then both roots are searched again
+            int expected = b;
+            if(parent_[b].compare_exchange_strong(expected, a, std::memory_order_relaxed))
+                return;
+        }
+    }
+
+    int parent( int id ) const { return parent_[id].load(std::memory_order_relaxed); }
+    void set_parent( int id, int parent ) { parent_[id].store(parent, std::memory_order_relaxed); }
+
+private:
+    std::vector< std::atomic<int> > parent_;
+};
+
+/// Rows of a strip and the provisional labels it has created: base ... base + count - 1
+struct Strip
+{
+    int start, end;
+    int base, count;
+};
+
+/**
+ * Scan of the strips: every foreground pixel takes the label of an already labelled neighbour (west and the row
+ * above, inside the strip), or a new one. With 8-connectivity the north neighbour, when labelled, is already joined
+ * with the west, north-west and north-east ones, so most pixels need no union at all.
+ */
+class ScanBody : public cv::ParallelLoopBody
+{
+public:
+    ScanBody( const cv::Mat &binary, cv::Mat &labels, std::vector<Strip> &strips, AtomicUnionFind &sets, int connectivity )
+        : binary_(binary), labels_(labels), strips_(strips), sets_(sets), connectivity_(connectivity) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        const int cols = binary_.cols;
+        for(int s = range.start; s < range.end; ++s)
+        {
+            Strip &strip = strips_[s];
+            int next = strip.base;
+            for(int y = strip.start; y < strip.end; ++y)
+            {
+                const uchar *row = binary_.ptr<uchar>(y);
+                int *labels = labels_.ptr<int>(y);
+                const int *above = y > strip.start ? labels_.ptr<int>(y - 1) : 0;
+                for(int x = 0; x < cols; ++x)
+                {
+                    if(!row[x])
+                    {
+                        labels[x] = 0;
+                        continue;
+                    }
+
+                    const int west = x > 0 ? labels[x-1] : 0;
+                    const int north = above ? above[x] : 0;
+                    if(north)
+                    {
+                        labels[x] = north;
+                        if(connectivity_ == 4 && west)
+                            sets_.unite(north, west);
+                        continue;
+                    }
+                    if(connectivity_ == 8 && above)
+                    {
+                        const int north_west = x > 0 ? above[x-1] : 0;
+                        const int north_east = x + 1 < cols ? above[x+1] : 0;
+                        if(north_west)
+                        {
+                            labels[x] = north_west;
+                            if(north_east)
+                                sets_.unite(north_west, north_east);
+                            continue;
+                        }
+                        if(north_east)
+                        {
+                            labels[x] = north_east;
+                            if(west)
+                                sets_.unite(west, north_east);
+                            continue;
+                        }
+                    }
+                    labels[x] = west ? west : sets_.make(next++);
+                }
+            }
+            strip.count = next - strip.base;
+        }
+    }
+
+private:
+    const cv::Mat &binary_;
+    cv::Mat &labels_;
+    std::vector<Strip> &strips_;
+    AtomicUnionFind &sets_;
+    int connectivity_;
+};
+
+/**
+ * Merge of the seams: the first row of every strip joined with the last row of the strip above, concurrently
+ */
+class SeamBody : public cv::ParallelLoopBody
+{
+public:
+    SeamBody( const cv::Mat &labels, const std::vector<Strip> &strips, AtomicUnionFind &sets, int connectivity )
+        : labels_(labels), strips_(strips), sets_(sets), connectivity_(connectivity) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        const int cols = labels_.cols;
+        for(int s = range.start; s < range.end; ++s)
+        {
+            const int y = strips_[s].start;
+            const int *labels = labels_.ptr<int>(y);
+            const int *above = labels_.ptr<int>(y - 1);
+            for(int x = 0; x < cols; ++x)
+            {
+                if(!labels[x])
+                    continue;
+                if(above[x])
+                    sets_.unite(labels[x], above[x]);
+                else if(connectivity_ == 8)
+                {
+                    if(x > 0 && above[x-1])
+                        sets_.unite(labels[x], above[x-1]);
+                    if(x + 1 < cols && above[x+1])
+                        sets_.unite(labels[x], above[x+1]);
+                }
+            }
+        }
+    }
+
+private:
+    const cv::Mat &labels_;
+    const std::vector<Strip> &strips_;
+    AtomicUnionFind &sets_;
+    int connectivity_;
+};
+
+/**
+ * Provisional labels replaced by the final ones, which the flattening has stored in the union-find
+ */
+class RelabelBody : public cv::ParallelLoopBody
+{
+public:
+    RelabelBody( cv::Mat &labels, const AtomicUnionFind &sets ) : labels_(labels), sets_(sets) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        for(int y = range.start; y < range.end; ++y)
+        {
+            int *labels = labels_.ptr<int>(y);
+            for(int x = 0; x < labels_.cols; ++x)
+                labels[x] = sets_.parent(labels[x]);
+        }
+    }
+
+private:
+    cv::Mat &labels_;
+    const AtomicUnionFind &sets_;
+};
+
+/// Sums of a component over a strip
+struct StatsAccumulator
+{
+    StatsAccumulator() : area(0), left(INT_MAX), top(INT_MAX), right(-1), bottom(-1), sum_x(0), sum_y(0) {}
+
+    void add( int x, int y )
+    {
+        ++area;
+        left = std::min(left, x);
+        right = std::max(right, x);
+        top = std::min(top, y);
+        bottom = std::max(bottom, y);
+        sum_x += x;
+        sum_y += y;
+    }
+
+    void add( const StatsAccumulator &other )
+    {
+        area += other.area;
+        left = std::min(left, other.left);
+        right = std::max(right, other.right);
+        top = std::min(top, other.top);
+        bottom = std::max(bottom, other.bottom);
+        sum_x += other.sum_x;
+        sum_y += other.sum_y;
+    }
+
+    int64 area;
+    int left, top, right, bottom;
+    int64 sum_x, sum_y;
+};
+
+/**
+ * Statistics of the components, per strip: only the range between the smallest and the largest label found in the
+ * strip is accumulated (components rarely span many strips), the background apart
+ */
+class StatsBody : public cv::ParallelLoopBody
+{
+public:
+    StatsBody( const cv::Mat &labels, const std::vector<Strip> &strips, std::vector<int> &first_label,
+               std::vector< std::vector<StatsAccumulator> > &partial, std::vector<StatsAccumulator> &background )
+        : labels_(labels), strips_(strips), first_label_(first_label), partial_(partial), background_(background) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        for(int s = range.start; s < range.end; ++s)
+        {
+            const Strip &strip = strips_[s];
+            int first = INT_MAX, last = 0;
+            for(int y = strip.start; y < strip.end; ++y)
+            {
+                const int *labels = labels_.ptr<int>(y);
+                for(int x = 0; x < labels_.cols; ++x)
+                    if(labels[x])
+                    {
+                        first = std::min(first, labels[x]);
+                        last = std::max(last, labels[x]);
+                    }
+            }
+
+            std::vector<StatsAccumulator> &partial = partial_[s];
+            partial.assign(last >= first ? last - first + 1 : 0, StatsAccumulator());
+            first_label_[s] = first;
+            for(int y = strip.start; y < strip.end; ++y)
+            {
+                const int *labels = labels_.ptr<int>(y);
+                for(int x = 0; x < labels_.cols; ++x)
+                {
+                    if(labels[x])
+                        partial[labels[x] - first].add(x, y);
+                    else
+                        background_[s].add(x, y);
+                }
+            }
+        }
+    }
+
+private:
+    const cv::Mat &labels_;
+    const std::vector<Strip> &strips_;
+    std::vector<int> &first_label_;
+    std::vector< std::vector<StatsAccumulator> > &partial_;
+    std::vector<StatsAccumulator> &background_;
+};
+
+/**
+ * @function to_stats
+ */
+ComponentStats to_stats( const StatsAccumulator &sums )
+{
+    ComponentStats stats;
+    stats.area = static_cast<int>(sums.area);
+    if(sums.area == 0)
+    {
+        stats.bbox = cv::Rect();
+        stats.centroid = cv::Point2d();
+        return stats;
+    }
+    stats.bbox = cv::Rect(sums.left, sums.top, sums.right - sums.left + 1, sums.bottom - sums.top + 1);
+    stats.centroid = cv::Point2d(static_cast<double>(sums.sum_x) / sums.area, static_cast<double>(sums.sum_y) / sums.area);
+    return stats;
+}
+
+} // namespace
+
+/**
+ * @function label_components
+ */
+int label_components( const cv::Mat &binary, cv::Mat &labels, int connectivity, std::vector<ComponentStats> *stats )
+{
+    CV_Assert(binary.type() == CV_8UC1 && (connectivity == 4 || connectivity == 8));
+    labels.create(binary.size(), CV_32SC1);
+    if(binary.empty())
+    {
+        if(stats)
+            stats->clear();
+        return 1;
+    }
+
+    /// Some strips per thread, so that the threads stay busy if the components are not evenly spread.
+    /// The labels of a strip start after the pixels of the strips above: no strip can run out of labels
+    const int rows = binary.rows, cols = binary.cols;
+    const int num_strips = std::min(rows, std::max(1, cv::getNumThreads()) * 4);
+    std::vector<Strip> strips(num_strips);
+    for(int s = 0; s < num_strips; ++s)
+    {
+        strips[s].start = static_cast<int>(static_cast<int64>(rows) * s / num_strips);
+        strips[s].end = static_cast<int>(static_cast<int64>(rows) * (s + 1) / num_strips);
+        strips[s].base = strips[s].start * cols + 1;
+        strips[s].count = 0;
+    }
+
+    AtomicUnionFind sets(static_cast<size_t>(rows) * cols + 1);
+    cv::parallel_for_(cv::Range(0, num_strips), ScanBody(binary, labels, strips, sets, connectivity));
+    if(num_strips > 1)
+        cv::parallel_for_(cv::Range(1, num_strips), SeamBody(labels, strips, sets, connectivity));
+
+    /// Flattening in the order of the provisional labels, that is the raster order of the first pixel of every
+    /// component: a root gets the next final label, any other label the final label of its parent, already assigned
+    int num_labels = 1;
+    sets.set_parent(0, 0);
+    for(int s = 0; s < num_strips; ++s)
+    {
+        for(int id = strips[s].base; id < strips[s].base + strips[s].count; ++id)
+        {
+            const int parent = sets.parent(id);
+            sets.set_parent(id, parent < id ? sets.parent(parent) : num_labels++);
+        }
+    }
+    cv::parallel_for_(cv::Range(0, rows), RelabelBody(labels, sets));
+
+    if(stats)
+    {
+        std::vector<int> first_label(num_strips);
+        std::vector< std::vector<StatsAccumulator> > partial(num_strips);
+        std::vector<StatsAccumulator> background(num_strips);
+        cv::parallel_for_(cv::Range(0, num_strips), StatsBody(labels, strips, first_label, partial, background));
+
+        std::vector<StatsAccumulator> sums(num_labels);
+        for(int s = 0; s < num_strips; ++s)
+        {
+            sums[0].add(background[s]);
+            for(size_t i = 0; i < partial[s].size(); ++i)
+                if(partial[s][i].area)
+                    sums[first_label[s] + i].add(partial[s][i]);
+        }
+
+        stats->resize(num_labels);
+        for(int i = 0; i < num_labels; ++i)
+            (*stats)[i] = to_stats(sums[i]);
+    }
+
+    return num_labels;
+}
+
+} // namespace cvdemo
@@ -0,0 +1,482 @@
+/**
+ * Descriptor Index
+ * brief keypoints and descriptors of an image collection stored once on disk and memory-mapped for the queries
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/descriptor_index.hpp"
+#include "cvdemo/hamming_matcher.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <opencv2/highgui/highgui.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cvdemo
+{
+
+namespace
+{
+
+const char INDEX_MAGIC[8] = { 'C', 'V', 'D', 'I', 'N', 'D', 'E', 'X' };
+const int INDEX_VERSION = 1;
+/// The descriptors start on a cache line
+const int64 DESCRIPTORS_ALIGNMENT = 64;
+
+/// Layout of the file: header, descriptors, keypoints, images, names; offsets in bytes from the start of the file
+struct IndexHeader
+{
+    char magic[8];
+    int version;
+    int detector;
+    int descriptor_type;
+    int descriptor_cols;
+    int64 num_images;
+    int64 num_descriptors;
+    int64 descriptors_offset;
+    int64 keypoints_offset;
+    int64 images_offset;
+    int64 names_offset;
+    int64 file_size;
+};
+
+/// One per descriptor, in the same order
+struct IndexKeypoint
+{
+    float x, y;
+    float size;
+    float angle;
+    float response;
+    int octave;
+    int image;
+};
+
+/// One per image: its rows of the descriptors and its path in the names
+struct IndexImage
+{
+    int64 first_descriptor;
+    int64 num_descriptors;
+    int64 name_offset;
+    int64 name_length;
+};
+
+/**
+ * @function write_padding
+ * brief zeros up to the next multiple of alignment
+ */
+void write_padding( std::ostream &out, int64 alignment )
+{
+    static const char zeros[DESCRIPTORS_ALIGNMENT] = { 0 };
+    const int64 position = static_cast<int64>(out.tellp());
+    out.write(zeros, static_cast<std::streamsize>((alignment - position % alignment) % alignment));
+}
+
+/**
+ * Ratio test matches of the template against every image of a range, on the mapped descriptors
+ */
+class QueryBody : public cv::ParallelLoopBody
+{
+public:
+    QueryBody( const DescriptorIndex &index, const cv::Mat &query, float ratio, std::vector<int> &counts )
+        : index_(index), query_(query), ratio_(ratio), counts_(counts) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        std::vector<std::vector<cv::DMatch> > knn_matches;
+        for( int image = range.start; image < range.end; ++image )
+        {
+            const cv::Range rows = index_.image_range(image);
+            counts_[image] = 0;
+            if( rows.size() < 2 )
+                continue;
+
+            const cv::Mat train = index_.descriptors().rowRange(rows);
+            if( train.depth() == CV_8U )
+                hamming_knn_match(query_, train, knn_matches, 2);
+            else
+                cv::BFMatcher(cv::NORM_L2).knnMatch(query_, train, knn_matches, 2);
+
+            for( size_t q = 0; q < knn_matches.size(); ++q )
+                if( knn_matches[q].size() == 2 && knn_matches[q][0].distance < ratio_ * knn_matches[q][1].distance )
+                    ++counts_[image];
+        }
+    }
+
+private:
+    const DescriptorIndex &index_;
+    const cv::Mat &query_;
+    float ratio_;
+    std::vector<int> &counts_;
+};
+
+/// Most matches first, then in the order of the index
+bool more_matches( const IndexMatch &a, const IndexMatch &b )
+{
+    return a.matches > b.matches || (a.matches == b.matches && a.image < b.image);
+}
+
+/**
+ * @function ranked_images
+ * brief the images with at least min_matches matches, most matches first
+ */
+std::vector<IndexMatch> ranked_images( const std::vector<int> &counts, int min_matches )
+{
+    std::vector<IndexMatch> result;
+    for(size_t image = 0; image < counts.size(); ++image)
+    {
+        if(counts[image] >= min_matches)
+        {
+            IndexMatch match = { static_cast<int>(image), counts[image] };
+            result.push_back(match);
+        }
+    }
+    std::sort(result.begin(), result.end(), more_matches);
+    return result;
+}
+
+} // namespace
+
+/**
+ * @function build_descriptor_index
+ */
+int64 build_descriptor_index( Detector type, const std::vector<std::string> &image_files, const std::string &index_path )
+{
+    cv::Ptr<cv::Feature2D> detector = create_detector(type);
+    if(detector.empty())
+        return -1;
+
+    std::ofstream file(index_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    /// Keypoints follow the descriptors: they are staged in a second file until all the descriptors are written
+    const std::string keypoints_path = index_path + ".keypoints.tmp";
+    std::fstream keypoints_file(keypoints_path.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open() || !keypoints_file.is_open())
+        return -1;
+
+    IndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.detector = type;
+    header.descriptor_type = -1;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_padding(file, DESCRIPTORS_ALIGNMENT);
+    header.descriptors_offset = static_cast<int64>(file.tellp());
+
+    std::vector<IndexImage> images(image_files.size());
+    std::string names;
+    for(size_t i = 0; i < image_files.size(); ++i)
+    {
+        IndexImage &image = images[i];
+        image.first_descriptor = header.num_descriptors;
+        image.num_descriptors = 0;
+        image.name_offset = static_cast<int64>(names.size());
+        image.name_length = static_cast<int64>(image_files[i].size());
+        names += image_files[i];
+
+        std::vector<cv::KeyPoint> keypoints;
+        cv::Mat descriptors;
+        cv::Mat src = cv::imread(image_files[i], 1);
+        if(!src.data)
+            continue;
+        if(detect_and_compute(detector, src, keypoints, descriptors) == 0 || descriptors.empty())
+            continue;
+
+        if(header.descriptor_type < 0)
+        {
+            header.descriptor_type = descriptors.type();
+            header.descriptor_cols = descriptors.cols;
+        }
+        CV_Assert( descriptors.type() == header.descriptor_type && descriptors.cols == header.descriptor_cols );
+        if(!descriptors.isContinuous())
+            descriptors = descriptors.clone();
+        file.write(reinterpret_cast<const char*>(descriptors.data), static_cast<std::streamsize>(descriptors.total() * descriptors.elemSize()));
+
+        for(int k = 0; k < descriptors.rows; ++k)
+        {
+            const cv::KeyPoint &keypoint = keypoints[k];
+            IndexKeypoint record = { keypoint.pt.x, keypoint.pt.y, keypoint.size, keypoint.angle, keypoint.response,
+                                     keypoint.octave, static_cast<int>(i) };
+            keypoints_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        }
+
+        image.num_descriptors = descriptors.rows;
+        header.num_descriptors += descriptors.rows;
+    }
+    if(header.descriptor_type < 0)
+        header.descriptor_type = CV_8UC1;
+
+    /// Keypoints, images and names after the descriptors
+    write_padding(file, 8);
+    header.keypoints_offset = static_cast<int64>(file.tellp());
+    keypoints_file.flush();
+    keypoints_file.seekg(0);
+    if(header.num_descriptors > 0)
+        file << keypoints_file.rdbuf();
+    keypoints_file.close();
+    std::remove(keypoints_path.c_str());
+
+    header.images_offset = static_cast<int64>(file.tellp());
+    if(!images.empty())
+        file.write(reinterpret_cast<const char*>(&images[0]), static_cast<std::streamsize>(images.size() * sizeof(IndexImage)));
+    header.names_offset = static_cast<int64>(file.tellp());
+    file.write(names.data(), static_cast<std::streamsize>(names.size()));
+    header.file_size = static_cast<int64>(file.tellp());
+
+    header.num_images = static_cast<int64>(images.size());
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    return file.fail() ? -1 : header.num_descriptors;
+}
+
+/**
+ * @function DescriptorIndex
+ */
+DescriptorIndex::DescriptorIndex()
+    : data_(0), size_(0), detector_(DETECTOR_ORB), num_images_(0), num_descriptors_(0), keypoints_(0), images_(0), names_(0)
+{
+}
+
+/**
+ * @function ~DescriptorIndex
+ */
+DescriptorIndex::~DescriptorIndex()
+{
+    close();
+}
+
+/**
+ * @function DescriptorIndex::open
+ */
+bool DescriptorIndex::open( const std::string &path )
+{
+    close();
+
+    /// The handles can be closed once mapped, the mapping keeps the file open
+    #ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER file_size;
+    HANDLE mapping = NULL;
+    if(GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if(mapping == NULL)
+        return false;
+    const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if(data == NULL)
+        return false;
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    #else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if(file < 0)
+        return false;
+    struct stat info;
+    void *data = MAP_FAILED;
+    if(fstat(file, &info) == 0 && info.st_size > 0)
+        data = mmap(0, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if(data == MAP_FAILED)
+        return false;
+    size_ = static_cast<size_t>(info.st_size);
+    #endif
+    data_ = static_cast<const uchar*>(data);
+
+    IndexHeader header;
+    if(size_ < sizeof(header))
+    {
+        close();
+        return false;
+    }
+    std::memcpy(&header, data_, sizeof(header));
+
+    const int64 size = static_cast<int64>(size_);
+    const int64 row_bytes = static_cast<int64>(header.descriptor_cols) * CV_ELEM_SIZE(header.descriptor_type);
+    if(std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 || header.version != INDEX_VERSION ||
+       header.detector < DETECTOR_ORB || header.detector > DETECTOR_SURF || header.file_size != size ||
+       (header.descriptor_type != CV_8UC1 && header.descriptor_type != CV_32FC1) || header.descriptor_cols < 0 ||
+       header.descriptors_offset < static_cast<int64>(sizeof(header)) || header.num_images < 0 || header.num_images > INT_MAX || header.num_descriptors < 0 || header.num_descriptors > INT_MAX ||
+       header.descriptors_offset + header.num_descriptors * row_bytes > header.keypoints_offset ||
+       header.keypoints_offset + header.num_descriptors * static_cast<int64>(sizeof(IndexKeypoint)) > header.images_offset ||
+       header.images_offset + header.num_images * static_cast<int64>(sizeof(IndexImage)) > header.names_offset ||
+       header.names_offset > size)
+    {
+        close();
+        return false;
+    }
+
+    /// Every image has to reference rows of the descriptors and a name inside the file
+    for(int64 i = 0; i < header.num_images; ++i)
+    {
+        IndexImage record;
+        std::memcpy(&record, data_ + header.images_offset + i * static_cast<int64>(sizeof(IndexImage)), sizeof(record));
+        if(record.first_descriptor < 0 || record.num_descriptors < 0 ||
+           record.first_descriptor > header.num_descriptors || record.num_descriptors > header.num_descriptors - record.first_descriptor ||
+           record.name_offset < 0 || record.name_length < 0 ||
+           record.name_offset > size - header.names_offset || record.name_length > size - header.names_offset - record.name_offset)
+        {
+            close();
+            return false;
+        }
+    }
+
+    detector_ = static_cast<Detector>(header.detector);
+    num_images_ = static_cast<int>(header.num_images);
+    num_descriptors_ = header.num_descriptors;
+    descriptors_ = cv::Mat(static_cast<int>(num_descriptors_), header.descriptor_cols, header.descriptor_type,
+                           const_cast<uchar*>(data_ + header.descriptors_offset));
+    keypoints_ = data_ + header.keypoints_offset;
+    images_ = data_ + header.images_offset;
+    names_ = reinterpret_cast<const char*>(data_ + header.names_offset);
+    return true;
+}
+
+/**
+ * @function DescriptorIndex::close
+ */
+void DescriptorIndex::close()
+{
+    descriptors_.release();
+    if(data_)
+    {
+        #ifdef _WIN32
+        UnmapViewOfFile(data_);
+        #else
+        munmap(const_cast<uchar*>(data_), size_);
+        #endif
+    }
+    data_ = 0;
+    size_ = 0;
+    num_images_ = 0;
+    num_descriptors_ = 0;
+    keypoints_ = images_ = 0;
+    names_ = 0;
+}
+
+/**
+ * @function DescriptorIndex::image_range
+ */
+cv::Range DescriptorIndex::image_range( int image ) const
+{
+    CV_Assert( image >= 0 && image < num_images_ );
+    IndexImage record;
+    std::memcpy(&record, images_ + image * sizeof(IndexImage), sizeof(record));
+    return cv::Range(static_cast<int>(record.first_descriptor), static_cast<int>(record.first_descriptor + record.num_descriptors));
+}
+
+/**
+ * @function DescriptorIndex::image_path
+ */
+std::string DescriptorIndex::image_path( int image ) const
+{
+    CV_Assert( image >= 0 && image < num_images_ );
+    IndexImage record;
+    std::memcpy(&record, images_ + image * sizeof(IndexImage), sizeof(record));
+    return std::string(names_ + record.name_offset, static_cast<size_t>(record.name_length));
+}
+
+/**
+ * @function DescriptorIndex::keypoint
+ */
+cv::KeyPoint DescriptorIndex::keypoint( int64 row, int *image ) const
+{
+    CV_Assert( row >= 0 && row < num_descriptors_ );
+    IndexKeypoint record;
+    std::memcpy(&record, keypoints_ + row * sizeof(IndexKeypoint), sizeof(record));
+    if(image)
+        *image = record.image;
+    return cv::KeyPoint(record.x, record.y, record.size, record.angle, record.response, record.octave);
+}
+
+/**
+ * @function query_descriptor_index
+ */
+std::vector<IndexMatch> query_descriptor_index( const DescriptorIndex &index, const cv::Mat &template_descriptors,
+                                                int min_matches, float ratio )
+{
+    std::vector<IndexMatch> result;
+    if(!index.is_open() || template_descriptors.empty() || index.num_descriptors() == 0)
+        return result;
+    CV_Assert( template_descriptors.type() == index.descriptors().type() && template_descriptors.cols == index.descriptors().cols );
+
+    std::vector<int> counts(index.num_images(), 0);
+    cv::parallel_for_(cv::Range(0, index.num_images()), QueryBody(index, template_descriptors, ratio, counts));
+    return ranked_images(counts, min_matches);
+}
+
+/**
+ * @function query_descriptor_index
+ */
+std::vector<IndexMatch> query_descriptor_index( const DescriptorIndex &index, const MultiIndexHashing &hashing,
+                                                const cv::Mat &template_descriptors, int min_matches, float ratio,
+                                                int neighbours, int max_radius )
+{
+    std::vector<IndexMatch> result;
+    if(!index.is_open() || hashing.empty() || template_descriptors.empty() || index.num_descriptors() == 0)
+        return result;
+    CV_Assert( template_descriptors.type() == CV_8UC1 && template_descriptors.type() == index.descriptors().type() &&
+               template_descriptors.cols == index.descriptors().cols );
+
+    /// Image of a row: the last image starting at or before it (images without descriptors start where the next one does)
+    std::vector<int> starts(index.num_images());
+    for(int image = 0; image < index.num_images(); ++image)
+        starts[image] = index.image_range(image).start;
+
+    neighbours = std::max(2, neighbours);
+    max_radius = std::max(0, max_radius);
+    std::vector<std::vector<cv::DMatch> > knn_matches;
+    hashing.knn_match(template_descriptors, knn_matches, neighbours, max_radius);
+
+    /// Descriptors out of a list are beyond max_radius bits on every substring, or farther than the last of a full list
+    const float unseen = static_cast<float>(hashing.substrings() * (max_radius + 1));
+    std::vector<int> counts(index.num_images(), 0);
+    std::vector<int> image_of;
+    std::vector<int> last_query(index.num_images(), -1);
+    for(size_t q = 0; q < knn_matches.size(); ++q)
+    {
+        const std::vector<cv::DMatch> &list = knn_matches[q];
+        const float beyond = static_cast<int>(list.size()) == neighbours ? std::min(unseen, list.back().distance) : unseen;
+
+        image_of.resize(list.size());
+        for(size_t i = 0; i < list.size(); ++i)
+            image_of[i] = static_cast<int>(std::upper_bound(starts.begin(), starts.end(), list[i].trainIdx) - starts.begin()) - 1;
+
+        /// Nearest descriptor of every image in the list against the second one of the same image
+        for(size_t i = 0; i < list.size(); ++i)
+        {
+            const int image = image_of[i];
+            if(image < 0 || last_query[image] == static_cast<int>(q))
+                continue;
+            last_query[image] = static_cast<int>(q);
+            if(index.image_range(image).size() < 2)
+                continue;
+
+            float second = beyond;
+            for(size_t j = i + 1; j < list.size(); ++j)
+                if(image_of[j] == image)
+                {
+                    second = list[j].distance;
+                    break;
+                }
+            if(list[i].distance < ratio * second)
+                ++counts[image];
+        }
+    }
+    return ranked_images(counts, min_matches);
+}
+
+} // namespace cvdemo
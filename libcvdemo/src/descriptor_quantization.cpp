@@ -0,0 +1,77 @@
+/**
+ * Descriptor Quantization
+ * brief compact form of the float descriptors (SIFT, SURF): optional PCA reduction, then one byte per dimension
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/descriptor_quantization.hpp"
+
+#include <algorithm>
+
+namespace cvdemo
+{
+
+/**
+ * @function DescriptorQuantizer::train
+ */
+bool DescriptorQuantizer::train( const cv::Mat &descriptors, const QuantizationOptions &options )
+{
+    dimensions_ = 0;
+    if( descriptors.empty() || descriptors.type() != CV_32FC1 )
+        return false;
+
+    /// The PCA needs more descriptors than components
+    cv::Mat values = descriptors;
+    projected_ = options.pca(descriptors.cols) && descriptors.rows > options.dimensions;
+    if( projected_ )
+    {
+        pca_ = cv::PCA(descriptors, cv::Mat(), cv::PCA::DATA_AS_ROW, options.dimensions);
+        values = pca_.project(descriptors);
+    }
+
+    /// Range of the values but the 0.1% most extreme ones on either side, which saturate: a few outliers
+    /// would otherwise waste most of the 256 levels
+    std::vector<float> sorted;
+    sorted.reserve(values.total());
+    for( int r = 0; r < values.rows; ++r )
+        sorted.insert(sorted.end(), values.ptr<float>(r), values.ptr<float>(r) + values.cols);
+    const size_t low = sorted.size() / 1000, high = sorted.size() - 1 - low;
+    std::nth_element(sorted.begin(), sorted.begin() + low, sorted.end());
+    const float minimum = sorted[low];
+    std::nth_element(sorted.begin(), sorted.begin() + high, sorted.end());
+    const float maximum = sorted[high];
+
+    offset_ = minimum;
+    scale_ = maximum > minimum ? 255.0f / (maximum - minimum) : 1.0f;
+    dimensions_ = values.cols;
+    return true;
+}
+
+/**
+ * @function DescriptorQuantizer::quantize
+ */
+void DescriptorQuantizer::quantize( const cv::Mat &descriptors, cv::Mat &quantized ) const
+{
+    if( descriptors.empty() )
+    {
+        quantized.release();
+        return;
+    }
+    CV_Assert( !empty() && descriptors.type() == CV_32FC1 );
+
+    /// convertTo rounds and saturates to [0, 255]
+    const cv::Mat values = projected_ ? pca_.project(descriptors) : descriptors;
+    values.convertTo(quantized, CV_8U, scale_, -offset_ * scale_);
+}
+
+/**
+ * @function DescriptorQuantizer::to_float_distances
+ */
+void DescriptorQuantizer::to_float_distances( std::vector<std::vector<cv::DMatch> > &matches ) const
+{
+    for( size_t q = 0; q < matches.size(); ++q )
+        for( size_t i = 0; i < matches[q].size(); ++i )
+            matches[q][i].distance /= scale_;
+}
+
+} // namespace cvdemo
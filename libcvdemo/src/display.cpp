@@ -0,0 +1,80 @@
+/**
+ * Display
+ * brief shows the stages of a demo in a window, or writes them to disk in batch mode
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/display.hpp"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace cvdemo
+{
+
+/**
+ * @function Display
+ */
+Display::Display( const std::string &window_name, int caption_delay )
+    : window_name_(window_name), caption_delay_(caption_delay), writer_(0)
+{
+}
+
+/**
+ * @function Display::open
+ */
+void Display::open( int flags ) const
+{
+    if(!headless())
+        cv::namedWindow( window_name_, flags );
+}
+
+/**
+ * @function Display::caption
+ */
+int Display::caption( const std::string &text, const cv::Mat &reference ) const
+{
+    if(headless())
+    {
+        writer_->stage( text );
+        return 0;
+    }
+
+    cv::Mat dst = cv::Mat::zeros( reference.size(), reference.type() );
+    cv::putText( dst, text,
+        cv::Point( reference.cols/4, reference.rows/2),
+        cv::FONT_HERSHEY_COMPLEX, 1, cv::Scalar(255, 255, 255) );
+
+    cv::imshow( window_name_, dst );
+    int c = cv::waitKey( caption_delay_ );
+    if( c >= 0 ) { return -1; }
+    return 0;
+}
+
+/**
+ * @function Display::show
+ */
+int Display::show( const cv::Mat &image, int delay ) const
+{
+    if(headless())
+        return writer_->write( image ) ? 0 : -1;
+
+    cv::imshow( window_name_, image );
+    if( delay < 0 )
+        return 0;
+
+    int c = cv::waitKey( delay );
+    if( c >= 0 ) { return -1; }
+    return 0;
+}
+
+/**
+ * @function Display::wait
+ */
+int Display::wait( int delay ) const
+{
+    if(headless())
+        return -1;
+    return cv::waitKey( delay );
+}
+
+} // namespace cvdemo
@@ -0,0 +1,336 @@
+/**
+ * Feature Extraction
+ * brief keypoint detection and matching used by the ORB, BRISK, SIFT and SURF demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/feature_extraction.hpp"
+#include "cvdemo/matching_engine.hpp"
+#include "cvdemo/tiling.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <opencv2/opencv_modules.hpp>
+#ifdef HAVE_OPENCV_XFEATURES2D
+#include <opencv2/xfeatures2d/nonfree.hpp>
+#endif
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Parameters of the ORB detector: features kept over the whole image, scale pyramid and border ignored at every level
+const int ORB_FEATURES = 500;
+const float ORB_SCALE_FACTOR = 1.2f;
+const int ORB_LEVELS = 8;
+const int ORB_EDGE_THRESHOLD = 31;
+
+/// Keypoints of BRISK have a pattern of 12 px at scale 1, its coarsest layer (3 octaves) is at scale 6
+const int BRISK_BORDER = 12 * 6;
+/// SIFT and SURF have no bounded coarsest scale
+const int FLOAT_DETECTOR_BORDER = 96;
+
+/**
+ * @function create_orb
+ * brief ORB detector keeping the given number of features
+ */
+cv::Ptr<cv::Feature2D> create_orb( int features )
+{
+    #ifdef OPENCV_NEW
+    return cv::ORB::create(features, ORB_SCALE_FACTOR, ORB_LEVELS, ORB_EDGE_THRESHOLD);
+    #else
+    return cv::Ptr<cv::Feature2D>(new cv::ORB(features, ORB_SCALE_FACTOR, ORB_LEVELS, ORB_EDGE_THRESHOLD));
+    #endif
+}
+
+/**
+ * Detection and description of the tiles of a range, each with its own detector: the keypoints of the core of
+ * every tile, moved to image coordinates, and their descriptors. The ORB detectors get the share of ORB_FEATURES
+ * of the area of their tile
+ */
+class TileDetectionBody : public cv::ParallelLoopBody
+{
+public:
+    TileDetectionBody( Detector type, const cv::Mat &image, const std::vector<cv::Rect> &cores, int overlap,
+                       std::vector<std::vector<cv::KeyPoint> > &keypoints, std::vector<cv::Mat> &descriptors )
+        : type_(type), image_(image), cores_(cores), overlap_(overlap), keypoints_(keypoints), descriptors_(descriptors) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        /// Feature2D instances keep state while detecting: one per range, not shared between threads
+        cv::Ptr<cv::Feature2D> detector = create_detector(type_);
+        for( int i = range.start; i < range.end; ++i )
+        {
+            const cv::Rect &core = cores_[i];
+            const cv::Rect tile = cv::Rect(core.x - overlap_, core.y - overlap_, core.width + 2 * overlap_, core.height + 2 * overlap_)
+                                  & cv::Rect(0, 0, image_.cols, image_.rows);
+            if( type_ == DETECTOR_ORB && tile.area() < image_.cols * image_.rows )
+                detector = create_orb(std::max(1, cvCeil(static_cast<double>(ORB_FEATURES) * tile.area() / (image_.cols * image_.rows))));
+
+            std::vector<cv::KeyPoint> tile_keypoints;
+            cv::Mat tile_descriptors;
+            detect_and_compute(detector, image_(tile), tile_keypoints, tile_descriptors);
+
+            std::vector<int> kept;
+            for( size_t k = 0; k < tile_keypoints.size(); ++k )
+            {
+                tile_keypoints[k].pt.x += tile.x;
+                tile_keypoints[k].pt.y += tile.y;
+                if( core.contains(cv::Point(cvFloor(tile_keypoints[k].pt.x), cvFloor(tile_keypoints[k].pt.y))) )
+                    kept.push_back(static_cast<int>(k));
+            }
+
+            keypoints_[i].clear();
+            descriptors_[i] = cv::Mat(static_cast<int>(kept.size()), tile_descriptors.cols, tile_descriptors.type());
+            for( size_t k = 0; k < kept.size(); ++k )
+            {
+                keypoints_[i].push_back(tile_keypoints[kept[k]]);
+                tile_descriptors.row(kept[k]).copyTo(descriptors_[i].row(static_cast<int>(k)));
+            }
+        }
+    }
+
+private:
+    Detector type_;
+    const cv::Mat &image_;
+    const std::vector<cv::Rect> &cores_;
+    int overlap_;
+    std::vector<std::vector<cv::KeyPoint> > &keypoints_;
+    std::vector<cv::Mat> &descriptors_;
+};
+
+} // namespace
+
+/**
+ * @function detector_name
+ */
+std::string detector_name( Detector type )
+{
+    switch(type)
+    {
+        case DETECTOR_ORB:   return "ORB";
+        case DETECTOR_BRISK: return "BRISK";
+        case DETECTOR_SIFT:  return "SIFT";
+        case DETECTOR_SURF:  return "SURF";
+    }
+    return "";
+}
+
+/**
+ * @function parse_detector
+ */
+bool parse_detector( const std::string &name, Detector &type )
+{
+    std::string upper_name(name);
+    std::transform(upper_name.begin(), upper_name.end(), upper_name.begin(), ::toupper);
+
+    const Detector detectors[] = { DETECTOR_ORB, DETECTOR_BRISK, DETECTOR_SIFT, DETECTOR_SURF };
+    for(int i = 0; i < 4; ++i)
+        if(upper_name == detector_name(detectors[i]))
+        {
+            type = detectors[i];
+            return true;
+        }
+    return false;
+}
+
+/**
+ * @function create_detector
+ */
+cv::Ptr<cv::Feature2D> create_detector( Detector type )
+{
+    switch(type)
+    {
+        case DETECTOR_ORB:   return create_orb(ORB_FEATURES);
+        #ifdef OPENCV_NEW
+        case DETECTOR_BRISK: return cv::BRISK::create();
+        #else
+        case DETECTOR_BRISK: return cv::Feature2D::create("BRISK");
+        #endif
+        #ifdef HAVE_OPENCV_XFEATURES2D
+        case DETECTOR_SIFT:  return cv::xfeatures2d::SIFT::create();
+        case DETECTOR_SURF:  return cv::xfeatures2d::SURF::create();
+        #else
+        case DETECTOR_SIFT:
+        case DETECTOR_SURF:
+            std::cout << detector_name(type) << " not supported: OpenCV 3.x with the contrib module is required" << std::endl;
+            std::cout << "Please download OpenCV 3.0.0 here https://github.com/Itseez/opencv" << std::endl;
+            break;
+        #endif
+    }
+    return cv::Ptr<cv::Feature2D>();
+}
+
+/**
+ * @function detector_border
+ */
+int detector_border( Detector type )
+{
+    switch(type)
+    {
+        case DETECTOR_ORB:   return cvCeil(ORB_EDGE_THRESHOLD * std::pow(static_cast<double>(ORB_SCALE_FACTOR), ORB_LEVELS - 1));
+        case DETECTOR_BRISK: return BRISK_BORDER;
+        case DETECTOR_SIFT:
+        case DETECTOR_SURF:  return FLOAT_DETECTOR_BORDER;
+    }
+    return FLOAT_DETECTOR_BORDER;
+}
+
+/**
+ * @function create_matcher
+ */
+cv::Ptr<cv::DescriptorMatcher> create_matcher( Detector type, const FlannOptions &options )
+{
+    const cv::Ptr<cv::flann::SearchParams> search(new cv::flann::SearchParams(options.checks));
+    if(type == DETECTOR_ORB || type == DETECTOR_BRISK)
+    {
+        if(options.algorithm != FlannOptions::LSH)
+            return cv::Ptr<cv::DescriptorMatcher>(new cv::BFMatcher(cv::NORM_HAMMING));
+        const cv::Ptr<cv::flann::IndexParams> lsh(new cv::flann::LshIndexParams(options.table_number, options.key_size, options.multi_probe_level));
+        return cv::Ptr<cv::DescriptorMatcher>(new cv::FlannBasedMatcher(lsh, search));
+    }
+    const cv::Ptr<cv::flann::IndexParams> kdtree(new cv::flann::KDTreeIndexParams(options.trees));
+    return cv::Ptr<cv::DescriptorMatcher>(new cv::FlannBasedMatcher(kdtree, search));
+}
+
+/**
+ * @function detect_and_compute
+ */
+size_t detect_and_compute( const cv::Ptr<cv::Feature2D> &detector, const cv::Mat &image, std::vector<cv::KeyPoint> &keypoints,
+                           cv::Mat &descriptors )
+{
+    #ifdef OPENCV_NEW
+    detector->detectAndCompute(image, cv::noArray(), keypoints, descriptors);
+    #else
+    (*detector)(image, cv::noArray(), keypoints, descriptors);
+    #endif
+    return keypoints.size();
+}
+
+/**
+ * @function detect_and_compute_tiled
+ */
+int detect_and_compute_tiled( Detector type, const cv::Mat &image, const TiledDetection &options,
+                              std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors )
+{
+    keypoints.clear();
+    descriptors.release();
+    if(create_detector(type).empty())
+        return -1;
+
+    std::vector<cv::Rect> cores;
+    if(options.tile_size > 0)
+        cores = split_tiles(image.size(), options.tile_size);
+    else
+        cores.push_back(cv::Rect(0, 0, image.cols, image.rows));
+
+    std::vector<std::vector<cv::KeyPoint> > tile_keypoints(cores.size());
+    std::vector<cv::Mat> tile_descriptors(cores.size());
+    cv::parallel_for_(cv::Range(0, static_cast<int>(cores.size())),
+                      TileDetectionBody(type, image, cores, options.overlap < 0 ? detector_border(type) : options.overlap,
+                                        tile_keypoints, tile_descriptors));
+
+    /// Tiles in order, so that the result does not depend on the scheduling
+    std::vector<cv::Mat> non_empty;
+    for(size_t i = 0; i < cores.size(); ++i)
+    {
+        keypoints.insert(keypoints.end(), tile_keypoints[i].begin(), tile_keypoints[i].end());
+        if(!tile_descriptors[i].empty())
+            non_empty.push_back(tile_descriptors[i]);
+    }
+    if(!non_empty.empty())
+        cv::vconcat(non_empty, descriptors);
+
+    if(options.max_per_cell > 0)
+        bucket_keypoints(keypoints, descriptors, options.cell_size, options.max_per_cell);
+    return static_cast<int>(keypoints.size());
+}
+
+/**
+ * @function bucket_keypoints
+ */
+void bucket_keypoints( std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors, int cell_size, int max_per_cell )
+{
+    if(keypoints.empty() || cell_size < 1 || max_per_cell < 1)
+        return;
+
+    /// Keypoints of every cell, strongest first
+    std::map<std::pair<int, int>, std::vector<int> > cells;
+    for(size_t k = 0; k < keypoints.size(); ++k)
+        cells[std::make_pair(cvFloor(keypoints[k].pt.y / cell_size), cvFloor(keypoints[k].pt.x / cell_size))].push_back(static_cast<int>(k));
+
+    std::vector<int> kept;
+    for(std::map<std::pair<int, int>, std::vector<int> >::iterator cell = cells.begin(); cell != cells.end(); ++cell)
+    {
+        std::vector<int> &members = cell->second;
+        const size_t count = std::min(members.size(), static_cast<size_t>(max_per_cell));
+        std::partial_sort(members.begin(), members.begin() + count, members.end(), [&keypoints](int a, int b)
+        {
+            return keypoints[a].response > keypoints[b].response || (keypoints[a].response == keypoints[b].response && a < b);
+        });
+        kept.insert(kept.end(), members.begin(), members.begin() + count);
+    }
+    std::sort(kept.begin(), kept.end());
+
+    std::vector<cv::KeyPoint> bucketed;
+    cv::Mat bucketed_descriptors(static_cast<int>(kept.size()), descriptors.cols, descriptors.type());
+    for(size_t k = 0; k < kept.size(); ++k)
+    {
+        bucketed.push_back(keypoints[kept[k]]);
+        if(!descriptors.empty())
+            descriptors.row(kept[k]).copyTo(bucketed_descriptors.row(static_cast<int>(k)));
+    }
+    keypoints.swap(bucketed);
+    if(!descriptors.empty())
+        descriptors = bucketed_descriptors;
+}
+
+/**
+ * @function match_keypoints
+ */
+int match_keypoints( Detector type, const cv::Mat &image_template, const cv::Mat &image_full, KeypointMatches &result,
+                     const TiledDetection &tiling, const VerificationOptions &verification, const FlannOptions &flann,
+                     const QuantizationOptions &quantization, const HashingOptions &hashing )
+{
+    switch(type)
+    {
+        case DETECTOR_ORB:   return MatchingEngine<DETECTOR_ORB>(tiling, flann, quantization, hashing).run(image_template, image_full, result, verification);
+        case DETECTOR_BRISK: return MatchingEngine<DETECTOR_BRISK>(tiling, flann, quantization, hashing).run(image_template, image_full, result, verification);
+        case DETECTOR_SIFT:  return MatchingEngine<DETECTOR_SIFT>(tiling, flann, quantization, hashing).run(image_template, image_full, result, verification);
+        case DETECTOR_SURF:  return MatchingEngine<DETECTOR_SURF>(tiling, flann, quantization, hashing).run(image_template, image_full, result, verification);
+    }
+    return -1;
+}
+
+/**
+ * @function draw_matches
+ */
+void draw_matches( const cv::Mat &image_template, const cv::Mat &image_full, const KeypointMatches &result, cv::Mat &dst )
+{
+    /// Draw only "good" matches
+    cv::drawMatches( image_template, result.template_keypoints, image_full, result.full_keypoints,
+           result.good_matches, dst, cv::Scalar::all(-1), cv::Scalar::all(-1),
+           std::vector<char>(), cv::DrawMatchesFlags::NOT_DRAW_SINGLE_POINTS );
+
+    if( result.homography.empty() )
+        return;
+
+    /// Corners of the template projected in the full image, which is drawn right of the template
+    std::vector<cv::Point2f> corners(4), projected;
+    corners[1] = cv::Point2f(static_cast<float>(image_template.cols), 0.0f);
+    corners[2] = cv::Point2f(static_cast<float>(image_template.cols), static_cast<float>(image_template.rows));
+    corners[3] = cv::Point2f(0.0f, static_cast<float>(image_template.rows));
+    cv::perspectiveTransform(corners, projected, result.homography);
+    for( int i = 0; i < 4; ++i )
+    {
+        const cv::Point2f offset(static_cast<float>(image_template.cols), 0.0f);
+        cv::line( dst, projected[i] + offset, projected[(i + 1) % 4] + offset, cv::Scalar(0, 255, 0), 2 );
+    }
+}
+
+} // namespace cvdemo
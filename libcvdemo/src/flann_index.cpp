@@ -0,0 +1,286 @@
+/**
+ * FLANN Index
+ * brief approximate nearest neighbour matching with a tunable FLANN index, which can be saved and loaded again
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/flann_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+const char TRAIN_MAGIC[8] = { 'C', 'V', 'D', 'F', 'L', 'A', 'N', 'N' };
+const int TRAIN_VERSION = 1;
+
+/// Header of the train descriptors saved next to an index (<path>.train), followed by their rows: enough to tell
+/// whether the cache holds the index of a set of descriptors without reading them
+struct TrainHeader
+{
+    char magic[8];
+    int version;
+    int algorithm;
+    int trees;
+    int table_number;
+    int key_size;
+    int multi_probe_level;
+    int rows;
+    int cols;
+    int type;
+    int reserved;
+    uint64 checksum;
+};
+
+/**
+ * @function descriptors_checksum
+ * brief FNV-1a hash of the bytes of the descriptors, row by row
+ */
+uint64 descriptors_checksum( const cv::Mat &descriptors )
+{
+    uint64 hash = 14695981039346656037ULL;
+    const size_t row_bytes = descriptors.cols * descriptors.elemSize();
+    for( int r = 0; r < descriptors.rows; ++r )
+    {
+        const uchar *row = descriptors.ptr<uchar>(r);
+        for( size_t i = 0; i < row_bytes; ++i )
+            hash = (hash ^ row[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @function read_train_header
+ * brief header of the descriptors of a saved index; false if there is none
+ */
+bool read_train_header( std::istream &file, TrainHeader &header )
+{
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return file.gcount() == static_cast<std::streamsize>(sizeof(header)) &&
+           std::memcmp(header.magic, TRAIN_MAGIC, sizeof(header.magic)) == 0 && header.version == TRAIN_VERSION &&
+           header.rows > 0 && header.cols > 0 && (header.type == CV_8UC1 || header.type == CV_32FC1);
+}
+
+/**
+ * @function header_options
+ * brief parameters of the index the header was saved with
+ */
+FlannOptions header_options( const TrainHeader &header )
+{
+    FlannOptions options;
+    options.algorithm = static_cast<FlannOptions::Algorithm>(header.algorithm);
+    options.trees = header.trees;
+    options.table_number = header.table_number;
+    options.key_size = header.key_size;
+    options.multi_probe_level = header.multi_probe_level;
+    return options;
+}
+
+/**
+ * @function same_structure
+ * brief true if both options build the same index (the checks only matter for the search)
+ */
+bool same_structure( const FlannOptions &a, const FlannOptions &b )
+{
+    if( a.algorithm != b.algorithm )
+        return false;
+    if( a.algorithm == FlannOptions::KDTREE )
+        return a.trees == b.trees;
+    return a.table_number == b.table_number && a.key_size == b.key_size && a.multi_probe_level == b.multi_probe_level;
+}
+
+} // namespace
+
+/**
+ * @function parse_flann_algorithm
+ */
+bool parse_flann_algorithm( const std::string &name, FlannOptions::Algorithm &algorithm )
+{
+    std::string lower_name(name);
+    std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(), ::tolower);
+    if( lower_name == "kdtree" )
+        algorithm = FlannOptions::KDTREE;
+    else if( lower_name == "lsh" )
+        algorithm = FlannOptions::LSH;
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @function FlannIndex::create
+ */
+void FlannIndex::create()
+{
+    if( options_.algorithm == FlannOptions::LSH )
+        index_ = cv::Ptr<cv::flann::Index>(new cv::flann::Index(features_,
+                     cv::flann::LshIndexParams(options_.table_number, options_.key_size, options_.multi_probe_level),
+                     cvflann::FLANN_DIST_HAMMING));
+    else
+        index_ = cv::Ptr<cv::flann::Index>(new cv::flann::Index(features_, cv::flann::KDTreeIndexParams(options_.trees),
+                                                                 cvflann::FLANN_DIST_L2));
+}
+
+/**
+ * @function FlannIndex::build
+ */
+bool FlannIndex::build( const cv::Mat &train, const FlannOptions &options )
+{
+    index_.release();
+    if( train.empty() || !options.enabled() || (options.algorithm == FlannOptions::LSH && train.type() != CV_8UC1) )
+        return false;
+
+    options_ = options;
+    train_ = train.clone();
+    if( options_.algorithm == FlannOptions::KDTREE && train_.depth() != CV_32F )
+        train_.convertTo(features_, CV_32F);
+    else
+        features_ = train_;
+    create();
+    return true;
+}
+
+/**
+ * @function FlannIndex::save
+ */
+bool FlannIndex::save( const std::string &path ) const
+{
+    if( empty() || !train_.isContinuous() )
+        return false;
+
+    std::ofstream file((path + ".train").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if( !file.is_open() )
+        return false;
+    TrainHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, TRAIN_MAGIC, sizeof(header.magic));
+    header.version = TRAIN_VERSION;
+    header.algorithm = static_cast<int>(options_.algorithm);
+    header.trees = options_.trees;
+    header.table_number = options_.table_number;
+    header.key_size = options_.key_size;
+    header.multi_probe_level = options_.multi_probe_level;
+    header.rows = train_.rows;
+    header.cols = train_.cols;
+    header.type = train_.type();
+    header.checksum = descriptors_checksum(train_);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(train_.data), static_cast<std::streamsize>(train_.total() * train_.elemSize()));
+    file.close();
+    if( file.fail() )
+        return false;
+
+    index_->save(path);
+    return true;
+}
+
+/**
+ * @function FlannIndex::load
+ */
+bool FlannIndex::load( const std::string &path )
+{
+    index_.release();
+    std::ifstream file((path + ".train").c_str(), std::ios::in | std::ios::binary);
+    TrainHeader header;
+    if( !file.is_open() || !read_train_header(file, header) )
+        return false;
+
+    options_ = header_options(header);
+    if( !options_.enabled() || (options_.algorithm == FlannOptions::LSH && header.type != CV_8UC1) )
+        return false;
+    train_.create(header.rows, header.cols, header.type);
+    const std::streamsize bytes = static_cast<std::streamsize>(train_.total() * train_.elemSize());
+    file.read(reinterpret_cast<char*>(train_.data), bytes);
+    if( file.gcount() != bytes || descriptors_checksum(train_) != header.checksum )
+    {
+        train_.release();
+        return false;
+    }
+
+    if( options_.algorithm == FlannOptions::KDTREE && train_.depth() != CV_32F )
+        train_.convertTo(features_, CV_32F);
+    else
+        features_ = train_;
+
+    index_ = cv::Ptr<cv::flann::Index>(new cv::flann::Index());
+    if( !index_->load(features_, path) )
+    {
+        index_.release();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @function FlannIndex::knn_match
+ */
+void FlannIndex::knn_match( const cv::Mat &query, std::vector<std::vector<cv::DMatch> > &matches, int k ) const
+{
+    matches.clear();
+    if( query.empty() || empty() || k < 1 )
+        return;
+    CV_Assert( query.cols == train_.cols && query.depth() == train_.depth() );
+
+    cv::Mat features = query, indices, distances;
+    if( features_.depth() != query.depth() )
+        query.convertTo(features, features_.depth());
+    index_->knnSearch(features, indices, distances, k, cv::flann::SearchParams(options_.checks));
+
+    /// FLANN gives squared Euclidean distances, and integer Hamming distances
+    if( distances.depth() != CV_32F )
+        distances.convertTo(distances, CV_32F);
+    const bool squared = options_.algorithm == FlannOptions::KDTREE;
+
+    matches.resize(query.rows);
+    for( int q = 0; q < query.rows; ++q )
+    {
+        const int *index = indices.ptr<int>(q);
+        const float *distance = distances.ptr<float>(q);
+        for( int i = 0; i < k; ++i )
+            if( index[i] >= 0 && index[i] < train_.rows )
+                matches[q].push_back(cv::DMatch(q, index[i], squared ? std::sqrt(distance[i]) : distance[i]));
+    }
+}
+
+/**
+ * @function cached_flann_index
+ */
+bool cached_flann_index( const cv::Mat &train, const FlannOptions &options, FlannIndex &index )
+{
+    /// The header tells whether the cache holds the index of train: the saved descriptors are only read to load it
+    bool cached = false;
+    if( !options.index_path.empty() )
+    {
+        std::ifstream file((options.index_path + ".train").c_str(), std::ios::in | std::ios::binary);
+        TrainHeader header;
+        cached = file.is_open() && read_train_header(file, header);
+        if( cached && same_structure(header_options(header), options) && header.rows == train.rows &&
+            header.cols == train.cols && header.type == train.type() && header.checksum == descriptors_checksum(train) )
+        {
+            file.close();
+            if( index.load(options.index_path) )
+            {
+                index.set_checks(options.checks);
+                return true;
+            }
+        }
+    }
+
+    if( !index.build(train, options) )
+        return false;
+    if( !options.index_path.empty() && (options.update_cache || !cached) )
+        index.save(options.index_path);
+    else if( !options.index_path.empty() )
+        std::cout << "FLANN index " << options.index_path << " was built on other descriptors, kept as is." << std::endl;
+    return true;
+}
+
+} // namespace cvdemo
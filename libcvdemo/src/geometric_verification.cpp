@@ -0,0 +1,289 @@
+/**
+ * Geometric Verification
+ * brief ratio test and robust homography estimation of the matches between a template and an image
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/geometric_verification.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Correspondences of a minimal sample of a homography
+const int SAMPLE_SIZE = 4;
+/// Least squares refinements of the best hypothesis at most
+const int REFINEMENT_ROUNDS = 3;
+
+/// Closer to the best match first
+bool closer( const cv::DMatch &a, const cv::DMatch &b )
+{
+    return a.distance < b.distance;
+}
+
+/**
+ * @function collinear
+ * brief true if the three points are (almost) on a line: such samples give no homography
+ */
+inline bool collinear( const cv::Point2f &a, const cv::Point2f &b, const cv::Point2f &c )
+{
+    const double area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    return std::fabs(area) < 1e-2;
+}
+
+/**
+ * @function degenerate
+ * brief true if any three points of the sample are collinear
+ */
+bool degenerate( const cv::Point2f *points )
+{
+    for( int i = 0; i < SAMPLE_SIZE; ++i )
+        if( collinear(points[(i + 1) % SAMPLE_SIZE], points[(i + 2) % SAMPLE_SIZE], points[(i + 3) % SAMPLE_SIZE]) )
+            return true;
+    return false;
+}
+
+/**
+ * @function count_inliers
+ * brief correspondences whose reprojection error by the homography is at most the threshold
+ */
+int count_inliers( const cv::Mat &homography, const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst,
+                   double threshold, std::vector<uchar> &mask )
+{
+    const double *h = homography.ptr<double>();
+    const double squared_threshold = threshold * threshold;
+    int count = 0;
+    mask.resize(src.size());
+    for( size_t i = 0; i < src.size(); ++i )
+    {
+        const double w = h[6] * src[i].x + h[7] * src[i].y + h[8];
+        mask[i] = 0;
+        if( std::fabs(w) < DBL_EPSILON )
+            continue;
+        const double dx = (h[0] * src[i].x + h[1] * src[i].y + h[2]) / w - dst[i].x;
+        const double dy = (h[3] * src[i].x + h[4] * src[i].y + h[5]) / w - dst[i].y;
+        if( dx * dx + dy * dy <= squared_threshold )
+        {
+            mask[i] = 1;
+            ++count;
+        }
+    }
+    return count;
+}
+
+/**
+ * @function needed_iterations
+ * brief hypotheses to test so that one of them is outlier-free with the given confidence, for the inlier ratio
+ */
+int needed_iterations( double confidence, double inlier_ratio, int max_iterations )
+{
+    const double outlier_free = std::pow(inlier_ratio, SAMPLE_SIZE);
+    if( outlier_free >= 1.0 )
+        return 1;
+    if( outlier_free < DBL_EPSILON )
+        return max_iterations;
+    const double iterations = std::log(1.0 - confidence) / std::log(1.0 - outlier_free);
+    return iterations < max_iterations ? std::max(1, static_cast<int>(std::ceil(iterations))) : max_iterations;
+}
+
+/**
+ * @function prosac_iterations
+ * brief PROSAC termination: hypotheses to test given the inliers among the n best correspondences, for the n with the
+ * fewest ones. Only the n whose inliers are too many to be there by chance count (non-randomness): an outlier falls
+ * within the threshold of the model with probability beta, the inliers must exceed the binomial expectation by 3 sigma
+ */
+int prosac_iterations( const std::vector<uchar> &mask, double beta, double confidence, int min_inliers, int max_iterations )
+{
+    int iterations = max_iterations, inliers = 0;
+    for( size_t n = 0; n < mask.size(); ++n )
+    {
+        inliers += mask[n];
+        const double random = static_cast<double>(n + 1 - SAMPLE_SIZE) * beta;
+        if( n + 1 < static_cast<size_t>(SAMPLE_SIZE) || inliers < min_inliers ||
+            inliers < SAMPLE_SIZE + random + 3.0 * std::sqrt(random * (1.0 - beta)) )
+            continue;
+        iterations = std::min(iterations, needed_iterations(confidence, static_cast<double>(inliers) / (n + 1), max_iterations));
+    }
+    return iterations;
+}
+
+/**
+ * @function draw_distinct
+ * brief count distinct indices of [0, range) appended to sample after the first filled ones
+ */
+void draw_distinct( cv::RNG &rng, int range, int filled, int count, int *sample )
+{
+    for( int i = filled; i < filled + count; )
+    {
+        const int candidate = rng.uniform(0, range);
+        if( std::find(sample, sample + i, candidate) == sample + i )
+            sample[i++] = candidate;
+    }
+}
+
+} // namespace
+
+/**
+ * @function ratio_test
+ */
+void ratio_test( const std::vector<std::vector<cv::DMatch> > &knn_matches, float ratio, std::vector<cv::DMatch> &matches )
+{
+    matches.clear();
+    for( size_t q = 0; q < knn_matches.size(); ++q )
+        if( knn_matches[q].size() >= 2 && knn_matches[q][0].distance < ratio * knn_matches[q][1].distance )
+            matches.push_back(knn_matches[q][0]);
+    std::stable_sort(matches.begin(), matches.end(), closer);
+}
+
+/**
+ * @function estimate_homography
+ */
+int estimate_homography( const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, const VerificationOptions &options,
+                         cv::Mat &homography, std::vector<uchar> &inlier_mask, int *iterations )
+{
+    homography.release();
+    inlier_mask.assign(src.size(), 0);
+    if( iterations )
+        *iterations = 0;
+    const int N = static_cast<int>(src.size());
+    if( N < SAMPLE_SIZE || dst.size() != src.size() )
+        return 0;
+
+    /// Fixed seed: the same matches give the same homography
+    cv::RNG rng(0x5eed);
+    std::vector<uchar> mask;
+    cv::Mat best;
+    int best_count = 0;
+    int limit = std::max(1, options.max_iterations);
+
+    /// Chance of an outlier to be consistent with a model: the area within the threshold over the area of dst
+    const cv::Rect bounds = cv::boundingRect(dst);
+    const double beta = std::min(1.0, CV_PI * options.threshold * options.threshold / std::max(1.0, static_cast<double>(bounds.area())));
+
+    /// PROSAC growth of the sampled set (Chum and Matas): T_n expected samples drawn from the n best correspondences
+    double T_n = limit;
+    for( int i = 0; i < SAMPLE_SIZE; ++i )
+        T_n *= static_cast<double>(SAMPLE_SIZE - i) / (N - i);
+    int T_n_prime = 1, n = SAMPLE_SIZE;
+
+    int iteration = 0;
+    for( ; iteration < limit; ++iteration )
+    {
+        int sample[SAMPLE_SIZE];
+        if( options.prosac )
+        {
+            const int t = iteration + 1;
+            if( t > T_n_prime && n < N )
+            {
+                const double T_n_next = T_n * (n + 1) / (n + 1 - SAMPLE_SIZE);
+                ++n;
+                T_n_prime += static_cast<int>(std::ceil(T_n_next - T_n));
+                T_n = T_n_next;
+            }
+            /// The n-th correspondence with three of the better ones, until all the samples of the n best are expected
+            if( T_n_prime < t )
+                draw_distinct(rng, n, 0, SAMPLE_SIZE, sample);
+            else
+            {
+                draw_distinct(rng, n - 1, 0, SAMPLE_SIZE - 1, sample);
+                sample[SAMPLE_SIZE - 1] = n - 1;
+            }
+        }
+        else
+            draw_distinct(rng, N, 0, SAMPLE_SIZE, sample);
+
+        cv::Point2f sample_src[SAMPLE_SIZE], sample_dst[SAMPLE_SIZE];
+        for( int i = 0; i < SAMPLE_SIZE; ++i )
+        {
+            sample_src[i] = src[sample[i]];
+            sample_dst[i] = dst[sample[i]];
+        }
+        if( degenerate(sample_src) || degenerate(sample_dst) )
+            continue;
+
+        const cv::Mat hypothesis = cv::getPerspectiveTransform(sample_src, sample_dst);
+        if( hypothesis.empty() )
+            continue;
+
+        const int count = count_inliers(hypothesis, src, dst, options.threshold, mask);
+        if( count > best_count )
+        {
+            best_count = count;
+            best = hypothesis;
+            inlier_mask.swap(mask);
+            limit = std::min(limit, needed_iterations(options.confidence, static_cast<double>(count) / N, options.max_iterations));
+            if( options.prosac )
+                limit = std::min(limit, prosac_iterations(inlier_mask, beta, options.confidence,
+                                                          std::max(SAMPLE_SIZE, options.min_inliers), options.max_iterations));
+        }
+    }
+    if( iterations )
+        *iterations = iteration;
+
+    if( best_count < std::max(SAMPLE_SIZE, options.min_inliers) )
+    {
+        inlier_mask.assign(src.size(), 0);
+        return 0;
+    }
+
+    /// Least squares refinement on all the inliers, repeated while it gains inliers: an early terminated search
+    /// may stop on a hypothesis close to the model which misses some of them
+    for( int round = 0; round < REFINEMENT_ROUNDS; ++round )
+    {
+        std::vector<cv::Point2f> inlier_src, inlier_dst;
+        for( int i = 0; i < N; ++i )
+            if( inlier_mask[i] )
+            {
+                inlier_src.push_back(src[i]);
+                inlier_dst.push_back(dst[i]);
+            }
+        const cv::Mat refined = cv::findHomography(inlier_src, inlier_dst, 0);
+        if( refined.empty() )
+            break;
+        const int count = count_inliers(refined, src, dst, options.threshold, mask);
+        if( count < best_count )
+            break;
+        const bool gained = count > best_count;
+        best_count = count;
+        best = refined;
+        inlier_mask.swap(mask);
+        if( !gained )
+            break;
+    }
+
+    homography = best;
+    return best_count;
+}
+
+/**
+ * @function estimate_homography
+ */
+int estimate_homography( const std::vector<cv::KeyPoint> &query_keypoints, const std::vector<cv::KeyPoint> &train_keypoints,
+                         const std::vector<cv::DMatch> &matches, const VerificationOptions &options, Verification &result )
+{
+    std::vector<cv::Point2f> src, dst;
+    for( size_t i = 0; i < matches.size(); ++i )
+    {
+        src.push_back(query_keypoints[matches[i].queryIdx].pt);
+        dst.push_back(train_keypoints[matches[i].trainIdx].pt);
+    }
+
+    std::vector<uchar> mask;
+    const int count = estimate_homography(src, dst, options, result.homography, mask, &result.iterations);
+
+    result.inliers.clear();
+    for( size_t i = 0; i < matches.size(); ++i )
+        if( mask[i] )
+            result.inliers.push_back(matches[i]);
+    return count;
+}
+
+} // namespace cvdemo
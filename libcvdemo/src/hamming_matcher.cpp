@@ -0,0 +1,216 @@
+/**
+ * Hamming Matcher
+ * brief brute force matching of binary descriptors (ORB, BRISK) with SIMD popcount kernels
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/hamming_matcher.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#if (defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Queries sharing a pass over a block of train descriptors: their descriptors and results stay in L1
+const int QUERY_BLOCK = 64;
+/// Bytes of train descriptors compared by a query block at a time, sized for L2
+const int TRAIN_BLOCK_BYTES = 128 * 1024;
+
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+
+/// 256 bits: the lower half of a 512 bit register, one VPOPCNTQ
+inline int distance_32( const uchar *a, const uchar *b )
+{
+    const __m512i x = _mm512_maskz_loadu_epi64(0x0F, a);
+    const __m512i y = _mm512_maskz_loadu_epi64(0x0F, b);
+    return static_cast<int>(_mm512_reduce_add_epi64(_mm512_popcnt_epi64(_mm512_xor_si512(x, y))));
+}
+
+inline int distance_64( const uchar *a, const uchar *b )
+{
+    const __m512i x = _mm512_loadu_si512(a);
+    const __m512i y = _mm512_loadu_si512(b);
+    return static_cast<int>(_mm512_reduce_add_epi64(_mm512_popcnt_epi64(_mm512_xor_si512(x, y))));
+}
+
+#elif defined(__AVX2__)
+
+/// Bits set in every byte, with a 4 bit lookup table per nibble (PSHUFB)
+inline __m256i popcount_bytes( __m256i value )
+{
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    const __m256i low = _mm256_and_si256(value, low_mask);
+    const __m256i high = _mm256_and_si256(_mm256_srli_epi16(value, 4), low_mask);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lut, low), _mm256_shuffle_epi8(lut, high));
+}
+
+/// Sum of the 32 byte counts
+inline int sum_bytes( __m256i counts )
+{
+    const __m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+    const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    return static_cast<int>(_mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1));
+}
+
+inline int distance_32( const uchar *a, const uchar *b )
+{
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    return sum_bytes(popcount_bytes(_mm256_xor_si256(x, y)));
+}
+
+/// The byte counts of both halves (at most 16) are added before the horizontal sum
+inline int distance_64( const uchar *a, const uchar *b )
+{
+    const __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    const __m256i y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    const __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + 32));
+    const __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 32));
+    return sum_bytes(_mm256_add_epi8(popcount_bytes(_mm256_xor_si256(x0, y0)), popcount_bytes(_mm256_xor_si256(x1, y1))));
+}
+
+#else
+
+inline int distance_32( const uchar *a, const uchar *b ) { return hamming_distance(a, b, 32); }
+inline int distance_64( const uchar *a, const uchar *b ) { return hamming_distance(a, b, 64); }
+
+#endif
+
+/// Kernels as types, so that the matching loop is compiled once per kernel with the distance inlined
+struct Distance32 { static int distance( const uchar *a, const uchar *b, int ) { return distance_32(a, b); } };
+struct Distance64 { static int distance( const uchar *a, const uchar *b, int ) { return distance_64(a, b); } };
+struct DistanceAny { static int distance( const uchar *a, const uchar *b, int bytes ) { return hamming_distance(a, b, bytes); } };
+
+/**
+ * k nearest neighbours of the query blocks of a range: every block walks the train descriptors block by block,
+ * keeping the k best distances of each of its queries sorted in its rows of distances/indices
+ */
+template<typename Kernel>
+class KnnBody : public cv::ParallelLoopBody
+{
+public:
+    KnnBody( const cv::Mat &query, const cv::Mat &train, int k, cv::Mat &distances, cv::Mat &indices )
+        : query_(query), train_(train), k_(k), distances_(distances), indices_(indices) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        const int bytes = query_.cols;
+        const int train_block = std::max(256, TRAIN_BLOCK_BYTES / std::max(1, bytes));
+        for( int block = range.start; block < range.end; ++block )
+        {
+            const int q0 = block * QUERY_BLOCK;
+            const int q1 = std::min(query_.rows, q0 + QUERY_BLOCK);
+            distances_.rowRange(q0, q1).setTo(cv::Scalar::all(INT_MAX));
+            indices_.rowRange(q0, q1).setTo(cv::Scalar::all(-1));
+
+            for( int t0 = 0; t0 < train_.rows; t0 += train_block )
+            {
+                const int t1 = std::min(train_.rows, t0 + train_block);
+                for( int q = q0; q < q1; ++q )
+                {
+                    const uchar *descriptor = query_.ptr<uchar>(q);
+                    int *best = distances_.ptr<int>(q);
+                    int *best_index = indices_.ptr<int>(q);
+                    int worst = best[k_ - 1];
+                    for( int t = t0; t < t1; ++t )
+                    {
+                        const int distance = Kernel::distance(descriptor, train_.ptr<uchar>(t), bytes);
+                        if( distance >= worst )
+                            continue;
+
+                        /// Insertion after the equal distances, which come from earlier train descriptors
+                        int p = k_ - 1;
+                        for( ; p > 0 && best[p - 1] > distance; --p )
+                        {
+                            best[p] = best[p - 1];
+                            best_index[p] = best_index[p - 1];
+                        }
+                        best[p] = distance;
+                        best_index[p] = t;
+                        worst = best[k_ - 1];
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    const cv::Mat &query_;
+    const cv::Mat &train_;
+    int k_;
+    cv::Mat &distances_;
+    cv::Mat &indices_;
+};
+
+} // namespace
+
+/**
+ * @function hamming_kernel_name
+ */
+const char* hamming_kernel_name()
+{
+    #if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+    return "AVX-512 VPOPCNTDQ";
+    #elif defined(__AVX2__)
+    return "AVX2";
+    #elif defined(__GNUC__) && defined(__POPCNT__)
+    return "POPCNT";
+    #else
+    return "portable";
+    #endif
+}
+
+/**
+ * @function hamming_knn_match
+ */
+void hamming_knn_match( const cv::Mat &query, const cv::Mat &train, std::vector<std::vector<cv::DMatch> > &matches, int k )
+{
+    matches.clear();
+    if( query.empty() || train.empty() || k < 1 )
+        return;
+    CV_Assert( query.type() == CV_8UC1 && train.type() == CV_8UC1 && query.cols == train.cols );
+
+    cv::Mat distances(query.rows, k, CV_32SC1), indices(query.rows, k, CV_32SC1);
+    const cv::Range blocks(0, (query.rows + QUERY_BLOCK - 1) / QUERY_BLOCK);
+    if( query.cols == 32 )
+        cv::parallel_for_(blocks, KnnBody<Distance32>(query, train, k, distances, indices));
+    else if( query.cols == 64 )
+        cv::parallel_for_(blocks, KnnBody<Distance64>(query, train, k, distances, indices));
+    else
+        cv::parallel_for_(blocks, KnnBody<DistanceAny>(query, train, k, distances, indices));
+
+    matches.resize(query.rows);
+    for( int q = 0; q < query.rows; ++q )
+    {
+        const int *best = distances.ptr<int>(q);
+        const int *best_index = indices.ptr<int>(q);
+        matches[q].clear();
+        for( int i = 0; i < k && best_index[i] >= 0; ++i )
+            matches[q].push_back(cv::DMatch(q, best_index[i], static_cast<float>(best[i])));
+    }
+}
+
+/**
+ * @function hamming_match
+ */
+void hamming_match( const cv::Mat &query, const cv::Mat &train, std::vector<cv::DMatch> &matches )
+{
+    std::vector<std::vector<cv::DMatch> > knn_matches;
+    hamming_knn_match(query, train, knn_matches, 1);
+
+    matches.clear();
+    for( size_t q = 0; q < knn_matches.size(); ++q )
+        matches.push_back(knn_matches[q][0]);
+}
+
+} // namespace cvdemo
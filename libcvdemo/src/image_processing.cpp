@@ -0,0 +1,530 @@
+/**
+ * Image Processing
+ * brief edges, gradients, histograms and watershed segmentation used by the image_processing demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/image_processing.hpp"
+#include "cvdemo/basic_operations.hpp"
+#include "cvdemo/buffer_cache.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/**
+ * @function adjust_brightness_contrast
+ * brief brightness_contrast with the grayscale buffer given by the caller
+ */
+void adjust_brightness_contrast( const cv::Mat &src, cv::Mat &gray, cv::Mat &dst, int brightness, int contrast )
+{
+    /*
+     * The algorithm is by Werner D. Streidt
+     * (http://visca.com/ffactory/archives/5-99/msg00021.html)
+     */
+    double a, b;
+    if( contrast > 0 )
+    {
+        double delta = 127.*contrast/100;
+        a = 255./(255. - delta*2);
+        b = a*(brightness - delta);
+    }
+    else
+    {
+        double delta = -128.*contrast/100;
+        a = (256.-delta*2)/255.;
+        b = a*brightness + delta;
+    }
+
+    to_gray(src, gray);
+    gray.convertTo(dst, CV_8U, a, b);
+}
+
+/**
+ * @function draw_histogram
+ * brief histogram_image with the histogram buffer given by the caller
+ */
+void draw_histogram( const cv::Mat &gray, cv::Mat &hist, cv::Mat &hist_image, int hist_size )
+{
+    /// Compute histograms
+    cv::calcHist(&gray, 1, 0, cv::Mat(), hist, 1, &hist_size, 0);
+    /// Init the target image with white color, reusing its memory
+    hist_image.create(200, 320, CV_8U);
+    hist_image.setTo(cv::Scalar::all(255));
+    /// Normalize the histograms to be as big as hist_image rows
+    cv::normalize(hist, hist, 0, hist_image.rows, cv::NORM_MINMAX, CV_32F);
+    /// Approximate the values to next integer
+    int binW = cvRound((double)hist_image.cols/hist_size);
+    /// Draw the histogram as a series of rectangles
+    for( int i = 0; i < hist_size; ++i )
+        cv::rectangle( hist_image, cv::Point(i*binW, hist_image.rows),
+                   cv::Point((i+1)*binW, hist_image.rows - cvRound(hist.at<float>(i))),
+                   cv::Scalar::all(0), -1, 8, 0 );
+}
+
+/// Rows reached by the opening (2+2 iterations of 3x3) and by the background dilation (3 iterations)
+const int OPENING_HALO = 4;
+const int BACKGROUND_HALO = 3;
+/// Rows reached by a distance of 255: every step of the chamfer distance costs at least 1 per row
+const int DISTANCE_HALO = 256;
+
+/**
+ * @function distance_transform
+ * brief distance transform of the watershed foreground
+ */
+void distance_transform( const cv::Mat &binary, cv::Mat &distance )
+{
+    #ifdef OPENCV_NEW
+    cv::distanceTransform(binary, distance, cv::DIST_L2, 5);
+    #else
+    cv::distanceTransform(binary, distance, CV_DIST_L1, 5);
+    #endif
+}
+
+/**
+ * Marker shift and unknown region, on a range of rows: the inner loop is a plain select over
+ * contiguous rows, which the compiler vectorizes
+ */
+class MarkUnknownBody : public cv::ParallelLoopBody
+{
+public:
+    MarkUnknownBody( cv::Mat &markers, const cv::Mat &unknown ) : markers_(markers), unknown_(unknown) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        for(int y = range.start; y < range.end; ++y)
+        {
+            int *labels = markers_.ptr<int>(y);
+            const uchar *unknown = unknown_.ptr<uchar>(y);
+            for(int x = 0; x < markers_.cols; ++x)
+                labels[x] = unknown[x] == 255 ? 0 : labels[x] + 1;
+        }
+    }
+
+private:
+    cv::Mat &markers_;
+    const cv::Mat &unknown_;
+};
+
+/**
+ * Marker shift and unknown region on a range of bands, with the background dilated from the binary image band by band:
+ * the unknown region is the background outside of the foreground
+ */
+class MarkUnknownFusedBody : public cv::ParallelLoopBody
+{
+public:
+    MarkUnknownFusedBody( cv::Mat &markers, const cv::Mat &binary, const cv::Mat &foreground, int band_rows )
+        : markers_(markers), binary_(binary), foreground_(foreground), band_rows_(band_rows) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        const int rows = markers_.rows;
+        cv::Mat background_band;
+        for(int band = range.start; band < range.end; ++band)
+        {
+            const int y0 = band * band_rows_;
+            const int y1 = std::min(rows, y0 + band_rows_);
+            const int top = std::max(0, y0 - BACKGROUND_HALO);
+            dilate_rect(binary_.rowRange(top, std::min(rows, y1 + BACKGROUND_HALO)), background_band, 3);
+
+            for(int y = y0; y < y1; ++y)
+            {
+                int *labels = markers_.ptr<int>(y);
+                const uchar *background = background_band.ptr<uchar>(y - top);
+                const uchar *foreground = foreground_.ptr<uchar>(y);
+                for(int x = 0; x < markers_.cols; ++x)
+                    labels[x] = (background[x] & ~foreground[x]) == 255 ? 0 : labels[x] + 1;
+            }
+        }
+    }
+
+private:
+    cv::Mat &markers_;
+    const cv::Mat &binary_;
+    const cv::Mat &foreground_;
+    const int band_rows_;
+};
+
+/**
+ * Colorization of a range of rows through a lookup table indexed by label + 1:
+ * boundaries (-1) and background (0) are the first two entries, every label outside of the table is black
+ */
+class ColorizeBody : public cv::ParallelLoopBody
+{
+public:
+    ColorizeBody( const cv::Mat &markers, const std::vector<cv::Vec3b> &lut, cv::Mat &dst ) : markers_(markers), lut_(lut), dst_(dst) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        const unsigned int lut_size = static_cast<unsigned int>(lut_.size());
+        const cv::Vec3b black(0, 0, 0);
+        for(int y = range.start; y < range.end; ++y)
+        {
+            const int *labels = markers_.ptr<int>(y);
+            cv::Vec3b *out = dst_.ptr<cv::Vec3b>(y);
+            for(int x = 0; x < markers_.cols; ++x)
+            {
+                /// Labels below -1 wrap around to huge indices, so a single comparison checks both ends
+                const unsigned int index = static_cast<unsigned int>(labels[x] + 1);
+                out[x] = index < lut_size ? lut_[index] : black;
+            }
+        }
+    }
+
+private:
+    const cv::Mat &markers_;
+    const std::vector<cv::Vec3b> &lut_;
+    cv::Mat &dst_;
+};
+
+} // namespace
+
+/**
+ * @function canny
+ */
+void canny( const cv::Mat &src, cv::Mat &edges, double min_threshold, double max_threshold )
+{
+    cv::Canny(src, edges, min_threshold, max_threshold);
+}
+
+/**
+ * @function gradient
+ */
+void gradient( const cv::Mat &src_gray, cv::Mat &dst, Gradient type )
+{
+    switch(type)
+    {
+        case SOBEL_X:   cv::Sobel(src_gray, dst, CV_64F, 1, 0, 5);  break;
+        case SOBEL_Y:   cv::Sobel(src_gray, dst, CV_64F, 0, 1, 5);  break;
+        case SCHARR_X:  cv::Scharr(src_gray, dst, CV_64F, 1, 0, 5); break;
+        case SCHARR_Y:  cv::Scharr(src_gray, dst, CV_64F, 0, 1, 5); break;
+        case LAPLACIAN: cv::Laplacian(src_gray, dst, CV_64F);       break;
+        case SOBEL_XY:
+        {
+            cv::Mat sobel_x, sobel_y;
+            cv::Sobel(src_gray, sobel_x, CV_64F, 1, 0, 5);
+            cv::Sobel(src_gray, sobel_y, CV_64F, 0, 1, 5);
+            cv::bitwise_and(sobel_x, sobel_y, dst);
+            break;
+        }
+    }
+}
+
+/**
+ * @function brightness_contrast
+ */
+void brightness_contrast( const cv::Mat &src, cv::Mat &dst, int brightness, int contrast )
+{
+    cv::Mat gray;
+    adjust_brightness_contrast(src, gray, dst, brightness, contrast);
+}
+
+/**
+ * @function brightness_contrast
+ */
+void brightness_contrast( const cv::Mat &src, cv::Mat &dst, int brightness, int contrast, BufferCache &cache )
+{
+    adjust_brightness_contrast(src, cache.buffer("brightness_contrast.gray"), dst, brightness, contrast);
+}
+
+/**
+ * @function histogram_image
+ */
+void histogram_image( const cv::Mat &gray, cv::Mat &hist_image, int hist_size )
+{
+    cv::Mat hist;
+    draw_histogram(gray, hist, hist_image, hist_size);
+}
+
+/**
+ * @function histogram_image
+ */
+void histogram_image( const cv::Mat &gray, cv::Mat &hist_image, BufferCache &cache, int hist_size )
+{
+    draw_histogram(gray, cache.buffer("histogram_image.hist"), hist_image, hist_size);
+}
+
+/**
+ * @function otsu_threshold
+ */
+int otsu_threshold( const size_t histogram[256], size_t total )
+{
+    const double scale = 1.0 / total;
+    double mu = 0.0;
+    for( int i = 0; i < 256; ++i )
+        mu += i * static_cast<double>(histogram[i]);
+    mu *= scale;
+
+    double mu1 = 0.0, q1 = 0.0, max_sigma = 0.0;
+    int threshold = 0;
+    for( int i = 0; i < 256; ++i )
+    {
+        double p_i = histogram[i] * scale;
+        mu1 *= q1;
+        q1 += p_i;
+        double q2 = 1.0 - q1;
+        if( std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1.0 - FLT_EPSILON )
+            continue;
+
+        mu1 = (mu1 + i*p_i) / q1;
+        double mu2 = (mu - q1*mu1) / q2;
+        double sigma = q1*q2*(mu1 - mu2)*(mu1 - mu2);
+        if( sigma > max_sigma )
+        {
+            max_sigma = sigma;
+            threshold = i;
+        }
+    }
+    return threshold;
+}
+
+/**
+ * @function watershed
+ */
+void watershed( const cv::Mat &src, WatershedStages &stages, int band_rows )
+{
+    if(band_rows > 0)
+        watershed_preprocess_fused(src, stages, band_rows);
+    else
+        watershed_preprocess(src, stages);
+    watershed_segment(src, stages);
+}
+
+/**
+ * @function watershed_preprocess
+ */
+void watershed_preprocess( const cv::Mat &src, WatershedStages &stages )
+{
+    /// Performs grayscale conversion
+    cv::Mat src_gray;
+    to_gray(src, src_gray);
+
+    /// Performs the thresholding step
+    cv::threshold(src_gray, stages.binary, 0, 255, cv::THRESH_BINARY_INV+cv::THRESH_OTSU);
+
+    /// Remove noise - image opening
+    cv::Mat kernel = cv::Mat::ones(3,3,CV_8UC1);
+    cv::morphologyEx(stages.binary, stages.binary, cv::MORPH_OPEN, kernel, cv::Point(-1,-1), 2);
+
+    /// Perform dilation to extract background
+    cv::dilate(stages.binary, stages.background, kernel, cv::Point(-1,-1), 3);
+
+    /// Finding foreground area
+    distance_transform(stages.binary, stages.distance);
+
+    /// Thresholding the foreground
+    double min_val = 0.0, max_val = 0.0;
+    cv::minMaxIdx(stages.distance, &min_val, &max_val); //find the max and min value in the image
+    stages.distance.convertTo(stages.foreground, CV_8UC1); //reconvert to unsigned int values
+    cv::threshold(stages.foreground, stages.foreground, 0.7*max_val, 255, cv::THRESH_BINARY_INV+cv::THRESH_OTSU);
+
+    /// Perform Image subtraction to find unknown region
+    cv::subtract(stages.background, stages.foreground, stages.unknown);
+}
+
+/**
+ * @function watershed_preprocess_fused
+ */
+void watershed_preprocess_fused( const cv::Mat &src, WatershedStages &stages, int band_rows, int binary_threshold,
+                                 int foreground_threshold )
+{
+    watershed_binary(src, stages.binary, band_rows, binary_threshold);
+
+    /// Distance converted to 8 bit in the foreground image, then thresholded in place
+    distance_transform_banded(stages.binary, stages.foreground, std::max(band_rows, 1024));
+    if(foreground_threshold < 0)
+    {
+        size_t histogram[256] = { 0 };
+        distance_histogram(stages.foreground, histogram);
+        foreground_threshold = otsu_threshold(histogram, src.total());
+    }
+    cv::threshold(stages.foreground, stages.foreground, foreground_threshold, 255, cv::THRESH_BINARY_INV);
+
+    if(stages.keep_intermediate)
+    {
+        dilate_rect(stages.binary, stages.background, 3);
+        distance_transform(stages.binary, stages.distance);
+        cv::subtract(stages.background, stages.foreground, stages.unknown);
+    }
+    else
+    {
+        stages.background.release();
+        stages.distance.release();
+        stages.unknown.release();
+    }
+}
+
+/**
+ * @function watershed_binary
+ */
+void watershed_binary( const cv::Mat &src, cv::Mat &binary, int band_rows, int binary_threshold )
+{
+    band_rows = std::max(1, band_rows);
+    const int rows = src.rows;
+    cv::Mat gray_band, binary_band, opened_band;
+
+    /// Histogram of the grayscale image for the Otsu threshold, band by band
+    size_t histogram[256] = { 0 };
+    for(int y0 = 0; y0 < rows && binary_threshold < 0; y0 += band_rows)
+    {
+        to_gray(src.rowRange(y0, std::min(rows, y0 + band_rows)), gray_band);
+        for(int y = 0; y < gray_band.rows; ++y)
+        {
+            const uchar *row = gray_band.ptr<uchar>(y);
+            for(int x = 0; x < gray_band.cols; ++x)
+                ++histogram[row[x]];
+        }
+    }
+    if(binary_threshold < 0)
+        binary_threshold = otsu_threshold(histogram, src.total());
+
+    /// Threshold and opening streamed through the bands: every band is computed with the rows reached by the
+    /// opening above and below it, which are dropped afterwards
+    binary.create(src.size(), CV_8UC1);
+    for(int y0 = 0; y0 < rows; y0 += band_rows)
+    {
+        const int y1 = std::min(rows, y0 + band_rows);
+        const int top = std::max(0, y0 - OPENING_HALO);
+        const int bottom = std::min(rows, y1 + OPENING_HALO);
+
+        to_gray(src.rowRange(top, bottom), gray_band);
+        cv::threshold(gray_band, binary_band, binary_threshold, 255, cv::THRESH_BINARY_INV);
+        /// 2 iterations of a 3x3 rectangle are a 5x5 rectangle
+        erode_rect(binary_band, opened_band, 2);
+        dilate_rect(opened_band, opened_band, 2);
+
+        opened_band.rowRange(y0 - top, y1 - top).copyTo(binary.rowRange(y0, y1));
+    }
+}
+
+/**
+ * @function distance_transform_banded
+ */
+void distance_transform_banded( const cv::Mat &binary, cv::Mat &distance, int band_rows )
+{
+    band_rows = std::max(1, band_rows);
+    const int rows = binary.rows;
+    cv::Mat distance_band;
+
+    /// Pixels beyond the band are at least at DISTANCE_HALO, converted to 255 as the true distance
+    distance.create(binary.size(), CV_8UC1);
+    for(int y0 = 0; y0 < rows; y0 += band_rows)
+    {
+        const int y1 = std::min(rows, y0 + band_rows);
+        const int top = std::max(0, y0 - DISTANCE_HALO);
+        distance_transform(binary.rowRange(top, std::min(rows, y1 + DISTANCE_HALO)), distance_band);
+        cv::Mat rows_band = distance.rowRange(y0, y1);
+        distance_band.rowRange(y0 - top, y1 - top).convertTo(rows_band, CV_8U);
+    }
+}
+
+/**
+ * @function distance_histogram
+ */
+void distance_histogram( const cv::Mat &distance, size_t histogram[256] )
+{
+    for(int y = 0; y < distance.rows; ++y)
+    {
+        if(distance.depth() == CV_8U)
+        {
+            const uchar *row = distance.ptr<uchar>(y);
+            for(int x = 0; x < distance.cols; ++x)
+                ++histogram[row[x]];
+            continue;
+        }
+        const float *row = distance.ptr<float>(y);
+        for(int x = 0; x < distance.cols; ++x)
+            ++histogram[cv::saturate_cast<uchar>(row[x])];
+    }
+}
+
+/**
+ * @function watershed_segment
+ */
+void watershed_segment( const cv::Mat &src, WatershedStages &stages )
+{
+    /// Marker labelling
+    cv::Mat &markers = stages.markers;
+    int num_components = label_markers(stages.foreground, markers);
+
+    /// Add 1 to all labels so that sure foreground is not 0, but 1, and mark the region of unknown with zero
+    if(stages.unknown.empty())
+        mark_unknown_fused(markers, stages.binary, stages.foreground);
+    else
+        mark_unknown(markers, stages.unknown);
+
+    /// Run the Watershed algorithm
+    cv::watershed(src, markers);
+
+    stages.num_components = num_components;
+    colorize_markers(markers, num_components, stages.segmentation);
+}
+
+/**
+ * @function label_markers
+ */
+int label_markers( const cv::Mat &foreground, cv::Mat &markers )
+{
+    return label_components(foreground, markers, 8);
+}
+
+/**
+ * @function mark_unknown
+ */
+void mark_unknown( cv::Mat &markers, const cv::Mat &unknown )
+{
+    cv::parallel_for_(cv::Range(0, markers.rows), MarkUnknownBody(markers, unknown));
+}
+
+/**
+ * @function mark_unknown_fused
+ */
+void mark_unknown_fused( cv::Mat &markers, const cv::Mat &binary, const cv::Mat &foreground, int band_rows )
+{
+    band_rows = std::max(1, band_rows);
+    const int bands = (markers.rows + band_rows - 1) / band_rows;
+    cv::parallel_for_(cv::Range(0, bands), MarkUnknownFusedBody(markers, binary, foreground, band_rows));
+}
+
+/**
+ * @function colorize_markers
+ */
+void colorize_markers( const cv::Mat &markers, int num_components, cv::Mat &dst )
+{
+    /// Paint the Watershed image
+    std::vector<cv::Vec3b> colorTab;
+    for(int i = 0; i < num_components; ++i)
+    {
+        int b = cv::theRNG().uniform(0, 255);
+        int g = cv::theRNG().uniform(0, 255);
+        int r = cv::theRNG().uniform(0, 255);
+
+        colorTab.push_back(cv::Vec3b((uchar)b, (uchar)g, (uchar)r));
+    }
+
+    colorize_markers(markers, colorTab, dst);
+}
+
+/**
+ * @function colorize_markers
+ */
+void colorize_markers( const cv::Mat &markers, const std::vector<cv::Vec3b> &colors, cv::Mat &dst )
+{
+    std::vector<cv::Vec3b> lut;
+    lut.reserve(colors.size() + 2);
+    lut.push_back(cv::Vec3b(255, 255, 255));   /// -1: boundaries
+    lut.push_back(cv::Vec3b(0, 0, 0));         /// 0: not labelled
+    lut.insert(lut.end(), colors.begin(), colors.end());
+
+    dst.create(markers.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, markers.rows), ColorizeBody(markers, lut, dst));
+}
+
+} // namespace cvdemo
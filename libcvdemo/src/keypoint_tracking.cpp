@@ -0,0 +1,264 @@
+/**
+ * Keypoint Tracking
+ * brief location of a template in a video: keypoints detected and matched on keyframes only, tracked with
+ * pyramidal Lucas-Kanade optical flow in the frames between them
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/keypoint_tracking.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+#include "cvdemo/matching_engine.hpp"
+
+/// Defines depending of OpenCV version installed (2.4.x or 3.x)
+#ifdef OPENCV_OLD	/// 2.4.x version
+const int GRAY_CONV = CV_BGR2GRAY;
+#else				/// 3.x - github version
+const int GRAY_CONV = cv::COLOR_BGR2GRAY;
+#endif
+
+namespace cvdemo
+{
+
+/**
+ * Description and matching of the keyframes of a tracker, for the detector chosen at run time: the tracker keeps one
+ * instance, hence one MatchingEngine and one detector, for all its keyframes
+ */
+class KeyframeMatcher
+{
+public:
+    virtual ~KeyframeMatcher() {}
+
+    virtual bool available() const = 0;
+
+    virtual size_t describe( const cv::Mat &image, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors ) const = 0;
+
+    virtual int match_and_verify( const std::vector<cv::KeyPoint> &template_keypoints, const cv::Mat &template_descriptors,
+                                  const std::vector<cv::KeyPoint> &frame_keypoints, const cv::Mat &frame_descriptors,
+                                  std::vector<cv::DMatch> &matches, Verification &verified,
+                                  const VerificationOptions &verification ) const = 0;
+};
+
+namespace
+{
+
+/// KeyframeMatcher with the MatchingEngine of detector D
+template<Detector D>
+class KeyframeEngine : public KeyframeMatcher
+{
+public:
+    explicit KeyframeEngine( const TiledDetection &tiling ) : engine_(tiling) {}
+
+    bool available() const { return engine_.available(); }
+
+    size_t describe( const cv::Mat &image, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors ) const
+    {
+        return engine_.describe(image, keypoints, descriptors);
+    }
+
+    int match_and_verify( const std::vector<cv::KeyPoint> &template_keypoints, const cv::Mat &template_descriptors,
+                          const std::vector<cv::KeyPoint> &frame_keypoints, const cv::Mat &frame_descriptors,
+                          std::vector<cv::DMatch> &matches, Verification &verified,
+                          const VerificationOptions &verification ) const
+    {
+        return engine_.match_and_verify(template_keypoints, template_descriptors, frame_keypoints, frame_descriptors,
+                                        matches, verified, verification);
+    }
+
+private:
+    MatchingEngine<D> engine_;
+};
+
+/**
+ * @function create_keyframe_matcher
+ * brief the KeyframeMatcher of the detector, owned by the caller
+ */
+KeyframeMatcher* create_keyframe_matcher( Detector type, const TiledDetection &tiling )
+{
+    switch(type)
+    {
+        case DETECTOR_ORB:   return new KeyframeEngine<DETECTOR_ORB>(tiling);
+        case DETECTOR_BRISK: return new KeyframeEngine<DETECTOR_BRISK>(tiling);
+        case DETECTOR_SIFT:  return new KeyframeEngine<DETECTOR_SIFT>(tiling);
+        case DETECTOR_SURF:  return new KeyframeEngine<DETECTOR_SURF>(tiling);
+    }
+    return 0;
+}
+
+} // namespace
+
+/**
+ * @function TemplateTracker
+ */
+TemplateTracker::TemplateTracker( Detector type, const TrackingOptions &options, const TiledDetection &tiling,
+                                  const VerificationOptions &verification )
+    : type_(type), options_(options), tiling_(tiling), verification_(verification), matcher_(0), since_keyframe_(0), keyframes_(0)
+{
+}
+
+/**
+ * @function ~TemplateTracker
+ */
+TemplateTracker::~TemplateTracker()
+{
+    delete matcher_;
+}
+
+/**
+ * @function TemplateTracker::set_template
+ */
+bool TemplateTracker::set_template( const cv::Mat &image_template )
+{
+    reset();
+    template_keypoints_.clear();
+    template_descriptors_.release();
+    if( !matcher_ )
+        matcher_ = create_keyframe_matcher(type_, tiling_);
+    return matcher_ && matcher_->available() &&
+           matcher_->describe(image_template, template_keypoints_, template_descriptors_) > 0;
+}
+
+/**
+ * @function TemplateTracker::track
+ */
+int TemplateTracker::track( const cv::Mat &frame, TrackedFrame &result )
+{
+    if( template_descriptors_.empty() )
+        return -1;
+    const int64 start = cv::getTickCount();
+    result = TrackedFrame();
+
+    cv::Mat gray = frame;
+    if( frame.channels() == 3 )
+        cv::cvtColor(frame, gray, GRAY_CONV);
+
+    if( options_.enabled )
+    {
+        /// The pyramid of the previous frame is kept, its buffers are reused by the next one
+        previous_pyramid_.swap(pyramid_);
+        const cv::Size window(options_.window_size, options_.window_size);
+        cv::buildOpticalFlowPyramid(gray, pyramid_, window, options_.levels);
+
+        const bool keyframe_due = options_.keyframe_interval > 0 && since_keyframe_ + 1 >= options_.keyframe_interval;
+        if( !template_points_.empty() && !previous_pyramid_.empty() && !keyframe_due )
+        {
+            flow(result);
+            ++since_keyframe_;
+        }
+    }
+
+    if( result.tracks < options_.min_tracks || !options_.enabled )
+        detect(gray, result);
+
+    result.ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    return 0;
+}
+
+/**
+ * @function TemplateTracker::detect
+ * brief keyframe: the inliers of the match against the template become the tracks
+ */
+int TemplateTracker::detect( const cv::Mat &frame, TrackedFrame &result )
+{
+    result = TrackedFrame();
+    result.keyframe = true;
+    template_points_.clear();
+    points_.clear();
+    since_keyframe_ = 0;
+    ++keyframes_;
+
+    std::vector<cv::KeyPoint> frame_keypoints;
+    cv::Mat frame_descriptors;
+    if( matcher_->describe(frame, frame_keypoints, frame_descriptors) == 0 )
+        return 0;
+    std::vector<cv::DMatch> matches;
+    Verification verified;
+    const int inliers = matcher_->match_and_verify(template_keypoints_, template_descriptors_, frame_keypoints,
+                                                   frame_descriptors, matches, verified, verification_);
+    if( inliers <= 0 )
+        return inliers;
+
+    for( size_t i = 0; i < verified.inliers.size(); ++i )
+    {
+        template_points_.push_back(template_keypoints_[verified.inliers[i].queryIdx].pt);
+        points_.push_back(frame_keypoints[verified.inliers[i].trainIdx].pt);
+    }
+    result.tracks = static_cast<int>(points_.size());
+    result.homography = verified.homography;
+    result.points = points_;
+    return inliers;
+}
+
+/**
+ * @function TemplateTracker::flow
+ * brief tracks the points from the previous pyramid to the current one and back, and verifies the tracks which
+ * come back with a homography; the inliers are the tracks of the next frame
+ */
+void TemplateTracker::flow( TrackedFrame &result )
+{
+    const cv::Size window(options_.window_size, options_.window_size);
+    std::vector<cv::Point2f> next, back;
+    std::vector<uchar> status, back_status;
+    std::vector<float> error;
+    cv::calcOpticalFlowPyrLK(previous_pyramid_, pyramid_, points_, next, status, error, window, options_.levels);
+    cv::calcOpticalFlowPyrLK(pyramid_, previous_pyramid_, next, back, back_status, error, window, options_.levels);
+
+    /// Forward-backward error: the tracks which come back closest to where they started are sampled first
+    std::vector<std::pair<float, int> > order;
+    const double squared_max_error = options_.max_backward_error * options_.max_backward_error;
+    for( size_t i = 0; i < points_.size(); ++i )
+    {
+        const cv::Point2f difference = back[i] - points_[i];
+        const float squared_error = difference.x * difference.x + difference.y * difference.y;
+        if( status[i] && back_status[i] && squared_error <= squared_max_error )
+            order.push_back(std::make_pair(squared_error, static_cast<int>(i)));
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<cv::Point2f> src, dst;
+    for( size_t i = 0; i < order.size(); ++i )
+    {
+        src.push_back(template_points_[order[i].second]);
+        dst.push_back(next[order[i].second]);
+    }
+
+    std::vector<uchar> mask;
+    estimate_homography(src, dst, verification_, result.homography, mask);
+    template_points_.clear();
+    points_.clear();
+    for( size_t i = 0; i < mask.size(); ++i )
+        if( mask[i] )
+        {
+            template_points_.push_back(src[i]);
+            points_.push_back(dst[i]);
+        }
+    result.tracks = static_cast<int>(points_.size());
+    result.points = points_;
+}
+
+/**
+ * @function draw_tracked
+ */
+void draw_tracked( const cv::Mat &frame, const cv::Size &template_size, const TrackedFrame &tracked, cv::Mat &dst )
+{
+    frame.copyTo(dst);
+    const cv::Scalar color = tracked.keyframe ? cv::Scalar(0, 255, 255) : cv::Scalar(0, 255, 0);
+    for( size_t i = 0; i < tracked.points.size(); ++i )
+        cv::circle(dst, tracked.points[i], 3, color, 1);
+
+    if( !tracked.found() )
+        return;
+
+    std::vector<cv::Point2f> corners(4), projected;
+    corners[1] = cv::Point2f(static_cast<float>(template_size.width), 0.0f);
+    corners[2] = cv::Point2f(static_cast<float>(template_size.width), static_cast<float>(template_size.height));
+    corners[3] = cv::Point2f(0.0f, static_cast<float>(template_size.height));
+    cv::perspectiveTransform(corners, projected, tracked.homography);
+    for( int i = 0; i < 4; ++i )
+        cv::line(dst, projected[i], projected[(i + 1) % 4], color, 2);
+}
+
+} // namespace cvdemo
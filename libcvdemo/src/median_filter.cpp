@@ -0,0 +1,179 @@
+/**
+ * Median Filter
+ * brief constant time median filter (S. Perreault, P. Hebert, "Median Filtering in Constant Time", 2007)
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/basic_operations.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CVDEMO_MEDIAN_SSE2
+#endif
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Every histogram is a single array: 16 coarse bins (high nibble) followed by 256 fine bins.
+/// 16 bit counters are enough up to kernel size 255 (255*255 < 65536)
+const int COARSE_BINS = 16;
+const int FINE_BINS = 256;
+const int HISTOGRAM_SIZE = COARSE_BINS + FINE_BINS;
+
+typedef unsigned short HistogramBin;
+
+/**
+ * @function histogram_add
+ * brief dst += src, 8 bins at once with SSE2
+ */
+inline void histogram_add( const HistogramBin *src, HistogramBin *dst )
+{
+    #ifdef CVDEMO_MEDIAN_SSE2
+    for( int i = 0; i < HISTOGRAM_SIZE; i += 8 )
+    {
+        __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src + i) );
+        __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>(dst + i) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i), _mm_add_epi16(b, a) );
+    }
+    #else
+    for( int i = 0; i < HISTOGRAM_SIZE; ++i )
+        dst[i] += src[i];
+    #endif
+}
+
+/**
+ * @function histogram_add_sub
+ * brief dst += add - sub, the slide of the kernel histogram by one column
+ */
+inline void histogram_add_sub( const HistogramBin *add, const HistogramBin *sub, HistogramBin *dst )
+{
+    #ifdef CVDEMO_MEDIAN_SSE2
+    for( int i = 0; i < HISTOGRAM_SIZE; i += 8 )
+    {
+        __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>(add + i) );
+        __m128i s = _mm_loadu_si128( reinterpret_cast<const __m128i*>(sub + i) );
+        __m128i d = _mm_loadu_si128( reinterpret_cast<const __m128i*>(dst + i) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i), _mm_sub_epi16(_mm_add_epi16(d, a), s) );
+    }
+    #else
+    for( int i = 0; i < HISTOGRAM_SIZE; ++i )
+        dst[i] = static_cast<HistogramBin>(dst[i] + add[i] - sub[i]);
+    #endif
+}
+
+/**
+ * @function histogram_median
+ * brief value of the given rank: coarse bins first, then the 16 fine bins of the selected coarse bin
+ */
+inline uchar histogram_median( const HistogramBin *histogram, int rank )
+{
+    const HistogramBin *fine = histogram + COARSE_BINS;
+    int count = 0;
+    int bin = 0;
+    while( count + histogram[bin] <= rank )
+        count += histogram[bin++];
+
+    bin *= COARSE_BINS;
+    while( count + fine[bin] <= rank )
+        count += fine[bin++];
+    return static_cast<uchar>(bin);
+}
+
+/**
+ * @function median_plane
+ * brief filters a single channel plane, padded by radius pixels on every side
+ */
+void median_plane( const cv::Mat &padded, cv::Mat &dst, int radius )
+{
+    const int diameter = 2*radius + 1;
+    const int rank = diameter*diameter / 2;
+    const int columns = padded.cols;
+
+    /// One histogram per column of the padded plane, covering the rows of the current kernel
+    std::vector<HistogramBin> column_histograms( static_cast<size_t>(columns) * HISTOGRAM_SIZE, 0 );
+    std::vector<HistogramBin> kernel_histogram( HISTOGRAM_SIZE );
+
+    for( int y = 0; y < diameter; ++y )
+    {
+        const uchar *row = padded.ptr<uchar>(y);
+        for( int x = 0; x < columns; ++x )
+        {
+            HistogramBin *histogram = &column_histograms[x * HISTOGRAM_SIZE];
+            ++histogram[row[x] >> 4];
+            ++histogram[COARSE_BINS + row[x]];
+        }
+    }
+
+    for( int y = 0; y < dst.rows; ++y )
+    {
+        if( y > 0 )
+        {
+            /// Moves every column histogram one row down
+            const uchar *removed = padded.ptr<uchar>(y - 1);
+            const uchar *added = padded.ptr<uchar>(y + diameter - 1);
+            for( int x = 0; x < columns; ++x )
+            {
+                HistogramBin *histogram = &column_histograms[x * HISTOGRAM_SIZE];
+                --histogram[removed[x] >> 4];
+                --histogram[COARSE_BINS + removed[x]];
+                ++histogram[added[x] >> 4];
+                ++histogram[COARSE_BINS + added[x]];
+            }
+        }
+
+        std::fill( kernel_histogram.begin(), kernel_histogram.end(), HistogramBin(0) );
+        for( int x = 0; x < diameter; ++x )
+            histogram_add( &column_histograms[x * HISTOGRAM_SIZE], &kernel_histogram[0] );
+
+        uchar *out = dst.ptr<uchar>(y);
+        out[0] = histogram_median( &kernel_histogram[0], rank );
+        for( int x = 1; x < dst.cols; ++x )
+        {
+            /// Slides the kernel: one column enters on the right, one leaves on the left, whatever the kernel size
+            histogram_add_sub( &column_histograms[(x + diameter - 1) * HISTOGRAM_SIZE],
+                               &column_histograms[(x - 1) * HISTOGRAM_SIZE], &kernel_histogram[0] );
+            out[x] = histogram_median( &kernel_histogram[0], rank );
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @function median_filter
+ */
+void median_filter( const cv::Mat &src, cv::Mat &dst, int kernel_size )
+{
+    if( src.depth() != CV_8U || kernel_size < 3 || kernel_size > 255 || kernel_size % 2 == 0 )
+    {
+        cv::medianBlur( src, dst, kernel_size );
+        return;
+    }
+
+    const int radius = kernel_size / 2;
+
+    /// Replicated border, as cv::medianBlur
+    cv::Mat padded;
+    cv::copyMakeBorder( src, padded, radius, radius, radius, radius, cv::BORDER_REPLICATE );
+
+    std::vector<cv::Mat> planes;
+    cv::split( padded, planes );
+
+    std::vector<cv::Mat> results( planes.size() );
+    for( size_t c = 0; c < planes.size(); ++c )
+    {
+        results[c].create( src.size(), CV_8UC1 );
+        median_plane( planes[c], results[c], radius );
+    }
+
+    cv::merge( results, dst );
+}
+
+} // namespace cvdemo
@@ -0,0 +1,216 @@
+/**
+ * Multi-Index Hashing
+ * brief sublinear k nearest neighbour search of binary descriptors (ORB, BRISK) for large collections
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/multi_index_hashing.hpp"
+#include "cvdemo/hamming_matcher.hpp"
+
+#include <algorithm>
+#include <climits>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+const int SUBSTRING_BITS = 16;
+const int BUCKETS = 1 << SUBSTRING_BITS;
+
+/// Key of the s-th substring of a descriptor
+inline int substring_key( const uchar *descriptor, int s )
+{
+    return descriptor[2*s] | (descriptor[2*s + 1] << 8);
+}
+
+/**
+ * @function flip_masks
+ * brief the masks of SUBSTRING_BITS bits with exactly radius bits set, in increasing order (Gosper's hack)
+ */
+std::vector<int> flip_masks( int radius )
+{
+    std::vector<int> masks;
+    if( radius == 0 )
+    {
+        masks.push_back(0);
+        return masks;
+    }
+    for( int mask = (1 << radius) - 1; mask < BUCKETS; )
+    {
+        masks.push_back(mask);
+        const int lowest = mask & -mask;
+        const int ripple = mask + lowest;
+        mask = (((ripple ^ mask) >> 2) / lowest) | ripple;
+    }
+    return masks;
+}
+
+/**
+ * Counting sort of the descriptors by the key of a substring, one table per index of the range
+ */
+class BuildBody : public cv::ParallelLoopBody
+{
+public:
+    BuildBody( const cv::Mat &train, std::vector<int> &offsets, std::vector<int> &ids )
+        : train_(train), offsets_(offsets), ids_(ids) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        for( int s = range.start; s < range.end; ++s )
+        {
+            int *offsets = &offsets_[s * (BUCKETS + 1)];
+            int *ids = &ids_[static_cast<size_t>(s) * train_.rows];
+            std::fill(offsets, offsets + BUCKETS + 1, 0);
+            for( int i = 0; i < train_.rows; ++i )
+                ++offsets[substring_key(train_.ptr<uchar>(i), s) + 1];
+            for( int b = 0; b < BUCKETS; ++b )
+                offsets[b + 1] += offsets[b];
+
+            std::vector<int> next(offsets, offsets + BUCKETS);
+            for( int i = 0; i < train_.rows; ++i )
+                ids[next[substring_key(train_.ptr<uchar>(i), s)]++] = i;
+        }
+    }
+
+private:
+    const cv::Mat &train_;
+    std::vector<int> &offsets_;
+    std::vector<int> &ids_;
+};
+
+/**
+ * Search of the queries of a range, radius by radius over all the tables; every train descriptor is compared once
+ * per query, the last query which saw it is stamped in seen
+ */
+class SearchBody : public cv::ParallelLoopBody
+{
+public:
+    SearchBody( const cv::Mat &query, const cv::Mat &train, int substrings, const std::vector<int> &offsets,
+                const std::vector<int> &ids, const std::vector<std::vector<int> > &masks, int k,
+                std::vector<std::vector<cv::DMatch> > &matches, std::vector<int> &candidates )
+        : query_(query), train_(train), substrings_(substrings), offsets_(offsets), ids_(ids), masks_(masks), k_(k),
+          matches_(matches), candidates_(candidates) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        const int bytes = query_.cols;
+        std::vector<int> seen(train_.rows, -1);
+        std::vector<int> best(k_), best_index(k_);
+        for( int q = range.start; q < range.end; ++q )
+        {
+            const uchar *descriptor = query_.ptr<uchar>(q);
+            std::fill(best.begin(), best.end(), INT_MAX);
+            std::fill(best_index.begin(), best_index.end(), -1);
+            int compared = 0;
+
+            for( size_t radius = 0; radius < masks_.size(); ++radius )
+            {
+                for( int s = 0; s < substrings_; ++s )
+                {
+                    const int key = substring_key(descriptor, s);
+                    const int *offsets = &offsets_[s * (BUCKETS + 1)];
+                    const int *ids = &ids_[static_cast<size_t>(s) * train_.rows];
+                    const std::vector<int> &masks = masks_[radius];
+                    for( size_t m = 0; m < masks.size(); ++m )
+                    {
+                        const int bucket = key ^ masks[m];
+                        for( int i = offsets[bucket]; i < offsets[bucket + 1]; ++i )
+                        {
+                            const int t = ids[i];
+                            if( seen[t] == q )
+                                continue;
+                            seen[t] = q;
+                            ++compared;
+
+                            const int distance = hamming_distance(descriptor, train_.ptr<uchar>(t), bytes);
+                            if( distance > best[k_ - 1] || (distance == best[k_ - 1] && t > best_index[k_ - 1]) )
+                                continue;
+                            int p = k_ - 1;
+                            for( ; p > 0 && (best[p - 1] > distance || (best[p - 1] == distance && best_index[p - 1] > t)); --p )
+                            {
+                                best[p] = best[p - 1];
+                                best_index[p] = best_index[p - 1];
+                            }
+                            best[p] = distance;
+                            best_index[p] = t;
+                        }
+                    }
+                }
+
+                /// Any descriptor not seen yet differs by more than radius bits on every substring
+                if( best[k_ - 1] < substrings_ * static_cast<int>(radius + 1) || compared == train_.rows )
+                    break;
+            }
+
+            std::vector<cv::DMatch> &query_matches = matches_[q];
+            query_matches.clear();
+            for( int i = 0; i < k_ && best_index[i] >= 0; ++i )
+                query_matches.push_back(cv::DMatch(q, best_index[i], static_cast<float>(best[i])));
+            candidates_[q] = compared;
+        }
+    }
+
+private:
+    const cv::Mat &query_;
+    const cv::Mat &train_;
+    int substrings_;
+    const std::vector<int> &offsets_;
+    const std::vector<int> &ids_;
+    const std::vector<std::vector<int> > &masks_;
+    int k_;
+    std::vector<std::vector<cv::DMatch> > &matches_;
+    std::vector<int> &candidates_;
+};
+
+} // namespace
+
+/**
+ * @function MultiIndexHashing::build
+ */
+void MultiIndexHashing::build( const cv::Mat &train )
+{
+    CV_Assert( train.empty() || (train.type() == CV_8UC1 && train.cols % 2 == 0) );
+    train_ = train;
+    substrings_ = train.cols * 8 / SUBSTRING_BITS;
+    offsets_.assign(static_cast<size_t>(substrings_) * (BUCKETS + 1), 0);
+    ids_.assign(static_cast<size_t>(substrings_) * train.rows, 0);
+    if( !train.empty() )
+        cv::parallel_for_(cv::Range(0, substrings_), BuildBody(train_, offsets_, ids_));
+}
+
+/**
+ * @function MultiIndexHashing::knn_match
+ */
+void MultiIndexHashing::knn_match( const cv::Mat &query, std::vector<std::vector<cv::DMatch> > &matches, int k,
+                                   int max_radius, double *candidates ) const
+{
+    matches.clear();
+    if( candidates )
+        *candidates = 0.0;
+    if( query.empty() || empty() || k < 1 )
+        return;
+    CV_Assert( query.type() == CV_8UC1 && query.cols == train_.cols );
+
+    std::vector<std::vector<int> > masks;
+    for( int radius = 0; radius <= std::min(std::max(0, max_radius), SUBSTRING_BITS); ++radius )
+        masks.push_back(flip_masks(radius));
+
+    /// A few stripes per thread: every stripe allocates its own seen stamps, one per train descriptor
+    std::vector<int> compared(query.rows, 0);
+    matches.resize(query.rows);
+    cv::parallel_for_(cv::Range(0, query.rows),
+                      SearchBody(query, train_, substrings_, offsets_, ids_, masks, k, matches, compared),
+                      std::max(1, cv::getNumThreads() * 4));
+
+    if( candidates )
+    {
+        double total = 0.0;
+        for( int q = 0; q < query.rows; ++q )
+            total += compared[q];
+        *candidates = total / query.rows;
+    }
+}
+
+} // namespace cvdemo
@@ -0,0 +1,218 @@
+/**
+ * Object Detection
+ * brief Haar cascade face detection and template matching used by the object_detection demos
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/object_detection.hpp"
+#include "cvdemo/basic_operations.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// For SQDIFF and SQDIFF_NORMED, the best matches are lower values
+inline bool lower_is_better( int method )
+{
+    return method == cv::TM_SQDIFF || method == cv::TM_SQDIFF_NORMED;
+}
+
+/// Location of a possible match and its score, higher is better
+struct Candidate
+{
+    cv::Point location;
+    float score;
+};
+
+inline bool better( const Candidate &a, const Candidate &b )
+{
+    return a.score > b.score;
+}
+
+/**
+ * @function best_candidates
+ * brief the count best locations of the result (higher is better), every one suppressing the locations within radius
+ */
+void best_candidates( cv::Mat &result, int count, const cv::Size &radius, std::vector<Candidate> &candidates )
+{
+    const cv::Rect bounds(0, 0, result.cols, result.rows);
+    for( int i = 0; i < count; ++i )
+    {
+        double best = 0.0;
+        cv::Point location;
+        cv::minMaxLoc( result, 0, &best, 0, &location );
+        if( best <= -FLT_MAX )
+            break;
+
+        Candidate candidate;
+        candidate.location = location;
+        candidate.score = static_cast<float>(best);
+        candidates.push_back(candidate);
+        const cv::Rect suppressed(location.x - radius.width, location.y - radius.height, 2 * radius.width + 1, 2 * radius.height + 1);
+        result(suppressed & bounds).setTo(cv::Scalar::all(-FLT_MAX));
+    }
+}
+
+/// Refines the candidates of the coarser level in windows of this level around their doubled locations
+class RefineBody : public cv::ParallelLoopBody
+{
+public:
+    RefineBody( const cv::Mat &image, const cv::Mat &templ, int method, int margin, std::vector<Candidate> &candidates )
+        : image_(image), templ_(templ), method_(method), margin_(margin), candidates_(candidates) {}
+
+    void operator()( const cv::Range &range ) const
+    {
+        /// Locations where the template fits in the image
+        const cv::Rect valid(0, 0, image_.cols - templ_.cols + 1, image_.rows - templ_.rows + 1);
+        for( int i = range.start; i < range.end; ++i )
+        {
+            Candidate &candidate = candidates_[i];
+            const cv::Rect window = cv::Rect(candidate.location.x * 2 - margin_, candidate.location.y * 2 - margin_,
+                                             2 * margin_ + 2, 2 * margin_ + 2) & valid;
+            if( window.area() <= 0 )
+            {
+                candidate.score = -FLT_MAX;
+                continue;
+            }
+
+            cv::Mat local;
+            cv::matchTemplate( image_(cv::Rect(window.x, window.y, window.width + templ_.cols - 1, window.height + templ_.rows - 1)),
+                               templ_, local, method_ );
+            if( lower_is_better(method_) )
+                local.convertTo( local, CV_32F, -1.0 );
+
+            double best = 0.0;
+            cv::Point location;
+            cv::minMaxLoc( local, 0, &best, 0, &location );
+            candidate.location = window.tl() + location;
+            candidate.score = static_cast<float>(best);
+        }
+    }
+
+private:
+    const cv::Mat &image_;
+    const cv::Mat &templ_;
+    int method_;
+    int margin_;
+    std::vector<Candidate> &candidates_;
+};
+
+} // namespace
+
+/**
+ * @function detect_faces
+ */
+void detect_faces( cv::CascadeClassifier &cascade, const cv::Mat &frame, std::vector<cv::Rect> &faces )
+{
+    cv::Mat frame_gray;
+    to_gray( frame, frame_gray );
+    cv::equalizeHist( frame_gray, frame_gray );
+
+    cascade.detectMultiScale(frame_gray, faces, 1.1, 10, 0 | cv::CASCADE_SCALE_IMAGE, cv::Size(30, 30));
+}
+
+/**
+ * @function draw_faces
+ */
+void draw_faces( cv::Mat &frame, const std::vector<cv::Rect> &faces )
+{
+    for (auto face:faces)
+    {
+        cv::Point center( face.x + face.width/2, face.y + face.height/2 );
+        cv::ellipse( frame, center, cv::Size( face.width/2, face.height/2 ), 0, 0, 360, cv::Scalar( 0, 255, 0 ), 4, 8, 0 );
+    }
+}
+
+/**
+ * @function match_template
+ */
+cv::Point match_template( const cv::Mat &image, const cv::Mat &templ, int method, cv::Mat &result )
+{
+    /// Create the result matrix
+    int result_cols = image.cols - templ.cols + 1;
+    int result_rows = image.rows - templ.rows + 1;
+    result.create( result_rows, result_cols, CV_32FC1 );
+
+    /// Do the Matching and Normalize
+    cv::matchTemplate( image, templ, result, method );
+    cv::normalize( result, result, 0, 1, cv::NORM_MINMAX, -1, cv::Mat() );
+
+    /// Localizing the best match with minMaxLoc
+    double minVal = 0.0;
+    double maxVal = 0.0;
+    cv::Point minLoc;
+    cv::Point maxLoc;
+    cv::minMaxLoc( result, &minVal, &maxVal, &minLoc, &maxLoc );
+
+    /// For SQDIFF and SQDIFF_NORMED, the best matches are lower values. For all the other methods, the higher the better
+    if( method == cv::TM_SQDIFF || method == cv::TM_SQDIFF_NORMED )
+        return minLoc;
+    return maxLoc;
+}
+
+/**
+ * @function pyramid_levels
+ */
+int pyramid_levels( const cv::Size &image_size, const cv::Size &template_size, const PyramidMatching &options )
+{
+    if( template_size.width > image_size.width || template_size.height > image_size.height )
+        return 0;
+    const int max_levels = options.levels > 0 ? options.levels : 16;
+    const int shorter_side = std::min(template_size.width, template_size.height);
+    int levels = 0;
+    while( levels < max_levels && (shorter_side >> (levels + 1)) >= std::max(1, options.min_template_size) )
+        ++levels;
+    return levels;
+}
+
+/**
+ * @function match_template_pyramid
+ */
+cv::Point match_template_pyramid( const cv::Mat &image, const cv::Mat &templ, int method, const PyramidMatching &options, cv::Mat &result )
+{
+    const int levels = pyramid_levels( image.size(), templ.size(), options );
+    if( levels == 0 )
+        return match_template( image, templ, method, result );
+
+    std::vector<cv::Mat> images(levels + 1), templates(levels + 1);
+    images[0] = image;
+    templates[0] = templ;
+    for( int level = 1; level <= levels; ++level )
+    {
+        cv::pyrDown( images[level - 1], images[level] );
+        cv::pyrDown( templates[level - 1], templates[level] );
+    }
+
+    /// Exhaustive search at the coarsest level only
+    cv::Mat coarse;
+    cv::matchTemplate( images[levels], templates[levels], coarse, method );
+    cv::normalize( coarse, result, 0, 1, cv::NORM_MINMAX, -1, cv::Mat() );
+    if( lower_is_better(method) )
+        coarse.convertTo( coarse, CV_32F, -1.0 );
+
+    std::vector<Candidate> candidates;
+    best_candidates( coarse, std::max(1, options.candidates), cv::Size(templates[levels].cols / 2, templates[levels].rows / 2), candidates );
+
+    /// Every finer level only matches the windows around the candidates
+    for( int level = levels - 1; level >= 0; --level )
+        cv::parallel_for_( cv::Range(0, static_cast<int>(candidates.size())),
+                           RefineBody(images[level], templates[level], method, std::max(0, options.margin), candidates) );
+
+    return std::min_element( candidates.begin(), candidates.end(), better )->location;
+}
+
+/**
+ * @function draw_match
+ */
+void draw_match( cv::Mat &image, const cv::Point &location, const cv::Size &size )
+{
+    cv::rectangle( image, location, cv::Point( location.x + size.width , location.y + size.height ), cv::Scalar(0, 255, 0), 2, 8, 0 );
+}
+
+} // namespace cvdemo
@@ -0,0 +1,214 @@
+/**
+ * Rectangular Morphology
+ * brief erosion and dilation with rectangles in constant time per pixel (M. van Herk, "A fast algorithm for local
+ * minimum and maximum filters on rectangular and octagonal kernels", 1992; J. Gil, M. Werman, 1993)
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/basic_operations.hpp"
+#include "cvdemo/buffer_cache.hpp"
+
+#include <algorithm>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Bytes of g and h of a strip of columns in the vertical pass, about the size of a L2 cache
+const size_t COLUMN_STRIP_BYTES = 256 * 1024;
+
+/// Minimum for the erosion, 255 outside of the image as the default border of cv::erode
+struct MinOperation
+{
+    static uchar neutral() { return 255; }
+    static uchar apply( uchar a, uchar b ) { return std::min(a, b); }
+};
+
+/// Maximum for the dilation, 0 outside of the image as the default border of cv::dilate
+struct MaxOperation
+{
+    static uchar neutral() { return 0; }
+    static uchar apply( uchar a, uchar b ) { return std::max(a, b); }
+};
+
+/**
+ * @function van_herk_rows
+ * brief horizontal pass: the padded row is cut in blocks of the window width, g holds the running result from the
+ * left border of every block and h from the right border. Every window spans at most two blocks, so its result
+ * is op(h[x], g[x + width - 1]): 3 operations per pixel whatever the width. The padded row, g and h are the 3 rows
+ * of buffer
+ */
+template<class Operation>
+void van_herk_rows( const cv::Mat &src, cv::Mat &dst, int radius, cv::Mat &buffer )
+{
+    const int cn = src.channels();
+    const int width = 2*radius + 1;
+    /// Padded length rounded up to whole blocks
+    const int length = (src.cols + 2*radius + width - 1) / width * width;
+
+    buffer.create( 3, length * cn, CV_8UC1 );
+    uchar *line = buffer.ptr<uchar>(0), *g = buffer.ptr<uchar>(1), *h = buffer.ptr<uchar>(2);
+    /// The buffer may come from a call with the other operation: the padding is set every time
+    std::fill( line, line + static_cast<size_t>(length) * cn, Operation::neutral() );
+
+    for( int y = 0; y < src.rows; ++y )
+    {
+        const uchar *row = src.ptr<uchar>(y);
+        std::copy( row, row + src.cols*cn, line + radius*cn );
+
+        for( int i = 0; i < length; ++i )
+            for( int c = 0; c < cn; ++c )
+                g[i*cn + c] = i % width == 0 ? line[i*cn + c] : Operation::apply( g[(i - 1)*cn + c], line[i*cn + c] );
+
+        for( int i = length - 1; i >= 0; --i )
+            for( int c = 0; c < cn; ++c )
+                h[i*cn + c] = i % width == width - 1 ? line[i*cn + c] : Operation::apply( h[(i + 1)*cn + c], line[i*cn + c] );
+
+        uchar *out = dst.ptr<uchar>(y);
+        for( int x = 0; x < src.cols; ++x )
+            for( int c = 0; c < cn; ++c )
+                out[x*cn + c] = Operation::apply( h[x*cn + c], g[(x + width - 1)*cn + c] );
+    }
+}
+
+/**
+ * @function van_herk_columns
+ * brief vertical pass, same blocks along the columns, run on strips of columns: whole strip rows are combined at once,
+ * so that the inner loops run over contiguous memory and are vectorized by the compiler, and g and h of a strip
+ * (2 x padded height x strip width) stay in the cache instead of taking twice the image
+ */
+template<class Operation>
+void van_herk_columns( const cv::Mat &src, cv::Mat &dst, int radius, cv::Mat &buffer )
+{
+    const size_t row_length = static_cast<size_t>(src.cols) * src.channels();
+    const int height = 2*radius + 1;
+    const int length = (src.rows + 2*radius + height - 1) / height * height;
+
+    /// Strip width: whole cache lines, as many as fit in COLUMN_STRIP_BYTES
+    size_t strip = COLUMN_STRIP_BYTES / (2*length + 1) / 64 * 64;
+    strip = std::min( row_length, std::max<size_t>( 64, strip ) );
+
+    /// Rows of g, then rows of h, then the padding row
+    buffer.create( 2*length + 1, static_cast<int>(strip), CV_8UC1 );
+    uchar *g = buffer.ptr<uchar>(0), *h = buffer.ptr<uchar>(length), *border_row = buffer.ptr<uchar>(2*length);
+    std::fill( border_row, border_row + strip, Operation::neutral() );
+
+    for( size_t first = 0; first < row_length; first += strip )
+    {
+        const size_t width = std::min( strip, row_length - first );
+        #define PADDED_ROW(i) ((i) >= radius && (i) < src.rows + radius ? src.ptr<uchar>((i) - radius) + first : border_row)
+
+        for( int i = 0; i < length; ++i )
+        {
+            const uchar *in = PADDED_ROW(i);
+            uchar *current = &g[i * strip];
+            if( i % height == 0 )
+                std::copy( in, in + width, current );
+            else
+            {
+                const uchar *previous = current - strip;
+                for( size_t k = 0; k < width; ++k )
+                    current[k] = Operation::apply( previous[k], in[k] );
+            }
+        }
+
+        for( int i = length - 1; i >= 0; --i )
+        {
+            const uchar *in = PADDED_ROW(i);
+            uchar *current = &h[i * strip];
+            if( i % height == height - 1 )
+                std::copy( in, in + width, current );
+            else
+            {
+                const uchar *next = current + strip;
+                for( size_t k = 0; k < width; ++k )
+                    current[k] = Operation::apply( next[k], in[k] );
+            }
+        }
+        #undef PADDED_ROW
+
+        for( int y = 0; y < src.rows; ++y )
+        {
+            const uchar *top = &h[y * strip];
+            const uchar *bottom = &g[(y + height - 1) * strip];
+            uchar *out = dst.ptr<uchar>(y) + first;
+            for( size_t k = 0; k < width; ++k )
+                out[k] = Operation::apply( top[k], bottom[k] );
+        }
+    }
+}
+
+/**
+ * @function rect_morphology
+ */
+template<class Operation>
+void rect_morphology( const cv::Mat &src, cv::Mat &dst, int size, cv::Mat &rows, cv::Mat &row_buffer, cv::Mat &column_buffer )
+{
+    rows.create( src.size(), src.type() );
+    van_herk_rows<Operation>( src, rows, size, row_buffer );
+    dst.create( src.size(), src.type() );
+    van_herk_columns<Operation>( rows, dst, size, column_buffer );
+}
+
+} // namespace
+
+/**
+ * @function erode_rect
+ */
+void erode_rect( const cv::Mat &src, cv::Mat &dst, int size )
+{
+    if( src.depth() != CV_8U || size < 1 )
+    {
+        erode( src, dst, ELEMENT_RECT, size );
+        return;
+    }
+    cv::Mat rows, row_buffer, column_buffer;
+    rect_morphology<MinOperation>( src, dst, size, rows, row_buffer, column_buffer );
+}
+
+/**
+ * @function erode_rect
+ */
+void erode_rect( const cv::Mat &src, cv::Mat &dst, int size, BufferCache &cache )
+{
+    if( src.depth() != CV_8U || size < 1 )
+    {
+        erode( src, dst, ELEMENT_RECT, size, cache );
+        return;
+    }
+    rect_morphology<MinOperation>( src, dst, size, cache.buffer("rect_morphology.rows"),
+                                   cache.buffer("rect_morphology.row_pass"), cache.buffer("rect_morphology.column_pass") );
+}
+
+/**
+ * @function dilate_rect
+ */
+void dilate_rect( const cv::Mat &src, cv::Mat &dst, int size )
+{
+    if( src.depth() != CV_8U || size < 1 )
+    {
+        dilate( src, dst, ELEMENT_RECT, size );
+        return;
+    }
+    cv::Mat rows, row_buffer, column_buffer;
+    rect_morphology<MaxOperation>( src, dst, size, rows, row_buffer, column_buffer );
+}
+
+/**
+ * @function dilate_rect
+ */
+void dilate_rect( const cv::Mat &src, cv::Mat &dst, int size, BufferCache &cache )
+{
+    if( src.depth() != CV_8U || size < 1 )
+    {
+        dilate( src, dst, ELEMENT_RECT, size, cache );
+        return;
+    }
+    rect_morphology<MaxOperation>( src, dst, size, cache.buffer("rect_morphology.rows"),
+                                   cache.buffer("rect_morphology.row_pass"), cache.buffer("rect_morphology.column_pass") );
+}
+
+} // namespace cvdemo
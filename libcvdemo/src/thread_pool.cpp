@@ -0,0 +1,185 @@
+/**
+ * Thread Pool
+ * brief work-stealing thread pool used to run the tiled operations
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/thread_pool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Pool of the worker running on this thread, 0 outside the pools
+thread_local const ThreadPool *current_pool = 0;
+
+} // namespace
+
+/**
+ * @function ThreadPool
+ */
+ThreadPool::ThreadPool( unsigned int num_threads )
+    : queued_(0), unfinished_(0), stop_(false), next_queue_(0)
+{
+    if(num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(unsigned int i = 0; i < num_threads; ++i)
+        queues_.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+
+    for(unsigned int i = 0; i < num_threads; ++i)
+        workers_.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+/**
+ * @function ~ThreadPool
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        stop_ = true;
+    }
+    task_available_.notify_all();
+    for(size_t i = 0; i < workers_.size(); ++i)
+        workers_[i].join();
+}
+
+/**
+ * @function ThreadPool::submit
+ */
+void ThreadPool::submit( const std::function<void()> &task )
+{
+    TaskQueue &queue = *queues_[next_queue_++ % queues_.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        ++queued_;
+        ++unfinished_;
+    }
+    task_available_.notify_one();
+}
+
+/**
+ * @function ThreadPool::wait
+ */
+void ThreadPool::wait()
+{
+    if(in_worker())
+        throw std::logic_error("ThreadPool::wait called from a task of the same pool");
+
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    all_done_.wait(lock, [this]() { return unfinished_ == 0; });
+
+    if(error_)
+    {
+        std::exception_ptr error = error_;
+        error_ = std::exception_ptr();
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * @function ThreadPool::parallel_for
+ */
+void ThreadPool::parallel_for( int count, const std::function<void(int)> &body )
+{
+    if(in_worker())
+    {
+        for(int i = 0; i < count; ++i)
+            body(i);
+        return;
+    }
+
+    for(int i = 0; i < count; ++i)
+        submit([&body, i]() { body(i); });
+    wait();
+}
+
+/**
+ * @function ThreadPool::in_worker
+ */
+bool ThreadPool::in_worker() const
+{
+    return current_pool == this;
+}
+
+/**
+ * @function ThreadPool::pop_task
+ * brief newest task of the own queue first, then the oldest task of the other queues
+ */
+bool ThreadPool::pop_task( size_t index, std::function<void()> &task )
+{
+    {
+        TaskQueue &own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for(size_t i = 1; i < queues_.size(); ++i)
+    {
+        TaskQueue &victim = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @function ThreadPool::work
+ */
+void ThreadPool::work( size_t index )
+{
+    current_pool = this;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            task_available_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+            if(queued_ == 0)
+                return;
+            /// Reserves one of the queued tasks, so that it cannot be taken by another worker
+            --queued_;
+        }
+
+        std::function<void()> task;
+        while(!pop_task(index, task))
+            std::this_thread::yield();  /// the reserved task is being pushed by submit()
+
+        std::exception_ptr error;
+        try
+        {
+            task();
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if(error && !error_)
+            error_ = error;
+        if(--unfinished_ == 0)
+            all_done_.notify_all();
+    }
+}
+
+} // namespace cvdemo
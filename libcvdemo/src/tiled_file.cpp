@@ -0,0 +1,188 @@
+/**
+ * Tiled File
+ * brief images on disk read and written a tile at a time, for images which do not fit in memory
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/tiled_file.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <vector>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/**
+ * @function read_header_value
+ * brief next number of a PNM header, skipping whitespace and comments
+ */
+bool read_header_value( std::istream &in, int &value )
+{
+    int c = in.peek();
+    while(in && (std::isspace(c) || c == '#'))
+    {
+        if(c == '#')
+            while(in && in.get() != '\n') {}
+        else
+            in.get();
+        c = in.peek();
+    }
+    return static_cast<bool>(in >> value);
+}
+
+/**
+ * @function swap_red_blue
+ * brief RGB <-> BGR on a row of 3 channel pixels
+ */
+void swap_red_blue( uchar *row, int width )
+{
+    for(int x = 0; x < width; ++x)
+        std::swap(row[3*x], row[3*x + 2]);
+}
+
+} // namespace
+
+/**
+ * @function TiledImageFile::open
+ */
+bool TiledImageFile::open( const std::string &path )
+{
+    file_.close();
+    file_.clear();
+    file_.open(path.c_str(), std::ios::in | std::ios::binary);
+    if(!file_.is_open())
+        return false;
+
+    char magic[2] = { 0, 0 };
+    int max_value = 0;
+    file_.read(magic, 2);
+    if(magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6') ||
+       !read_header_value(file_, size_.width) || !read_header_value(file_, size_.height) ||
+       !read_header_value(file_, max_value) || max_value != 255)
+    {
+        file_.close();
+        return false;
+    }
+
+    /// A single whitespace separates the header from the samples
+    file_.get();
+    data_offset_ = file_.tellg();
+    rgb_ = magic[1] == '6';
+    type_ = rgb_ ? CV_8UC3 : CV_8UC1;
+    return true;
+}
+
+/**
+ * @function TiledImageFile::open_raw
+ */
+bool TiledImageFile::open_raw( const std::string &path, const cv::Size &size, int type )
+{
+    file_.close();
+    file_.clear();
+    file_.open(path.c_str(), std::ios::in | std::ios::binary);
+    if(!file_.is_open())
+        return false;
+
+    size_ = size;
+    type_ = type;
+    data_offset_ = 0;
+    rgb_ = false;
+
+    /// The file has to hold exactly the samples of the given size and type
+    file_.seekg(0, std::ios::end);
+    if(size.width <= 0 || size.height <= 0 || file_.tellg() != offset(0, size.height))
+    {
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @function TiledImageFile::create
+ */
+bool TiledImageFile::create( const std::string &path, const cv::Size &size, int type )
+{
+    file_.close();
+    file_.clear();
+    file_.open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file_.is_open())
+        return false;
+
+    size_ = size;
+    type_ = type;
+    rgb_ = type == CV_8UC3;
+    if(type == CV_8UC1 || type == CV_8UC3)
+    {
+        std::ostringstream header;
+        header << (rgb_ ? "P6" : "P5") << "\n" << size.width << " " << size.height << "\n255\n";
+        file_ << header.str();
+    }
+    data_offset_ = file_.tellp();
+
+    /// Allocates the whole file, so that the tiles can be written in any order
+    file_.seekp(offset(size.width - 1, size.height - 1) + static_cast<std::streamoff>(CV_ELEM_SIZE(type) - 1));
+    file_.put(0);
+    return static_cast<bool>(file_);
+}
+
+/**
+ * @function TiledImageFile::offset
+ */
+std::streamoff TiledImageFile::offset( int x, int y ) const
+{
+    return data_offset_ + (static_cast<std::streamoff>(y) * size_.width + x) * CV_ELEM_SIZE(type_);
+}
+
+/**
+ * @function TiledImageFile::read
+ */
+bool TiledImageFile::read( const cv::Rect &rect, cv::Mat &tile )
+{
+    cv::Rect clipped = rect & cv::Rect(0, 0, size_.width, size_.height);
+    tile.create(clipped.size(), type_);
+    const std::streamsize row_bytes = static_cast<std::streamsize>(clipped.width) * CV_ELEM_SIZE(type_);
+
+    for(int y = 0; y < clipped.height; ++y)
+    {
+        file_.seekg(offset(clipped.x, clipped.y + y));
+        file_.read(reinterpret_cast<char*>(tile.ptr(y)), row_bytes);
+        if(!file_)
+            return false;
+        if(rgb_)
+            swap_red_blue(tile.ptr(y), clipped.width);
+    }
+    return true;
+}
+
+/**
+ * @function TiledImageFile::write
+ */
+bool TiledImageFile::write( const cv::Point &corner, const cv::Mat &tile )
+{
+    CV_Assert(tile.type() == type_);
+    cv::Rect clipped = cv::Rect(corner, tile.size()) & cv::Rect(0, 0, size_.width, size_.height);
+    const std::streamsize row_bytes = static_cast<std::streamsize>(clipped.width) * CV_ELEM_SIZE(type_);
+    std::vector<uchar> row(static_cast<size_t>(row_bytes));
+
+    for(int y = 0; y < clipped.height; ++y)
+    {
+        const uchar *src = tile.ptr(clipped.y - corner.y + y) + (clipped.x - corner.x) * CV_ELEM_SIZE(type_);
+        std::copy(src, src + row_bytes, row.begin());
+        if(rgb_)
+            swap_red_blue(&row[0], clipped.width);
+
+        file_.seekp(offset(clipped.x, clipped.y + y));
+        file_.write(reinterpret_cast<const char*>(&row[0]), row_bytes);
+        if(!file_)
+            return false;
+    }
+    return true;
+}
+
+} // namespace cvdemo
@@ -0,0 +1,57 @@
+/**
+ * Tiling
+ * brief runs a neighbourhood filter on halo-padded tiles of an image in parallel
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/tiling.hpp"
+
+#include <algorithm>
+
+namespace cvdemo
+{
+
+/**
+ * @function split_tiles
+ */
+std::vector<cv::Rect> split_tiles( const cv::Size &size, int tile_size )
+{
+    tile_size = std::max(1, tile_size);
+
+    std::vector<cv::Rect> tiles;
+    for(int y = 0; y < size.height; y += tile_size)
+        for(int x = 0; x < size.width; x += tile_size)
+            tiles.push_back(cv::Rect(x, y, std::min(tile_size, size.width - x), std::min(tile_size, size.height - y)));
+    return tiles;
+}
+
+/**
+ * @function tiled_filter
+ */
+void tiled_filter( const cv::Mat &src, cv::Mat &dst, int halo, int tile_size, ThreadPool &pool, const TileFilter &filter )
+{
+    /// The tiles write disjoint parts of dst, so it has to be allocated once before
+    cv::Mat result(src.size(), src.type());
+    const cv::Rect image_rect(0, 0, src.cols, src.rows);
+    const std::vector<cv::Rect> tiles = split_tiles(src.size(), tile_size);
+
+    pool.parallel_for(static_cast<int>(tiles.size()), [&](int i)
+    {
+        const cv::Rect &tile = tiles[i];
+        /// At the image border the halo is clamped, there the filter applies its own border extrapolation as on the whole image
+        cv::Rect padded(tile.x - halo, tile.y - halo, tile.width + 2*halo, tile.height + 2*halo);
+        padded &= image_rect;
+
+        /// A copy, so that filters working on the ROI do not read pixels outside of it
+        cv::Mat padded_src = src(padded).clone();
+        cv::Mat padded_dst;
+        filter(padded_src, padded_dst);
+
+        cv::Rect inner(tile.x - padded.x, tile.y - padded.y, tile.width, tile.height);
+        padded_dst(inner).copyTo(result(tile));
+    });
+
+    dst = result;
+}
+
+} // namespace cvdemo
@@ -0,0 +1,261 @@
+/**
+ * Video
+ * brief pipelined processing of video files and cameras: decode, process and output stages on separate threads
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/video.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include "cvdemo/frame_ring.hpp"
+
+/// Defines depending of OpenCV version installed (2.4.x or 3.x)
+#ifdef OPENCV_OLD	/// 2.4.x version
+const int PROP_FPS = CV_CAP_PROP_FPS;
+#define CVDEMO_FOURCC(a, b, c, d) CV_FOURCC(a, b, c, d)
+#else				/// 3.x - github version
+const int PROP_FPS = cv::CAP_PROP_FPS;
+#define CVDEMO_FOURCC(a, b, c, d) cv::VideoWriter::fourcc(a, b, c, d)
+#endif
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Slot of the frame ring: buffers reused from frame to frame, with the timing of the stages
+struct PipelineFrame
+{
+    cv::Mat image;
+    cv::Mat result;
+    int64 start;
+    double decode_ms;
+    double process_ms;
+};
+
+enum PipelineStage { DECODE_STAGE, PROCESS_STAGE, OUTPUT_STAGE, PIPELINE_STAGES };
+typedef FrameRing<PipelineFrame, PIPELINE_STAGES> PipelineRing;
+
+/// Yields this many times before sleeping while waiting for a slot
+const int SPINS_BEFORE_SLEEP = 64;
+
+/**
+ * @function wait_slot
+ * brief waits for the next slot of the stage; 0 once the stage before has finished and handed over
+ * all its slots, or if the pipeline has been stopped
+ */
+PipelineFrame* wait_slot( PipelineRing &ring, PipelineStage stage, const std::atomic<bool> &previous_finished, const std::atomic<bool> &stop )
+{
+    for(int spins = 0; !stop.load(std::memory_order_acquire); ++spins)
+    {
+        /// Read before the last attempt, so that a slot handed over right before finishing is not lost
+        bool finished = previous_finished.load(std::memory_order_acquire);
+        PipelineFrame *frame = ring.try_acquire(stage);
+        if(frame || finished)
+            return frame;
+
+        if(spins < SPINS_BEFORE_SLEEP)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return 0;
+}
+
+/**
+ * @function elapsed_ms
+ */
+inline double elapsed_ms( int64 start )
+{
+    return (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+}
+
+} // namespace
+
+/**
+ * @function StageTiming::add
+ */
+void StageTiming::add( double ms )
+{
+    ++frames;
+    total_ms += ms;
+    max_ms = std::max(max_ms, ms);
+}
+
+/**
+ * @function is_camera
+ */
+bool is_camera( const std::string &source )
+{
+    return !source.empty() && source.find_first_not_of("0123456789") == std::string::npos;
+}
+
+/**
+ * @function open_capture
+ */
+bool open_capture( const std::string &source, cv::VideoCapture &capture )
+{
+    if(is_camera(source))
+        capture.open(std::atoi(source.c_str()));
+    else
+        capture.open(source);
+    return capture.isOpened();
+}
+
+/**
+ * @function print_statistics
+ */
+void print_statistics( const PipelineStatistics &statistics )
+{
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Frames: " << statistics.frames << " in " << statistics.seconds << " s, sustained " << statistics.fps() << " fps" << std::endl;
+
+    const StageTiming* stages[] = { &statistics.decode, &statistics.process, &statistics.output, &statistics.latency };
+    const char* names[] = { "decode", "process", "output", "end to end" };
+    for(int i = 0; i < 4; ++i)
+        std::cout << std::setw(12) << names[i] << ": avg " << std::setw(8) << stages[i]->average_ms()
+                  << " ms, max " << std::setw(8) << stages[i]->max_ms << " ms" << std::endl;
+    std::cout << "Dropped frames: " << statistics.dropped << ", decoder waited for a free slot " << statistics.backpressure << " times" << std::endl;
+}
+
+/**
+ * @function VideoPipeline
+ */
+VideoPipeline::VideoPipeline( size_t ring_size, bool drop_when_full )
+    : ring_size_(ring_size), drop_when_full_(drop_when_full)
+{
+}
+
+/**
+ * @function VideoPipeline::run
+ */
+PipelineStatistics VideoPipeline::run( cv::VideoCapture &capture, const Process &process, const Output &output )
+{
+    PipelineStatistics statistics;
+    PipelineRing ring(std::max<size_t>(2, ring_size_));
+    std::atomic<bool> decoded_all(false), processed_all(false), stop(false);
+    const std::atomic<bool> never(false);
+
+    /// The counters of the decoder are only read after joining it
+    std::thread decoder([&]()
+    {
+        while(!stop.load(std::memory_order_acquire))
+        {
+            PipelineFrame *frame = ring.try_acquire(DECODE_STAGE);
+            if(!frame && drop_when_full_)
+            {
+                /// A camera does not wait: the frame is grabbed without decoding it and dropped
+                if(!capture.grab())
+                    break;
+                ++statistics.dropped;
+                continue;
+            }
+            if(!frame)
+            {
+                ++statistics.backpressure;
+                if(!(frame = wait_slot(ring, DECODE_STAGE, never, stop)))
+                    break;
+            }
+
+            frame->start = cv::getTickCount();
+            /// Decodes in the buffer of the slot, reallocated only if the frame size changes
+            if(!capture.read(frame->image) || frame->image.empty())
+                break;
+            frame->decode_ms = elapsed_ms(frame->start);
+            ring.release(DECODE_STAGE);
+        }
+        decoded_all.store(true, std::memory_order_release);
+    });
+
+    std::thread processor([&]()
+    {
+        while(PipelineFrame *frame = wait_slot(ring, PROCESS_STAGE, decoded_all, stop))
+        {
+            int64 start = cv::getTickCount();
+            process(frame->image, frame->result);
+            frame->process_ms = elapsed_ms(start);
+            ring.release(PROCESS_STAGE);
+        }
+        processed_all.store(true, std::memory_order_release);
+    });
+
+    /// Output on the calling thread
+    int64 start = cv::getTickCount();
+    while(PipelineFrame *frame = wait_slot(ring, OUTPUT_STAGE, processed_all, stop))
+    {
+        int64 output_start = cv::getTickCount();
+        bool keep_going = output(frame->result);
+
+        statistics.decode.add(frame->decode_ms);
+        statistics.process.add(frame->process_ms);
+        statistics.output.add(elapsed_ms(output_start));
+        statistics.latency.add(elapsed_ms(frame->start));
+        ++statistics.frames;
+        ring.release(OUTPUT_STAGE);
+
+        /// Stops the other stages if the output ended the stream
+        if(!keep_going)
+            stop.store(true, std::memory_order_release);
+    }
+    statistics.seconds = elapsed_ms(start) / 1000.0;
+
+    decoder.join();
+    processor.join();
+    return statistics;
+}
+
+/**
+ * @function StreamOutput
+ */
+StreamOutput::StreamOutput( const StreamOptions &options, const Display &display, double fps )
+    : options_(options), display_(display), fps_(fps > 0.0 ? fps : 25.0)
+{
+}
+
+/**
+ * @function StreamOutput::operator()
+ */
+bool StreamOutput::operator()( const cv::Mat &result )
+{
+    if(!options_.record_file.empty())
+    {
+        if(!writer_.isOpened() && !writer_.open(options_.record_file, CVDEMO_FOURCC('M','J','P','G'), fps_, result.size(), result.channels() > 1))
+        {
+            std::cout << "Cannot record to " << options_.record_file << std::endl;
+            return false;
+        }
+        writer_.write(result);
+    }
+
+    if(options_.headless)
+        return true;
+
+    return display_.show(result, 1) == 0;
+}
+
+/**
+ * @function run_stream
+ */
+int run_stream( const StreamOptions &options, const Display &display, const VideoPipeline::Process &process )
+{
+    cv::VideoCapture capture;
+    if(!open_capture(options.source, capture))
+    {
+        std::cout << "Cannot open video source " << options.source << std::endl;
+        return -1;
+    }
+
+    StreamOutput output(options, display, capture.get(PROP_FPS));
+    VideoPipeline pipeline(4, is_camera(options.source));
+    print_statistics(pipeline.run(capture, process, std::ref(output)));
+    return 0;
+}
+
+} // namespace cvdemo
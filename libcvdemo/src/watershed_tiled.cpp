@@ -0,0 +1,253 @@
+/**
+ * Tiled Watershed
+ * brief out-of-core watershed segmentation: overlapping tiles segmented one at a time, labels merged across the seams
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include "cvdemo/image_processing.hpp"
+#include "cvdemo/basic_operations.hpp"
+#include "cvdemo/tiled_file.hpp"
+#include "cvdemo/union_find.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace cvdemo
+{
+
+namespace
+{
+
+/// Label of the background after mark_unknown, shared by all the tiles
+const int BACKGROUND_LABEL = 1;
+
+/// Labels of a tile along one side of a seam (two rows or two columns), in image coordinates
+struct SeamStrip
+{
+    cv::Rect rect;
+    cv::Mat labels;
+};
+
+/**
+ * @function core_rect
+ * brief pixels of the image assigned to the tile (tx, ty)
+ */
+cv::Rect core_rect( int tx, int ty, int tile_size, const cv::Size &size )
+{
+    const int x = tx * tile_size;
+    const int y = ty * tile_size;
+    return cv::Rect(x, y, std::min(tile_size, size.width - x), std::min(tile_size, size.height - y));
+}
+
+/**
+ * @function padded_rect
+ * brief core of a tile with overlap pixels on every side, clipped to the image
+ */
+cv::Rect padded_rect( const cv::Rect &core, int overlap, const cv::Rect &image_rect )
+{
+    return cv::Rect(core.x - overlap, core.y - overlap, core.width + 2*overlap, core.height + 2*overlap) & image_rect;
+}
+
+/**
+ * @function store_strip
+ * brief keeps the labels of the tile inside strip_rect, for the tile on the other side of the seam
+ */
+void store_strip( const cv::Mat &labels, const cv::Rect &tile_rect, const cv::Rect &strip_rect, SeamStrip &strip )
+{
+    strip.rect = strip_rect & tile_rect;
+    labels(strip.rect - tile_rect.tl()).copyTo(strip.labels);
+}
+
+/**
+ * @function merge_strip
+ * brief joins the labels given to the same pixels of area by the tile and by its neighbour, objects only
+ */
+void merge_strip( const cv::Mat &labels, const cv::Rect &tile_rect, const SeamStrip &strip, const cv::Rect &area, UnionFind &sets )
+{
+    const cv::Rect common = area & strip.rect & tile_rect;
+    for(int y = common.y; y < common.y + common.height; ++y)
+    {
+        const int *own = labels.ptr<int>(y - tile_rect.y) + (common.x - tile_rect.x);
+        const int *other = strip.labels.ptr<int>(y - strip.rect.y) + (common.x - strip.rect.x);
+        for(int x = 0; x < common.width; ++x)
+            if(own[x] > BACKGROUND_LABEL && other[x] > BACKGROUND_LABEL)
+                sets.unite(own[x], other[x]);
+    }
+}
+
+/**
+ * @function label_color
+ * brief color of a merged label, derived from the label itself so that no color table of the whole image is needed
+ */
+cv::Vec3b label_color( int label )
+{
+    if(label == -1)
+        return cv::Vec3b(255, 255, 255);
+    if(label <= 0)
+        return cv::Vec3b(0, 0, 0);
+
+    const unsigned int hash = static_cast<unsigned int>(label) * 2654435761u;
+    return cv::Vec3b(static_cast<uchar>(hash >> 8), static_cast<uchar>(hash >> 16), static_cast<uchar>(hash >> 24));
+}
+
+} // namespace
+
+/**
+ * @function watershed_tiled
+ */
+int watershed_tiled( TiledImageFile &input, const std::string &labels_path, const std::string &segmentation_path,
+                     int tile_size, int overlap, int *num_segments )
+{
+    if(!input.is_open())
+        return -1;
+
+    tile_size = std::max(16, tile_size);
+    overlap = std::max(1, overlap);
+    const cv::Size size = input.size();
+    const cv::Rect image_rect(0, 0, size.width, size.height);
+    const int tiles_x = (size.width + tile_size - 1) / tile_size;
+    const int tiles_y = (size.height + tile_size - 1) / tile_size;
+    cv::Mat tile, gray;
+
+    /// Otsu threshold of the whole image, so that every tile is binarized alike
+    size_t histogram[256] = { 0 };
+    for(int ty = 0; ty < tiles_y; ++ty)
+        for(int tx = 0; tx < tiles_x; ++tx)
+        {
+            if(!input.read(core_rect(tx, ty, tile_size, size), tile))
+                return -1;
+            to_gray(tile, gray);
+            for(int y = 0; y < gray.rows; ++y)
+            {
+                const uchar *row = gray.ptr<uchar>(y);
+                for(int x = 0; x < gray.cols; ++x)
+                    ++histogram[row[x]];
+            }
+        }
+    const int binary_threshold = otsu_threshold(histogram, static_cast<size_t>(size.width) * size.height);
+
+    /// Otsu threshold of the distance transform of the whole image, so that every tile cuts the sure foreground alike:
+    /// the distance of a core is computed on its padded tile, as in the segmentation pass
+    WatershedStages stages;
+    cv::Mat distance;
+    std::fill(histogram, histogram + 256, 0);
+    for(int ty = 0; ty < tiles_y; ++ty)
+        for(int tx = 0; tx < tiles_x; ++tx)
+        {
+            const cv::Rect core = core_rect(tx, ty, tile_size, size);
+            const cv::Rect padded = padded_rect(core, overlap, image_rect);
+            if(!input.read(padded, tile))
+                return -1;
+            watershed_binary(tile, stages.binary, 64, binary_threshold);
+            distance_transform_banded(stages.binary, distance);
+            distance_histogram(distance(core - padded.tl()), histogram);
+        }
+    const int foreground_threshold = otsu_threshold(histogram, static_cast<size_t>(size.width) * size.height);
+
+    TiledImageFile labels;
+    if(!labels.create(labels_path, size, CV_32SC1))
+        return -1;
+
+    /// Tiles in raster order: only the strips along the right seam of the previous tile and along the bottom seams
+    /// of the previous row of tiles are kept, to be compared with the next tiles
+    UnionFind sets(BACKGROUND_LABEL + 1);
+    SeamStrip left;
+    std::vector<SeamStrip> above(tiles_x);
+    cv::Mat color;
+
+    for(int ty = 0; ty < tiles_y; ++ty)
+        for(int tx = 0; tx < tiles_x; ++tx)
+        {
+            const cv::Rect core = core_rect(tx, ty, tile_size, size);
+            const cv::Rect padded = padded_rect(core, overlap, image_rect);
+            if(!input.read(padded, tile))
+                return -1;
+            if(tile.channels() == 1)
+            {
+                cv::Mat planes[] = { tile, tile, tile };
+                cv::merge(planes, 3, color);
+            }
+            else
+                color = tile;
+
+            /// Segmentation of the padded tile
+            cv::Mat &markers = stages.markers;
+            watershed_preprocess_fused(color, stages, 64, binary_threshold, foreground_threshold);
+            label_markers(stages.foreground, markers);
+            mark_unknown_fused(markers, stages.binary, stages.foreground);
+            cv::watershed(color, markers);
+
+            /// Object labels offset after the ones of the previous tiles
+            double max_label = 0.0;
+            cv::minMaxIdx(markers, 0, &max_label);
+            const int offset = static_cast<int>(sets.size()) - (BACKGROUND_LABEL + 1);
+            sets.resize(sets.size() + std::max(0, static_cast<int>(max_label) - BACKGROUND_LABEL));
+            for(int y = 0; y < markers.rows; ++y)
+            {
+                int *row = markers.ptr<int>(y);
+                for(int x = 0; x < markers.cols; ++x)
+                    if(row[x] > BACKGROUND_LABEL)
+                        row[x] += offset;
+            }
+
+            /// The two columns/rows around the seams have been segmented by both tiles
+            if(tx > 0)
+                merge_strip(markers, padded, left, cv::Rect(core.x - 1, core.y, 2, core.height), sets);
+            if(ty > 0)
+                merge_strip(markers, padded, above[tx], cv::Rect(core.x, core.y - 1, core.width, 2), sets);
+            store_strip(markers, padded, cv::Rect(core.x + core.width - 1, padded.y, 2, padded.height), left);
+            store_strip(markers, padded, cv::Rect(padded.x, core.y + core.height - 1, padded.width, 2), above[tx]);
+
+            if(!labels.write(core.tl(), markers(core - padded.tl())))
+                return -1;
+        }
+
+    /// Root of every label, the segments are the object labels which are roots
+    std::vector<int> merged(sets.size());
+    int segments = 0;
+    for(size_t id = 0; id < merged.size(); ++id)
+    {
+        merged[id] = sets.find(static_cast<int>(id));
+        if(static_cast<int>(id) > BACKGROUND_LABEL && merged[id] == static_cast<int>(id))
+            ++segments;
+    }
+    if(num_segments)
+        *num_segments = segments;
+
+    TiledImageFile segmentation;
+    if(!segmentation_path.empty() && !segmentation.create(segmentation_path, size, CV_8UC3))
+        return -1;
+
+    /// Second pass over the label file: merged labels written back, and colorized
+    cv::Mat tile_labels, tile_colors;
+    for(int ty = 0; ty < tiles_y; ++ty)
+        for(int tx = 0; tx < tiles_x; ++tx)
+        {
+            const cv::Rect core = core_rect(tx, ty, tile_size, size);
+            if(!labels.read(core, tile_labels))
+                return -1;
+
+            tile_colors.create(tile_labels.size(), CV_8UC3);
+            for(int y = 0; y < tile_labels.rows; ++y)
+            {
+                int *row = tile_labels.ptr<int>(y);
+                cv::Vec3b *colors = tile_colors.ptr<cv::Vec3b>(y);
+                for(int x = 0; x < tile_labels.cols; ++x)
+                {
+                    if(row[x] > 0)
+                        row[x] = merged[row[x]];
+                    colors[x] = label_color(row[x]);
+                }
+            }
+
+            if(!labels.write(core.tl(), tile_labels))
+                return -1;
+            if(segmentation.is_open() && !segmentation.write(core.tl(), tile_colors))
+                return -1;
+        }
+
+    return 0;
+}
+
+} // namespace cvdemo
@@ -0,0 +1,551 @@
+/**
+ * Library Tests
+ * brief the kernels of the library checked on random inputs against the OpenCV functions, or the plain loops, they
+ * replace: every test is run by name (one ctest each), all of them without arguments
+ * author Michele Adduci <adducimi@informatik.hu-berlin.de>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <cvdemo/basic_operations.hpp>
+#include <cvdemo/descriptor_index.hpp>
+#include <cvdemo/flann_index.hpp>
+#include <cvdemo/geometric_verification.hpp>
+#include <cvdemo/hamming_matcher.hpp>
+#include <cvdemo/image_processing.hpp>
+#include <cvdemo/matching_engine.hpp>
+#include <cvdemo/multi_index_hashing.hpp>
+#include <cvdemo/union_find.hpp>
+
+/// Global Variables
+int failures = 0;
+
+#define CHECK( condition ) check( (condition), #condition, __FILE__, __LINE__ )
+
+/**
+ * @function check
+ * brief reports a failed condition and counts it
+ */
+void check( bool passed, const char *condition, const char *file, int line )
+{
+	if( passed )
+		return;
+	std::cout << file << ":" << line << ": check failed: " << condition << std::endl;
+	++failures;
+}
+
+/**
+ * @function random_image
+ * brief image of uniform random values in [low, high)
+ */
+cv::Mat random_image( cv::RNG &rng, int rows, int cols, int type, int low = 0, int high = 256 )
+{
+	cv::Mat image( rows, cols, type );
+	rng.fill( image, cv::RNG::UNIFORM, cv::Scalar::all(low), cv::Scalar::all(high) );
+	return image;
+}
+
+/**
+ * @function identical
+ * brief same size, type and values
+ */
+bool identical( const cv::Mat &a, const cv::Mat &b )
+{
+	return a.size() == b.size() && a.type() == b.type() && (a.empty() || cv::norm( a, b, cv::NORM_INF ) == 0);
+}
+
+/**
+ * @function identical
+ * brief same lists of matches, same indices and distances in the same order
+ */
+bool identical( const std::vector<std::vector<cv::DMatch> > &a, const std::vector<std::vector<cv::DMatch> > &b )
+{
+	if( a.size() != b.size() )
+		return false;
+	for ( size_t q = 0; q < a.size(); ++q )
+	{
+		if( a[q].size() != b[q].size() )
+			return false;
+		for ( size_t i = 0; i < a[q].size(); ++i )
+			if( a[q][i].queryIdx != b[q][i].queryIdx || a[q][i].trainIdx != b[q][i].trainIdx || a[q][i].distance != b[q][i].distance )
+				return false;
+	}
+	return true;
+}
+
+/**
+ * @function identical
+ * brief same matches in the same order
+ */
+bool identical( const std::vector<cv::DMatch> &a, const std::vector<cv::DMatch> &b )
+{
+	return identical( std::vector<std::vector<cv::DMatch> >(1, a), std::vector<std::vector<cv::DMatch> >(1, b) );
+}
+
+/**
+ * @function reference_knn_match
+ * brief k nearest train descriptors of every query descriptor by Hamming distance, closest first, equal distances in
+ * the order of the train descriptors, one cv::norm at a time
+ */
+void reference_knn_match( const cv::Mat &query, const cv::Mat &train, std::vector<std::vector<cv::DMatch> > &matches, int k )
+{
+	matches.assign( query.rows, std::vector<cv::DMatch>() );
+	std::vector<std::pair<double, int> > distances( train.rows );
+	for ( int q = 0; q < query.rows; ++q )
+	{
+		for ( int t = 0; t < train.rows; ++t )
+			distances[t] = std::make_pair( cv::norm( query.row(q), train.row(t), cv::NORM_HAMMING ), t );
+		std::sort( distances.begin(), distances.end() );
+		for ( int i = 0; i < std::min( k, train.rows ); ++i )
+			matches[q].push_back( cv::DMatch( q, distances[i].second, static_cast<float>(distances[i].first) ) );
+	}
+}
+
+/**
+ * @function reference_labels
+ * brief connected components of the non-zero pixels by flood fill, numbered in the raster order of their first pixel
+ */
+int reference_labels( const cv::Mat &binary, cv::Mat &labels, int connectivity )
+{
+	labels = cv::Mat::zeros( binary.size(), CV_32SC1 );
+	int next = 1;
+	std::vector<cv::Point> stack;
+	for ( int y = 0; y < binary.rows; ++y )
+		for ( int x = 0; x < binary.cols; ++x )
+		{
+			if( binary.at<uchar>(y, x) == 0 || labels.at<int>(y, x) != 0 )
+				continue;
+			labels.at<int>(y, x) = next;
+			stack.push_back( cv::Point(x, y) );
+			while( !stack.empty() )
+			{
+				const cv::Point p = stack.back();
+				stack.pop_back();
+				for ( int dy = -1; dy <= 1; ++dy )
+					for ( int dx = -1; dx <= 1; ++dx )
+					{
+						const cv::Point n( p.x + dx, p.y + dy );
+						if( (dx == 0 && dy == 0) || (connectivity == 4 && dx != 0 && dy != 0) ||
+						    n.x < 0 || n.y < 0 || n.x >= binary.cols || n.y >= binary.rows ||
+						    binary.at<uchar>(n) == 0 || labels.at<int>(n) != 0 )
+							continue;
+						labels.at<int>(n) = next;
+						stack.push_back( n );
+					}
+			}
+			++next;
+		}
+	return next;
+}
+
+/**
+ * @function read_file
+ * brief bytes of a file, empty if it cannot be read
+ */
+std::vector<char> read_file( const std::string &path )
+{
+	std::ifstream file( path.c_str(), std::ios::in | std::ios::binary );
+	return std::vector<char>( (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>() );
+}
+
+/**
+ * @function write_file
+ */
+void write_file( const std::string &path, const std::vector<char> &bytes )
+{
+	std::ofstream file( path.c_str(), std::ios::out | std::ios::binary );
+	file.write( bytes.empty() ? 0 : &bytes[0], static_cast<std::streamsize>(bytes.size()) );
+}
+
+/**
+ * @function test_median_filter
+ * brief constant-time median against cv::medianBlur, gray and color, small to large kernels
+ */
+void test_median_filter()
+{
+	cv::RNG rng( 1 );
+	const int sizes[] = { 3, 5, 7, 9, 15, 31, 63 };
+	for ( int channels = 1; channels <= 3; channels += 2 )
+	{
+		const cv::Mat src = random_image( rng, 97, 131, CV_8UC(channels) );
+		for ( size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i )
+		{
+			cv::Mat expected, actual;
+			cv::medianBlur( src, expected, sizes[i] );
+			cvdemo::median_filter( src, actual, sizes[i] );
+			CHECK( identical( expected, actual ) );
+		}
+	}
+}
+
+/**
+ * @function test_rect_morphology
+ * brief van Herk/Gil-Werman erosion and dilation against cv::erode and cv::dilate with the same rectangle, kernels
+ * smaller and larger than the image, in place as well
+ */
+void test_rect_morphology()
+{
+	cv::RNG rng( 2 );
+	const int sizes[] = { 1, 2, 3, 5, 8, 20, 70 };
+	for ( int channels = 1; channels <= 3; channels += 2 )
+	{
+		const cv::Mat src = random_image( rng, 83, 121, CV_8UC(channels) );
+		for ( size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i )
+		{
+			const cv::Mat kernel = cv::getStructuringElement( cv::MORPH_RECT, cv::Size(2*sizes[i] + 1, 2*sizes[i] + 1) );
+			cv::Mat expected, actual;
+			cv::erode( src, expected, kernel );
+			cvdemo::erode_rect( src, actual, sizes[i] );
+			CHECK( identical( expected, actual ) );
+
+			cv::dilate( src, expected, kernel );
+			src.copyTo( actual );
+			cvdemo::dilate_rect( actual, actual, sizes[i] );
+			CHECK( identical( expected, actual ) );
+		}
+	}
+}
+
+/**
+ * @function test_label_components
+ * brief parallel labelling against a flood fill, on noise (components across all the strip seams, merged by the
+ * atomic union-find) and on a blank image, with the statistics of the components
+ */
+void test_label_components()
+{
+	cv::RNG rng( 3 );
+	/// More strips than rows of components, whatever the cores of the machine
+	const int threads = cv::getNumThreads();
+	cv::setNumThreads( 8 );
+
+	const cv::Mat noise = random_image( rng, 517, 389, CV_8UC1, 0, 2 );
+	const cv::Mat blank = cv::Mat::zeros( 64, 64, CV_8UC1 );
+	const cv::Mat* images[] = { &noise, &blank };
+	for ( int i = 0; i < 2; ++i )
+		for ( int connectivity = 4; connectivity <= 8; connectivity += 4 )
+		{
+			cv::Mat expected, actual;
+			std::vector<cvdemo::ComponentStats> stats;
+			const int expected_count = reference_labels( *images[i], expected, connectivity );
+			CHECK( cvdemo::label_components( *images[i], actual, connectivity, &stats ) == expected_count );
+			CHECK( identical( expected, actual ) );
+			#ifdef OPENCV_NEW
+			cv::Mat opencv_labels;
+			CHECK( cv::connectedComponents( *images[i], opencv_labels, connectivity, CV_32S ) == expected_count );
+			#endif
+
+			/// Areas of the components
+			std::vector<int> areas( expected_count, 0 );
+			for ( int y = 0; y < expected.rows; ++y )
+				for ( int x = 0; x < expected.cols; ++x )
+					++areas[expected.at<int>(y, x)];
+			CHECK( stats.size() == areas.size() );
+			for ( size_t l = 0; l < std::min( stats.size(), areas.size() ); ++l )
+				CHECK( stats[l].area == areas[l] );
+		}
+
+	cv::setNumThreads( threads );
+}
+
+/**
+ * @function test_union_find
+ * brief the root of a set is its smallest id, whatever the order of the unions
+ */
+void test_union_find()
+{
+	cvdemo::UnionFind sets( 10 );
+	CHECK( sets.unite( 7, 3 ) == 3 );
+	CHECK( sets.unite( 9, 8 ) == 8 );
+	CHECK( sets.unite( 9, 7 ) == 3 );
+	CHECK( sets.find( 8 ) == 3 );
+	CHECK( sets.find( 5 ) == 5 );
+	sets.resize( 12 );
+	CHECK( sets.find( 11 ) == 11 );
+	CHECK( sets.unite( 11, 0 ) == 0 );
+	CHECK( sets.find( 11 ) == 0 && sets.find( 9 ) == 3 );
+}
+
+/**
+ * @function test_hamming_knn_match
+ * brief blocked SIMD matcher against brute force, for the dedicated 256 and 512 bit kernels and the generic one,
+ * with many equal distances (2 bit descriptor values)
+ */
+void test_hamming_knn_match()
+{
+	cv::RNG rng( 4 );
+	const int lengths[] = { 32, 64, 24 };
+	const int ks[] = { 1, 2, 5 };
+	for ( int l = 0; l < 3; ++l )
+	{
+		const cv::Mat train = random_image( rng, 1500, lengths[l], CV_8UC1 );
+		const cv::Mat query = random_image( rng, 150, lengths[l], CV_8UC1 );
+		const cv::Mat coarse_train = random_image( rng, 300, lengths[l], CV_8UC1, 0, 4 );
+		for ( int i = 0; i < 3; ++i )
+		{
+			std::vector<std::vector<cv::DMatch> > expected, actual;
+			reference_knn_match( query, train, expected, ks[i] );
+			cvdemo::hamming_knn_match( query, train, actual, ks[i] );
+			CHECK( identical( expected, actual ) );
+
+			reference_knn_match( query, coarse_train, expected, ks[i] );
+			cvdemo::hamming_knn_match( query, coarse_train, actual, ks[i] );
+			CHECK( identical( expected, actual ) );
+		}
+	}
+}
+
+/**
+ * @function test_multi_index_hashing
+ * brief exact with a radius covering every distance; with near duplicates of the train descriptors the search stops
+ * at the first radii, still exact, after comparing a small part of the train descriptors
+ */
+void test_multi_index_hashing()
+{
+	cv::RNG rng( 5 );
+	const cv::Mat train = random_image( rng, 2000, 32, CV_8UC1 );
+	const cv::Mat query = random_image( rng, 100, 32, CV_8UC1 );
+	cvdemo::MultiIndexHashing index;
+	index.build( train );
+	CHECK( index.substrings() == 16 );
+
+	std::vector<std::vector<cv::DMatch> > expected, actual;
+	reference_knn_match( query, train, expected, 2 );
+	index.knn_match( query, actual, 2, 16 );
+	CHECK( identical( expected, actual ) );
+
+	/// Train descriptors with 3 bits flipped
+	cv::Mat near = train.rowRange( 0, 200 ).clone();
+	for ( int r = 0; r < near.rows; ++r )
+		for ( int b = 0; b < 3; ++b )
+			near.at<uchar>( r, rng.uniform(0, near.cols) ) ^= static_cast<uchar>( 1 << rng.uniform(0, 8) );
+	double candidates = 0.0;
+	reference_knn_match( near, train, expected, 1 );
+	index.knn_match( near, actual, 1, 2, &candidates );
+	CHECK( identical( expected, actual ) );
+	CHECK( candidates < 0.1 * train.rows );
+}
+
+/**
+ * @function test_matching_engine
+ * brief --mih on a fixed pair of images: the hash tables of the full image, searched with a radius covering every
+ * distance, give the ratio test matches and the homography of brute force. --flann queries in the same direction
+ */
+void test_matching_engine()
+{
+	const cv::Mat image_template = cv::imread( CVDEMO_TEST_DATA "/people.jpg", 1 );
+	const cv::Mat image_full = cv::imread( CVDEMO_TEST_DATA "/group.jpg", 1 );
+	CHECK( image_template.data && image_full.data );
+	if( !image_template.data || !image_full.data )
+		return;
+
+	cvdemo::HashingOptions hashing;
+	hashing.enabled = true;
+	hashing.max_radius = 16;
+	cvdemo::MatchingEngine<cvdemo::DETECTOR_ORB> brute_force;
+	cvdemo::MatchingEngine<cvdemo::DETECTOR_ORB> indexed( cvdemo::TiledDetection(), cvdemo::FlannOptions(), cvdemo::QuantizationOptions(), hashing );
+
+	cvdemo::KeypointMatches expected, actual;
+	CHECK( brute_force.run( image_template, image_full, expected ) == 0 );
+	CHECK( indexed.run( image_template, image_full, actual ) == 0 );
+	CHECK( !expected.matches.empty() );
+	CHECK( identical( expected.matches, actual.matches ) );
+	CHECK( identical( expected.good_matches, actual.good_matches ) );
+	CHECK( identical( expected.homography, actual.homography ) );
+
+	/// --flann: the LSH index of the full image answers the template descriptors, at most one match each
+	cvdemo::FlannOptions flann;
+	flann.algorithm = cvdemo::FlannOptions::LSH;
+	cvdemo::MatchingEngine<cvdemo::DETECTOR_ORB> approximate( cvdemo::TiledDetection(), flann );
+	CHECK( approximate.run( image_template, image_full, actual ) == 0 );
+	CHECK( !actual.matches.empty() );
+	std::vector<int> queries;
+	for ( size_t i = 0; i < actual.matches.size(); ++i )
+		queries.push_back( actual.matches[i].queryIdx );
+	std::sort( queries.begin(), queries.end() );
+	CHECK( std::unique( queries.begin(), queries.end() ) == queries.end() );
+	CHECK( queries.empty() || (queries.front() >= 0 && queries.back() < actual.template_descriptors.rows) );
+}
+
+/**
+ * @function test_prosac
+ * brief 60 exact correspondences ranked first, then 240 random ones: the homography is recovered, and PROSAC stops
+ * after a few hypotheses where RANSAC, with 20% of inliers, needs far more
+ */
+void test_prosac()
+{
+	cv::RNG rng( 6 );
+	const cv::Mat truth = (cv::Mat_<double>(3, 3) << 0.9, -0.1, 40.0, 0.15, 1.1, -20.0, 1e-4, 2e-4, 1.0);
+	std::vector<cv::Point2f> src, dst;
+	for ( int i = 0; i < 300; ++i )
+		src.push_back( cv::Point2f( rng.uniform(0.f, 640.f), rng.uniform(0.f, 480.f) ) );
+	cv::perspectiveTransform( src, dst, truth );
+	for ( int i = 60; i < 300; ++i )
+		dst[i] = cv::Point2f( rng.uniform(0.f, 700.f), rng.uniform(0.f, 600.f) );
+
+	cvdemo::VerificationOptions options;
+	cv::Mat homography;
+	std::vector<uchar> inliers;
+	int prosac_iterations = 0, ransac_iterations = 0;
+	const int count = cvdemo::estimate_homography( src, dst, options, homography, inliers, &prosac_iterations );
+	CHECK( count >= 60 && count < 70 );
+	CHECK( std::count( inliers.begin(), inliers.begin() + 60, 1 ) == 60 );
+	CHECK( !homography.empty() && cv::norm( homography / homography.at<double>(2, 2), truth, cv::NORM_INF ) < 1e-3 );
+	CHECK( prosac_iterations < 20 );
+
+	options.prosac = false;
+	CHECK( cvdemo::estimate_homography( src, dst, options, homography, inliers, &ransac_iterations ) >= 60 );
+	CHECK( ransac_iterations > prosac_iterations );
+}
+
+/**
+ * @function test_descriptor_index
+ * brief an index of two images is mapped with its tables; truncated files, or files with another header, are rejected
+ */
+void test_descriptor_index()
+{
+	const std::string path = cv::tempfile( ".idx" );
+	std::vector<std::string> images;
+	images.push_back( std::string(CVDEMO_TEST_DATA) + "/btor.jpg" );
+	images.push_back( std::string(CVDEMO_TEST_DATA) + "/car.jpg" );
+	const int64 descriptors = cvdemo::build_descriptor_index( cvdemo::DETECTOR_ORB, images, path );
+	CHECK( descriptors > 0 );
+
+	{
+		cvdemo::DescriptorIndex index;
+		CHECK( index.open( path ) );
+		CHECK( index.num_images() == 2 && index.num_descriptors() == descriptors );
+		CHECK( index.descriptors().rows == descriptors && index.descriptors().type() == CV_8UC1 );
+		CHECK( index.image_range(0).size() + index.image_range(1).size() == descriptors );
+		CHECK( index.image_path(1) == images[1] );
+	}
+
+	const std::vector<char> bytes = read_file( path );
+	CHECK( !bytes.empty() );
+	if( bytes.empty() )
+		return;
+	const std::string corrupt = path + ".corrupt";
+	cvdemo::DescriptorIndex index;
+
+	std::vector<char> truncated( bytes.begin(), bytes.end() - 1 );
+	write_file( corrupt, truncated );
+	CHECK( !index.open( corrupt ) );
+
+	std::vector<char> other_magic( bytes );
+	other_magic[0] ^= 1;
+	write_file( corrupt, other_magic );
+	CHECK( !index.open( corrupt ) );
+
+	write_file( corrupt, std::vector<char>() );
+	CHECK( !index.open( corrupt ) );
+	CHECK( !index.open( path + ".missing" ) );
+
+	std::remove( corrupt.c_str() );
+	std::remove( path.c_str() );
+}
+
+/**
+ * @function test_flann_cache
+ * brief the .train sidecar restores the descriptors of a saved index; an index of other descriptors is rebuilt in memory
+ * and kept on disk without update_cache; a corrupted sidecar is rejected by its checksum
+ */
+void test_flann_cache()
+{
+	cv::RNG rng( 7 );
+	const cv::Mat train = random_image( rng, 500, 32, CV_32FC1 );
+	const cv::Mat other = random_image( rng, 400, 32, CV_32FC1 );
+
+	cvdemo::FlannOptions options;
+	options.algorithm = cvdemo::FlannOptions::KDTREE;
+	options.index_path = cv::tempfile( ".flann" );
+
+	cvdemo::FlannIndex built, loaded;
+	CHECK( cvdemo::cached_flann_index( train, options, built ) );
+	CHECK( loaded.load( options.index_path ) );
+	CHECK( identical( loaded.train(), train ) );
+
+	options.update_cache = false;
+	CHECK( cvdemo::cached_flann_index( other, options, built ) );
+	CHECK( identical( built.train(), other ) );
+	CHECK( loaded.load( options.index_path ) && identical( loaded.train(), train ) );
+
+	/// The query of a train descriptor finds itself
+	std::vector<std::vector<cv::DMatch> > matches;
+	loaded.knn_match( train.rowRange(0, 10), matches, 1 );
+	CHECK( matches.size() == 10 && matches[3].size() == 1 && matches[3][0].trainIdx == 3 );
+
+	const std::string sidecar = options.index_path + ".train";
+	std::vector<char> bytes = read_file( sidecar );
+	CHECK( !bytes.empty() );
+	if( !bytes.empty() )
+	{
+		bytes.back() ^= 1;
+		write_file( sidecar, bytes );
+		CHECK( !loaded.load( options.index_path ) );
+	}
+
+	std::remove( sidecar.c_str() );
+	std::remove( options.index_path.c_str() );
+}
+
+/// Tests by name
+struct Test
+{
+	const char *name;
+	void (*run)();
+};
+
+const Test TESTS[] = {
+	{ "median_filter", test_median_filter },
+	{ "rect_morphology", test_rect_morphology },
+	{ "label_components", test_label_components },
+	{ "union_find", test_union_find },
+	{ "hamming_knn_match", test_hamming_knn_match },
+	{ "multi_index_hashing", test_multi_index_hashing },
+	{ "matching_engine", test_matching_engine },
+	{ "prosac", test_prosac },
+	{ "descriptor_index", test_descriptor_index },
+	{ "flann_cache", test_flann_cache }
+};
+
+/**
+ * @function main
+ * brief runs the test named by the argument, all of them without; returns 1 if a check failed
+ */
+int main( int argc, char** argv )
+{
+	bool found = false;
+	for ( size_t i = 0; i < sizeof(TESTS) / sizeof(TESTS[0]); ++i )
+	{
+		if( argc > 1 && std::strcmp( argv[1], TESTS[i].name ) != 0 )
+			continue;
+		found = true;
+		const int before = failures;
+		try
+		{
+			TESTS[i].run();
+		}
+		catch( const cv::Exception &e )
+		{
+			std::cout << TESTS[i].name << ": " << e.what() << std::endl;
+			++failures;
+		}
+		std::cout << TESTS[i].name << ": " << (failures == before ? "passed" : "FAILED") << std::endl;
+	}
+
+	if( !found )
+	{
+		std::cout << "Unknown test " << argv[1] << std::endl;
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
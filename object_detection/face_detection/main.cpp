@@ -6,17 +6,20 @@
  */
 
 #include <iostream>
-#include <opencv2/objdetect/objdetect.hpp>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/object_detection.hpp>
 
 /// Global Variables
 std::string face_cascade_name = "test_data/haarcascade_frontalface_alt.xml";
 cv::CascadeClassifier face_cascade;
-char window_name[] = "Face detection";
+cvdemo::Display display( "Face detection" );
 
 /// Function headers
 void detectAndDisplay( cv::Mat &frame );
+void detectFaces( cv::Mat &frame );
 void show_help(const std::string &message = "");
 
 /**
@@ -24,14 +27,38 @@ void show_help(const std::string &message = "");
  */
 int main(int argc, char **argv)
 {
-    if(argc < 2)
+	cvdemo::CommandLine command_line(argc, argv);
+	if(!command_line.valid())
+	{
+		show_help(command_line.error());
+		return -1;
+	}
+
+	/// Headless mode: the detected faces of every image are written to disk
+	cvdemo::BatchOptions batch = command_line.batch();
+	if(batch.enabled)
+	{
+		if( !face_cascade.load( face_cascade_name ) ){ std::cout << "--(!)Error loading face cascade" << std::endl; return -1; };
+
+		cvdemo::BatchWriter writer(batch.output_dir);
+		display.set_writer(&writer);
+		return cvdemo::run_batch(batch, writer, [&writer](const cv::Mat &image, const std::string &)
+		{
+			cv::Mat frame = image;
+			writer.stage("Faces");
+			detectAndDisplay(frame);
+			return 0;
+		});
+	}
+
+    if(command_line.positional().empty())
 	{
 		show_help("Not enough parameters given."); 
 		return 0;
 	}
 	
-	std::string image_file(argv[1]);
-	if(image_file.find_last_of(".jpg") == std::string::npos && image_file.find_last_of(".png") == std::string::npos)
+	std::string image_file(command_line.positional()[0]);
+	if(!cvdemo::has_image_extension(image_file))
 	{
 		show_help("No valid file format given for first argument.");
 		return -1;
@@ -50,7 +77,7 @@ int main(int argc, char **argv)
     /// Apply the classifier to the frame
     detectAndDisplay(image);
 
-	cv::waitKey(0);
+	display.wait();
     return 0;
 }
 
@@ -58,23 +85,23 @@ int main(int argc, char **argv)
 void detectAndDisplay( cv::Mat &frame )
 {
 	std::cout << "Running the face detector..." << std::endl;
+	detectFaces(frame);
+	/// Show what you got
+    display.show( frame );
+}
 
+/**
+ * @function detectFaces
+ * brief draws an ellipse around every face detected in frame
+ */
+void detectFaces( cv::Mat &frame )
+{
     std::vector<cv::Rect> faces;
-    cv::Mat frame_gray;
-
-    cv::cvtColor( frame, frame_gray, cv::COLOR_BGR2GRAY );
-    cv::equalizeHist( frame_gray, frame_gray );
 
     /// Detect faces
 	std::cout << "Detecting faces..." << std::endl;
-	face_cascade.detectMultiScale(frame_gray, faces, 1.1, 10, 0 | cv::CASCADE_SCALE_IMAGE, cv::Size(30, 30));
-	for (auto face:faces)
-	{
-		cv::Point center( face.x + face.width/2, face.y + face.height/2 );
-		cv::ellipse( frame, center, cv::Size( face.width/2, face.height/2 ), 0, 0, 360, cv::Scalar( 0, 255, 0 ), 4, 8, 0 );
-	}
-	/// Show what you got
-    cv::imshow( window_name, frame );
+	cvdemo::detect_faces( face_cascade, frame, faces );
+	cvdemo::draw_faces( frame, faces );
 }
 
 /**
@@ -82,11 +109,5 @@ void detectAndDisplay( cv::Mat &frame )
  */
 void show_help(const std::string &message)
 {
-	std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-	std::cout << "Usage: cv_face_detection_d /path/to/image" << std::endl; 
-	#else
-	std::cout << "Usage: cv_face_detection /path/to/image" << std::endl; 
-	#endif
-	std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
+	cvdemo::show_help("cv_face_detection", { "/path/to/image", "--batch <dir|glob> --out <dir>" }, message);
 }
@@ -5,21 +5,33 @@
  * based on OpenCV Tutorials
  */
 
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
 #include <iostream>
 #include <string>
-#include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <cvdemo/batch.hpp>
+#include <cvdemo/cli.hpp>
+#include <cvdemo/display.hpp>
+#include <cvdemo/object_detection.hpp>
+#include <cvdemo/timing.hpp>
 
 /// Global Variables
 cv::Mat image_full, image_template, result;
 int match_method = 0;
 int max_Trackbar = 5;
-char image_window[] = "Source Image";
-char template_window[] = "Template Image";
-char result_window[] = "Result";
+cvdemo::Display image_display( "Source Image" );
+cvdemo::Display template_display( "Template Image" );
+cvdemo::Display result_display( "Result" );
+const char* method_names[] = { "SQDIFF", "SQDIFF NORMED", "TM CCORR", "TM CCORR NORMED", "TM COEFF", "TM COEFF NORMED" };
+bool use_pyramid = false;           /// --pyramid
+cvdemo::PyramidMatching pyramid;    /// --levels, --candidates, --margin
 
 /// Function headers
 void template_matching(int, void*);
+cv::Point locate( const cv::Mat &image, int method, cv::Mat &match_result );
+int pyramid_benchmark( int repeat );
 void show_help(const std::string &message = "");
 
 /**
@@ -27,21 +39,70 @@ void show_help(const std::string &message = "");
  */
 int main(int argc, char **argv)
 {
-	if(argc < 3)
+	cvdemo::CommandLine command_line(argc, argv, { "levels", "candidates", "margin", "repeat" });
+	if(!command_line.valid())
+	{
+		show_help(command_line.error());
+		return -1;
+	}
+	use_pyramid = command_line.has("pyramid");
+	pyramid.levels = command_line.get_int("levels", 0);
+	pyramid.candidates = command_line.get_int("candidates", pyramid.candidates);
+	pyramid.margin = command_line.get_int("margin", pyramid.margin);
+
+	const std::vector<std::string> &arguments = command_line.positional();
+
+	/// Headless mode: the best match of every method is drawn on every image and written to disk
+	cvdemo::BatchOptions batch = command_line.batch();
+	if(batch.enabled)
+	{
+		if(arguments.empty())
+		{
+			show_help("No template image given.");
+			return -1;
+		}
+
+		image_template = cv::imread(arguments[0], 1 );
+		if(!image_template.data)
+		{
+			show_help("Template image not valid.");
+			return -1;
+		}
+
+		cvdemo::BatchWriter writer(batch.output_dir);
+		return cvdemo::run_batch(batch, writer, [&writer](const cv::Mat &image, const std::string &)
+		{
+			if(image.cols < image_template.cols || image.rows < image_template.rows)
+				return -1;
+
+			for(int method = 0; method <= max_Trackbar; ++method)
+			{
+				cv::Point matchLoc = locate( image, method, result );
+				cv::Mat img_display = image.clone();
+				cvdemo::draw_match( img_display, matchLoc, image_template.size() );
+				writer.stage( method_names[method] );
+				if(!writer.write( img_display ))
+					return -1;
+			}
+			return 0;
+		});
+	}
+
+	if(arguments.size() < 2)
 	{
 		show_help("Not enough parameters given."); 
 		return 0;
 	}
 	
-	std::string image_file_full(argv[1]), image_file_templ(argv[2]);
+	std::string image_file_full(arguments[0]), image_file_templ(arguments[1]);
 
-	if(image_file_full.find_last_of(".jpg") == std::string::npos && image_file_full.find_last_of(".png") == std::string::npos)
+	if(!cvdemo::has_image_extension(image_file_full))
 	{
 		show_help("No valid file format given for first argument.");
 		return -1;
 	}
 
-	if(image_file_templ.find_last_of(".jpg") == std::string::npos && image_file_templ.find_last_of(".png") == std::string::npos)
+	if(!cvdemo::has_image_extension(image_file_templ))
 	{
 		show_help("No valid file format given for second argument.");
 		return -1;
@@ -63,19 +124,22 @@ int main(int argc, char **argv)
 		return -1;
 	}
 
+	if(command_line.has("benchmark"))
+		return pyramid_benchmark( command_line.get_int("repeat", 3) );
+
 	/// Create a window to display images
-	cv::namedWindow( image_window, cv::WINDOW_AUTOSIZE );
-	cv::namedWindow( template_window, cv::WINDOW_AUTOSIZE );
-	cv::namedWindow( result_window, cv::WINDOW_AUTOSIZE );
+	image_display.open();
+	template_display.open();
+	result_display.open();
 
 	/// Create Trackbar
 	const char* trackbar_label = "Method: \n 0: SQDIFF \n 1: SQDIFF NORMED \n 2: TM CCORR \n 3: TM CCORR NORMED \n 4: TM COEFF \n 5: TM COEFF NORMED";
-	cv::createTrackbar( trackbar_label, image_window, &match_method, max_Trackbar, template_matching );
+	cv::createTrackbar( trackbar_label, image_display.window_name(), &match_method, max_Trackbar, template_matching );
 
 	/// Initialize function
 	template_matching(0,0);
 
-	cv::waitKey(0);
+	image_display.wait();
 
 	return 0;
 }
@@ -89,37 +153,63 @@ void template_matching(int, void*)
     cv::Mat img_display;
 	image_full.copyTo( img_display );
 
-    /// Create the result matrix
-	int result_cols =  image_full.cols - image_template.cols + 1;
-    int result_rows = image_full.rows - image_template.rows + 1;
-	result.create( result_rows, result_cols, CV_32FC1 );
-	
-	/// Do the Matching and Normalize
-    cv::matchTemplate( image_full, image_template, result, match_method );
-    cv::normalize( result, result, 0, 1, cv::NORM_MINMAX, -1, cv::Mat() );
-
-    /// Localizing the best match with minMaxLoc
-    double minVal = 0.0f; 
-	double maxVal = 0.0f; 
-	cv::Point minLoc; 
-	cv::Point maxLoc;
-    cv::Point matchLoc;
-
-    cv::minMaxLoc( result, &minVal, &maxVal, &minLoc, &maxLoc );
-
-    /// For SQDIFF and SQDIFF_NORMED, the best matches are lower values. For all the other methods, the higher the better
-    if( match_method  == cv::TM_SQDIFF || match_method == cv::TM_SQDIFF_NORMED )
-		matchLoc = minLoc;
-    else
-		matchLoc = maxLoc;
-
-    /// Show me what you got
-    cv::rectangle( img_display, matchLoc, cv::Point( matchLoc.x + image_template.cols , matchLoc.y + image_template.rows ), cv::Scalar(0, 255, 0), 2, 8, 0 );
-    cv::rectangle( result, matchLoc, cv::Point( matchLoc.x + image_template.cols , matchLoc.y + image_template.rows ), cv::Scalar(0, 255, 0), 2, 8, 0 );
-
-    cv::imshow( template_window, image_template );
-	cv::imshow( image_window, img_display );
-    cv::imshow( result_window, result );
+    cv::Point matchLoc = locate( image_full, match_method, result );
+
+    /// Show me what you got (in pyramid mode the result is the one of the coarsest level)
+    cvdemo::draw_match( img_display, matchLoc, image_template.size() );
+    if( !use_pyramid )
+        cvdemo::draw_match( result, matchLoc, image_template.size() );
+
+    template_display.show( image_template );
+	image_display.show( img_display );
+    result_display.show( result );
+}
+
+/**
+ * @function locate
+ * brief best match of the template with the method, coarse to fine with --pyramid
+ */
+cv::Point locate( const cv::Mat &image, int method, cv::Mat &match_result )
+{
+	if(use_pyramid)
+		return cvdemo::match_template_pyramid( image, image_template, method, pyramid, match_result );
+	return cvdemo::match_template( image, image_template, method, match_result );
+}
+
+/**
+ * @function pyramid_benchmark
+ * brief times the exhaustive full resolution search against the coarse-to-fine one for every method, with the
+ * distance between the two locations found
+ */
+int pyramid_benchmark( int repeat )
+{
+	repeat = std::max( 1, repeat );
+	if ( image_full.cols < image_template.cols || image_full.rows < image_template.rows )
+	{
+		show_help("Template larger than the full image.");
+		return -1;
+	}
+
+	const int levels = cvdemo::pyramid_levels( image_full.size(), image_template.size(), pyramid );
+	std::cout << "Image " << image_full.cols << "x" << image_full.rows << ", template " << image_template.cols << "x" << image_template.rows
+	          << ", " << levels << " levels, " << pyramid.candidates << " candidates, margin " << pyramid.margin
+	          << ", best of " << repeat << " runs" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::setw(18) << "method" << std::setw(12) << "exact ms" << std::setw(12) << "pyramid ms" << std::setw(10) << "speedup"
+	          << std::setw(12) << "offset px" << std::endl;
+
+	cv::Mat match_result;
+	for ( int method = 0; method <= max_Trackbar; ++method )
+	{
+		cv::Point exact, coarse_to_fine;
+		double exact_ms = cvdemo::best_time_ms( repeat, [&]() { exact = cvdemo::match_template( image_full, image_template, method, match_result ); } );
+		double pyramid_ms = cvdemo::best_time_ms( repeat, [&]() { coarse_to_fine = cvdemo::match_template_pyramid( image_full, image_template, method, pyramid, match_result ); } );
+		const cv::Point offset = coarse_to_fine - exact;
+		std::cout << std::setw(18) << method_names[method] << std::setw(12) << exact_ms << std::setw(12) << pyramid_ms
+		          << std::setw(9) << exact_ms / pyramid_ms << "x" << std::setw(12) << std::sqrt( static_cast<double>(offset.x * offset.x + offset.y * offset.y) ) << std::endl;
+	}
+
+	return 0;
 }
 
 /**
@@ -127,11 +217,5 @@ void template_matching(int, void*)
  */
 void show_help(const std::string &message)
 {
-	std::cout << "Error: " << message << std::endl << std::endl;
-    #ifdef DEBUG_MODE
-	std::cout << "Usage: cv_matching_d /path/to/full/image /path/to/template/image" << std::endl; 
-	#else
-	std::cout << "Usage: cv_matching /path/to/full/image /path/to/template/image" << std::endl; 
-	#endif
-	std::cout << "Extensions supported: *.jpg, *.png" << std::endl;
-}
\ No newline at end of file
+	cvdemo::show_help("cv_matching", { "[--pyramid] [--levels <n>] [--candidates <n>] [--margin <px>] /path/to/full/image /path/to/template/image", "--benchmark [--levels <n>] [--candidates <n>] [--margin <px>] [--repeat <n>] /path/to/full/image /path/to/template/image", "--batch <dir|glob> --out <dir> [--pyramid] /path/to/template/image" }, message);
+}